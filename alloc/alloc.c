@@ -93,3 +93,21 @@ void alloc_free_all(Allocator *allocator) {
 	}
 	allocator->node = NULL;
 }
+
+struct AllocatorNode *alloc_mark(Allocator *allocator) {
+	return allocator->node;
+}
+
+void alloc_free_to(Allocator *allocator, struct AllocatorNode *mark) {
+	// Free everything allocated after the mark was taken, the marked allocation itself must still be around
+	AllocatorFreeFunc *afree = allocator->free;
+	struct AllocatorNode *node = allocator->node;
+	struct AllocatorNode *prev_node;
+	while (node != mark) {
+		prev_node = node->prev;
+		afree(node->ptr);
+		afree(node);
+		node = prev_node;
+	}
+	allocator->node = mark;
+}
@@ -46,5 +46,7 @@ void *alloc_new(Allocator *allocator, size_t size);
 void *alloc_ctx(Allocator *allocator, size_t size, char *ctx);
 void alloc_free(Allocator *allocator, void *ptr);
 void alloc_free_all(Allocator *allocator);
+struct AllocatorNode *alloc_mark(Allocator *allocator);
+void alloc_free_to(Allocator *allocator, struct AllocatorNode *mark);
 
 #endif
@@ -0,0 +1,34 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+#include "bench/bench.h"
+
+double bench_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void bench_report(char *name, double seconds, size_t bytes) {
+	printf("%-32s %10.3f ms %10.1f MB/s\n", name, seconds * 1e3, bytes / seconds / 1e6);
+}
@@ -0,0 +1,39 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+
+/*
+ * Helpers shared by the benchmark drivers in bench/
+ * 
+ * Each driver times its workload BENCH_RUNS times and reports the fastest run,
+ * the slower ones mostly measure whatever else the machine was doing.
+ */
+
+#ifndef BENCH_RUNS
+#define BENCH_RUNS 5
+#endif
+
+double bench_now(void);
+void bench_report(char *name, double seconds, size_t bytes);
+
+#endif
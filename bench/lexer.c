@@ -0,0 +1,97 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Lexer throughput: the corpus is repeated until it is big enough to time and
+ * then only tokenized, nothing is parsed or printed. The same driver is built
+ * once for each lexer backend (LEXER_NAME), so comparing their output lines
+ * compares the flex scanner with the direct-coded one.
+ * 
+ * Usage: bench_lexer_<backend> <corpus.au3> [megabytes]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench/bench.h"
+#include "parser/parser.h"
+#include "parser/source.h"
+#include "utils.h"
+
+#ifndef LEXER_NAME
+#define LEXER_NAME "lexer"
+#endif
+
+#define DEFAULT_MEGABYTES 32
+
+static char *next_code;
+static size_t code_size;
+
+static char *provide_next_code(char *file, size_t *size, bool once) {
+	(void) file;
+	// The copy is made before the clock starts, the lexer takes it over
+	if (once || !next_code) return NULL;
+	char *code = next_code;
+	next_code = NULL;
+	*size = code_size;
+	return code;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) die("Usage: bench_lexer <corpus.au3> [megabytes]");
+	size_t megabytes = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_MEGABYTES;
+	
+	FILE *file = fopen(argv[1], "rb");
+	if (!file) die("Failed to open the corpus!");
+	char *corpus = readfile(file);
+	fclose(file);
+	if (!corpus) die("Failed to read the corpus!");
+	size_t corpus_size = strlen(corpus);
+	if (!corpus_size) die("The corpus is empty!");
+	
+	// Whole copies of the corpus, so every copy ends its comments and lines
+	size_t repeat = (megabytes * 1000000 + corpus_size - 1) / corpus_size;
+	if (!repeat) repeat = 1;
+	code_size = corpus_size * repeat;
+	char *code = malloc(code_size + 2);
+	if (!code) die("Failed to allocate the code!");
+	for (size_t i = 0; i < repeat; ++i) memcpy(code + corpus_size * i, corpus, corpus_size);
+	code[code_size] = code[code_size + 1] = '\0';
+	free(corpus);
+	
+	double fastest = 0;
+	size_t tokens = 0;
+	for (int run = 0; run < BENCH_RUNS; ++run) {
+		next_code = malloc(code_size + 2);
+		if (!next_code) die("Failed to allocate the code!");
+		memcpy(next_code, code, code_size + 2);
+		
+		double start = bench_now();
+		tokens = scan_count("corpus.au3", provide_next_code);
+		double time = bench_now() - start;
+		source_free();
+		if (!run || time < fastest) fastest = time;
+	}
+	free(code);
+	
+	bench_report(LEXER_NAME, fastest, code_size);
+	printf("%zu tokens in %zu bytes\n", tokens, code_size);
+	return EXIT_SUCCESS;
+}
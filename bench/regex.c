@@ -0,0 +1,291 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Match rates of runtime/regex.c, finding every match in 16 MB of text, next to a classic
+ * backtracking matcher and the POSIX regexec of the C library on the same patterns. The
+ * backtracking matcher only knows characters, classes, the dot, the quantifiers and anchors, so
+ * it sits out the patterns with groups or alternation. Then a pathological pattern shows the
+ * backtracking time blowing up with the length of the subject while ours stays linear, and the
+ * cost of a call with a compiled, a cached and an uncached pattern.
+ * 
+ * Usage: bench_regex
+ */
+
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench/bench.h"
+#include "runtime/regex.h"
+#include "utils.h"
+
+#define TEXT_SIZE 16000000
+#define CALLS 100000
+
+struct Pattern {
+	char *ours;
+	char *backtracking; // Same pattern in the syntax of backtrack_here, NULL if it has no way to write it
+	char *posix; // Extended syntax
+};
+
+typedef bool Finder(void *engine, char *text, size_t len, size_t start, size_t span[2]);
+
+static Finder find_ours, find_backtracking, find_posix;
+static void run(Finder *find, void *engine, char *text, size_t len);
+static void pathological(void);
+static void call_cost(void);
+static const char *backtrack_here(const char *pattern, const char *text, const char *end);
+static const char *term_end(const char *term);
+static bool term_matches(const char *term, unsigned char chr);
+
+static double last_time;
+static size_t last_count;
+
+int main(void) {
+	// Words with something for every pattern to find now and then
+	static const char *fragments[] = {
+		"the ", "quick ", "brown ", "fox jumps ", "over ", "lazy ", "dog jumps ", "running ", "walking ",
+		"call 555-1234 ", "on 2024-05-17 ", "error: timeout\n", "value 42\n", "a ", "needle ", "of ", "hay ",
+	};
+	static const unsigned weights[] = {40, 20, 20, 4, 20, 20, 4, 6, 6, 2, 2, 1, 2, 40, 1, 40, 60};
+	unsigned total = 0;
+	for (size_t i = 0; i < lenof(weights); ++i) total += weights[i];
+	
+	char *text = malloc(TEXT_SIZE + 1);
+	if (!text) die("Failed to allocate the text!");
+	uint64_t state = 88172645463325252u;
+	size_t len = 0;
+	while (len < TEXT_SIZE) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		unsigned pick = state % total;
+		size_t i = 0;
+		while (pick >= weights[i]) pick -= weights[i++];
+		for (const char *chr = fragments[i]; *chr && len < TEXT_SIZE; ++chr) text[len++] = *chr;
+	}
+	text[len] = '\0';
+	
+	static const struct Pattern patterns[] = {
+		{"needle", "needle", "needle"},
+		{"\\d{3}-\\d{4}", "\\d\\d\\d-\\d\\d\\d\\d", "[0-9]{3}-[0-9]{4}"},
+		{"(\\d{4})-(\\d\\d)-(\\d\\d)", NULL, "([0-9]{4})-([0-9][0-9])-([0-9][0-9])"},
+		{"[a-z]+ing", "[a-z]+ing", "[a-z]+ing"},
+		{"error: (\\w+)", "error: \\w+", "error: ([A-Za-z0-9_]+)"},
+		{"(fox|dog) jumps", NULL, "(fox|dog) jumps"},
+	};
+	printf("%-32s %10s %10s %10s %10s\n", "MB/s for all matches", "ours", "backtrack", "regexec", "matches");
+	for (size_t i = 0; i < lenof(patterns); ++i) {
+		struct RegexError error = {NULL};
+		struct Regex *regex = regex_compile((struct String){patterns[i].ours, strlen(patterns[i].ours)}, &error);
+		if (!regex) die(error.msg ? error.msg : "Failed to compile a pattern!");
+		regex_t posix;
+		if (regcomp(&posix, patterns[i].posix, REG_EXTENDED)) die("Failed to compile a POSIX pattern!");
+		
+		printf("%-32s", patterns[i].ours);
+		run(find_ours, regex, text, len);
+		size_t count = last_count;
+		printf(" %10.1f", len / last_time / 1e6);
+		if (patterns[i].backtracking) {
+			run(find_backtracking, patterns[i].backtracking, text, len);
+			printf(" %10.1f", len / last_time / 1e6);
+			if (last_count != count) die("The backtracking matcher found a different number of matches!");
+		} else {
+			printf(" %10s", "-");
+		}
+		run(find_posix, &posix, text, len);
+		printf(" %10.1f %10zu\n", len / last_time / 1e6, count);
+		if (last_count != count) die("regexec found a different number of matches!");
+		
+		regfree(&posix);
+		regex_free(regex);
+	}
+	free(text);
+	
+	pathological();
+	call_cost();
+	return EXIT_SUCCESS;
+}
+
+/* The fastest time goes to last_time, along with the number of matches */
+static void run(Finder *find, void *engine, char *text, size_t len) {
+	for (int i = 0; i < BENCH_RUNS; ++i) {
+		size_t count = 0, span[2];
+		double start = bench_now();
+		for (size_t at = 0; at <= len && find(engine, text, len, at, span); ++count) at = span[1] > span[0] ? span[1] : span[1] + 1;
+		double time = bench_now() - start;
+		if (!i || time < last_time) last_time = time;
+		last_count = count;
+	}
+}
+
+/* Nested quantifiers which can't match make a backtracking matcher try every way to split the subject */
+static void pathological(void) {
+	static const char pattern[] = "a*a*a*a*b";
+	struct RegexError error = {NULL};
+	struct Regex *regex = regex_compile((struct String){(char *) pattern, sizeof pattern - 1}, &error);
+	if (!regex) die("Failed to compile the pathological pattern!");
+	
+	printf("\n%-32s %10s %10s\n", "us for a*a*a*a*b on a...a", "ours", "backtrack");
+	for (size_t len = 20; len <= 80; len *= 2) {
+		char text[81];
+		memset(text, 'a', len);
+		text[len] = '\0';
+		printf("%-32zu", len);
+		run(find_ours, regex, text, len);
+		printf(" %10.1f", last_time * 1e6);
+		run(find_backtracking, (char *) pattern, text, len);
+		printf(" %10.1f\n", last_time * 1e6);
+	}
+	regex_free(regex);
+}
+
+/* A literal pattern is compiled along with the call, a dynamic one is found in the cache, the rest is compiled every time */
+static void call_cost(void) {
+	struct String pattern = {"(\\w+)@(\\w+)\\.com", sizeof "(\\w+)@(\\w+)\\.com" - 1};
+	struct String subject = {"contact: admin@example.com", sizeof "contact: admin@example.com" - 1};
+	size_t captures[2 * (REGEX_MAX_GROUPS + 1)];
+	struct RegexError error = {NULL};
+	struct Regex *compiled = regex_compile(pattern, &error);
+	if (!compiled) die("Failed to compile the pattern!");
+	
+	printf("\n%-32s %10s\n", "us per call", "");
+	double start = bench_now();
+	for (int i = 0; i < CALLS; ++i) {
+		struct Regex *regex = regex_compile(pattern, &error);
+		if (!regex || !regex_match(regex, subject, 0, captures)) die("The pattern didn't match!");
+		regex_free(regex);
+	}
+	printf("%-32s %10.3f\n", "compile and match", (bench_now() - start) / CALLS * 1e6);
+	
+	start = bench_now();
+	for (int i = 0; i < CALLS; ++i) {
+		struct Regex *regex = regex_cached(pattern, &error);
+		if (!regex || !regex_match(regex, subject, 0, captures)) die("The pattern didn't match!");
+	}
+	printf("%-32s %10.3f\n", "cached", (bench_now() - start) / CALLS * 1e6);
+	
+	start = bench_now();
+	for (int i = 0; i < CALLS; ++i) {
+		if (!regex_match(compiled, subject, 0, captures)) die("The pattern didn't match!");
+	}
+	printf("%-32s %10.3f\n", "literal", (bench_now() - start) / CALLS * 1e6);
+	regex_free(compiled);
+}
+
+static bool find_ours(void *engine, char *text, size_t len, size_t start, size_t span[2]) {
+	size_t captures[2 * (REGEX_MAX_GROUPS + 1)];
+	if (!regex_match(engine, (struct String){text, len}, start, captures)) return false;
+	span[0] = captures[0];
+	span[1] = captures[1];
+	return true;
+}
+
+static bool find_backtracking(void *engine, char *text, size_t len, size_t start, size_t span[2]) {
+	const char *pattern = engine;
+	bool anchored = *pattern == '^';
+	for (size_t at = start; at <= len; ++at) {
+		const char *end = backtrack_here(pattern + anchored, text + at, text + len);
+		if (end) {
+			span[0] = at;
+			span[1] = end - text;
+			return true;
+		}
+		if (anchored) break;
+	}
+	return false;
+}
+
+static bool find_posix(void *engine, char *text, size_t len, size_t start, size_t span[2]) {
+	regmatch_t match = {.rm_so = start, .rm_eo = len};
+	if (regexec(engine, text, 1, &match, REG_STARTEND | (start ? REG_NOTBOL : 0))) return false;
+	span[0] = match.rm_so;
+	span[1] = match.rm_eo;
+	return true;
+}
+
+/*
+ * The matcher of Kernighan and Pike with classes and greedy + and ?, it returns the end of the
+ * match at the start of the text. Every way to split the text between the quantifiers is tried.
+ */
+static const char *backtrack_here(const char *pattern, const char *text, const char *end) {
+	if (!*pattern) return text;
+	if (pattern[0] == '$' && !pattern[1]) return text == end ? text : NULL;
+	const char *next = term_end(pattern);
+	if (*next != '*' && *next != '+' && *next != '?') {
+		if (text == end || !term_matches(pattern, *text)) return NULL;
+		return backtrack_here(next, text + 1, end);
+	}
+	
+	// Take as many as possible and then give them back one at a time
+	size_t min = *next == '+', max = *next == '?' ? 1 : SIZE_MAX, count = 0;
+	while (count < max && text + count < end && term_matches(pattern, text[count])) ++count;
+	for (; count >= min; --count) {
+		const char *match = backtrack_here(next + 1, text + count, end);
+		if (match) return match;
+		if (!count) break;
+	}
+	return NULL;
+}
+
+static const char *term_end(const char *term) {
+	if (*term == '\\') return term + 2;
+	if (*term != '[') return term + 1;
+	++term;
+	if (*term == '^') ++term;
+	do ++term; while (*term && *term != ']');
+	return *term ? term + 1 : term;
+}
+
+static bool term_matches(const char *term, unsigned char chr) {
+	switch (*term) {
+		case '.':
+			return chr != '\n';
+		case '\\':
+			switch (term[1]) {
+				case 'd':
+					return chr >= '0' && chr <= '9';
+				case 'w':
+					return chr == '_' || (chr >= '0' && chr <= '9') || ((chr | 0x20) >= 'a' && (chr | 0x20) <= 'z');
+				case 's':
+					return chr == ' ' || (chr >= '\t' && chr <= '\r');
+				default:
+					return chr == (unsigned char) term[1];
+			}
+		case '[': {
+			bool negated = term[1] == '^', found = false;
+			const char *member = term + 1 + negated;
+			do {
+				if (member[1] == '-' && member[2] && member[2] != ']') {
+					found |= chr >= (unsigned char) member[0] && chr <= (unsigned char) member[2];
+					member += 3;
+				} else {
+					found |= chr == (unsigned char) *member++;
+				}
+			} while (*member && *member != ']');
+			return found != negated;
+		}
+		default:
+			return chr == (unsigned char) *term;
+	}
+}
@@ -0,0 +1,159 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Throughput of the kernels of runtime/string.c on a 1 MB haystack. It is built once for each
+ * flavour of the kernels (scalar, SSE2 and AVX2) like tests/string.c, so comparing the output of
+ * the drivers compares the vectorized kernels with the scalar ones. The scalar driver also times
+ * plain loops and the C library as references.
+ * 
+ * Usage: bench_string_<flavour>
+ */
+
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "bench/bench.h"
+#include "runtime/string.h"
+#include "utils.h"
+
+#ifndef STRING_FLAVOUR
+#define STRING_FLAVOUR "string"
+#endif
+
+#define HAYSTACK_SIZE 1000000
+#define PASSES 64 // Over the haystack in each run
+
+enum Operation {
+	OP_FIND,
+	OP_FIND_NO_CASE,
+	OP_EQUAL_NO_CASE,
+	OP_UPPER,
+	OP_LOWER,
+	OP_NAIVE_FIND,
+	OP_NAIVE_FIND_NO_CASE,
+	OP_NAIVE_UPPER,
+	OP_MEMMEM,
+	OP_STRCASESTR,
+	OP_STRCASECMP,
+};
+
+static char haystack[HAYSTACK_SIZE + 1], copy[HAYSTACK_SIZE + 1], output[HAYSTACK_SIZE];
+static char needle[] = "jumped over the lazy dog", needle_upper[] = "JUMPED OVER THE LAZY DOG";
+static size_t sink; // Results go here so that the compiler can't drop the work
+
+static void run(char *name, enum Operation operation);
+static size_t run_once(enum Operation operation);
+static size_t naive_find(char *chars, size_t len, char *pattern, size_t pattern_len, bool case_sensitive);
+
+int main(void) {
+#if !defined(STRING_SCALAR) && defined(__AVX2__)
+	if (!__builtin_cpu_supports("avx2")) {
+		puts(STRING_FLAVOUR ": skipped, the processor has no AVX2");
+		return EXIT_SUCCESS;
+	}
+#endif
+	
+	// Words which share their first letters with the needle, which is only at the very end
+	static const char *words[] = {"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dogs", "jumper", "overt"};
+	uint64_t state = 88172645463325252u;
+	for (size_t i = 0; i < HAYSTACK_SIZE;) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		for (const char *word = words[state % lenof(words)]; *word && i < HAYSTACK_SIZE; ++word) haystack[i++] = *word;
+		if (i < HAYSTACK_SIZE) haystack[i++] = ' ';
+	}
+	memcpy(haystack + HAYSTACK_SIZE - (sizeof needle - 1), needle, sizeof needle - 1);
+	memcpy(copy, haystack, sizeof haystack);
+	copy[0] ^= 0x20; // Equal except for the case
+	
+	run(STRING_FLAVOUR " find", OP_FIND);
+	run(STRING_FLAVOUR " find, no case", OP_FIND_NO_CASE);
+	run(STRING_FLAVOUR " equal, no case", OP_EQUAL_NO_CASE);
+	run(STRING_FLAVOUR " upper", OP_UPPER);
+	run(STRING_FLAVOUR " lower", OP_LOWER);
+#ifdef STRING_SCALAR
+	run("loop find", OP_NAIVE_FIND);
+	run("loop find, no case", OP_NAIVE_FIND_NO_CASE);
+	run("loop upper", OP_NAIVE_UPPER);
+	run("memmem", OP_MEMMEM);
+	run("strcasestr", OP_STRCASESTR);
+	run("strcasecmp", OP_STRCASECMP);
+#endif
+	return sink == SIZE_MAX ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void run(char *name, enum Operation operation) {
+	double fastest = 0;
+	for (int i = 0; i < BENCH_RUNS; ++i) {
+		double start = bench_now();
+		for (int pass = 0; pass < PASSES; ++pass) sink += run_once(operation);
+		double time = bench_now() - start;
+		if (!i || time < fastest) fastest = time;
+	}
+	bench_report(name, fastest, (size_t) HAYSTACK_SIZE * PASSES);
+}
+
+static size_t run_once(enum Operation operation) {
+	struct String whole = {haystack, HAYSTACK_SIZE};
+	switch (operation) {
+		case OP_FIND:
+			return string_find(whole, (struct String){needle, sizeof needle - 1}, 0, true);
+		case OP_FIND_NO_CASE:
+			return string_find(whole, (struct String){needle_upper, sizeof needle_upper - 1}, 0, false);
+		case OP_EQUAL_NO_CASE:
+			return string_equal(whole, (struct String){copy, HAYSTACK_SIZE}, false);
+		case OP_UPPER:
+			string_upper(output, haystack, HAYSTACK_SIZE);
+			return output[HAYSTACK_SIZE - 1];
+		case OP_LOWER:
+			string_lower(output, haystack, HAYSTACK_SIZE);
+			return output[HAYSTACK_SIZE - 1];
+		case OP_NAIVE_FIND:
+			return naive_find(haystack, HAYSTACK_SIZE, needle, sizeof needle - 1, true);
+		case OP_NAIVE_FIND_NO_CASE:
+			return naive_find(haystack, HAYSTACK_SIZE, needle_upper, sizeof needle_upper - 1, false);
+		case OP_NAIVE_UPPER:
+			for (size_t i = 0; i < HAYSTACK_SIZE; ++i) output[i] = toupper((unsigned char) haystack[i]);
+			return output[HAYSTACK_SIZE - 1];
+		case OP_MEMMEM:
+			return (char *) memmem(haystack, HAYSTACK_SIZE, needle, sizeof needle - 1) - haystack;
+		case OP_STRCASESTR:
+			return strcasestr(haystack, needle_upper) - haystack;
+		case OP_STRCASECMP:
+			return strcasecmp(haystack, copy) == 0;
+	}
+	return 0;
+}
+
+static size_t naive_find(char *chars, size_t len, char *pattern, size_t pattern_len, bool case_sensitive) {
+	for (size_t i = 0; i + pattern_len <= len; ++i) {
+		size_t j = 0;
+		while (j < pattern_len && (case_sensitive ? chars[i + j] == pattern[j] : tolower((unsigned char) chars[i + j]) == tolower((unsigned char) pattern[j]))) ++j;
+		if (j == pattern_len) return i;
+	}
+	return STRING_NOT_FOUND;
+}
@@ -0,0 +1,559 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cease/cease.h"
+#include "compiler/compiler.h"
+#include "compiler/peephole.h"
+#include "parser/parser_internal.h"
+#include "parser/tree.h"
+#include "runtime/array.h"
+#include "runtime/builtins.h"
+#include "runtime/bytecode.h"
+#include "runtime/regex.h"
+#include "runtime/value.h"
+#include "utils.h"
+
+static char *err_mem_ctx = "compiling code";
+
+static const enum Opcode OPERATION_OPCODES[] = {
+	[OP_INV] = INS_INV,
+	[OP_ADD] = INS_ADD,
+	[OP_SUB] = INS_SUB,
+	[OP_MUL] = INS_MUL,
+	[OP_DIV] = INS_DIV,
+	[OP_EXP] = INS_EXP,
+	[OP_CAT] = INS_CAT,
+	[OP_NOT] = INS_NOT,
+	[OP_EQU] = INS_EQU,
+	[OP_SEQU] = INS_SEQU,
+	[OP_NEQ] = INS_NEQ,
+	[OP_LT] = INS_LT,
+	[OP_LTE] = INS_LTE,
+	[OP_GT] = INS_GT,
+	[OP_GTE] = INS_GTE,
+};
+
+static size_t emit(struct Compiler *compiler, enum Opcode op, uint32_t arg);
+static void patch_jump(struct Compiler *compiler, size_t jump);
+static void push_frame(struct Compiler *compiler, struct Expression *expression);
+static struct Operand *compile_step(struct Compiler *compiler, struct CompileFrame *frame);
+static struct Operand *compile_access(struct Compiler *compiler, struct CompileFrame *frame, size_t stage);
+static struct Operand *compile_assignment(struct Compiler *compiler, struct CompileFrame *frame, size_t stage);
+static struct Operand *compile_call(struct Compiler *compiler, struct CompileFrame *frame, size_t stage);
+static struct Regex *compile_pattern(struct Compiler *compiler, const struct Builtin *builtin, struct ExpressionList *arguments);
+static void compile_leaf(struct Compiler *compiler, struct Operand *operand);
+static uint32_t add_cache(struct Compiler *compiler, char *key);
+static char *member_key(struct Operand *operand);
+static unsigned char collect_subscripts(struct Expression *expression, struct Operand *subscripts[], struct Expression **base);
+static void compile_operand(struct Compiler *compiler, struct Operand *operand);
+static int stack_effect(enum Opcode op, uint32_t arg);
+static void compile_statements(struct Compiler *compiler, struct Statement block[], uint32_t start, uint32_t end);
+static void compile_declaration(struct Compiler *compiler, struct Declaration *declaration);
+static void compile_for(struct Compiler *compiler, struct Statement block[], uint32_t index);
+static void compile_loop_jump(struct Compiler *compiler, struct Statement *statement);
+static void compile_redim(struct Compiler *compiler, struct Expression *expression);
+static void patch_loop_jumps(struct Compiler *compiler, bool is_exit);
+
+struct Chunk compile_exprlist(struct ExpressionList *list, CeasePoint *point) {
+	struct Compiler compiler = {.chunk = chunk_init(), .point = point, .depth = 0, .frames = NULL};
+	
+	if (!list || !list->count) {
+		size_t constant = chunk_add_constant(&compiler.chunk, (struct Value){.type = VAL_EMPTY});
+		if (constant == CHUNK_ERROR) cease_mem(point, err_mem_ctx);
+		emit(&compiler, INS_CONST, constant);
+	} else for (size_t i = 0; i < list->count; ++i) {
+		if (i) emit(&compiler, INS_POP, 0);
+		compile_expression(&compiler, &list->expressions[i]);
+	}
+	emit(&compiler, INS_RETURN, 0);
+	if (!peephole(&compiler.chunk)) cease_mem(point, err_mem_ctx);
+	
+	free(compiler.frames);
+	return compiler.chunk;
+}
+
+struct Chunk compile_block(struct Statement block[], size_t size, CeasePoint *point) {
+	struct Compiler compiler = {.chunk = chunk_init(), .point = point, .depth = 0, .frames = NULL, .loops = NULL, .loop_jumps = NULL};
+	if (size > UINT32_MAX) cease(point, "Too many statements in a block", false);
+	compile_statements(&compiler, block, 0, size);
+	
+	size_t constant = chunk_add_constant(&compiler.chunk, (struct Value){.type = VAL_EMPTY});
+	if (constant == CHUNK_ERROR) cease_mem(point, err_mem_ctx);
+	emit(&compiler, INS_CONST, constant);
+	emit(&compiler, INS_RETURN, 0);
+	if (!peephole(&compiler.chunk)) cease_mem(point, err_mem_ctx);
+	
+	free(compiler.frames);
+	free(compiler.loops);
+	free(compiler.loop_jumps);
+	return compiler.chunk;
+}
+
+void compile_expression(struct Compiler *compiler, struct Expression *expression) {
+	/* 
+	 * The tree is walked with an explicit stack instead of recursion so that
+	 * long operator chains and deep nesting can't overflow the C stack.
+	 * Each step emits code for the frame on top and returns the next operand it needs.
+	 */
+	size_t base = compiler->frame_count;
+	push_frame(compiler, expression);
+	while (compiler->frame_count > base) {
+		struct Operand *next = compile_step(compiler, &compiler->frames[compiler->frame_count - 1]);
+		if (!next) {
+			--compiler->frame_count;
+		} else if (next->type == OPE_EXPRESSION) {
+			push_frame(compiler, next->expression);
+		} else {
+			compile_leaf(compiler, next);
+		}
+	}
+}
+
+static size_t emit(struct Compiler *compiler, enum Opcode op, uint32_t arg) {
+	size_t index = chunk_emit(&compiler->chunk, op, arg);
+	if (index == CHUNK_ERROR) cease_mem(compiler->point, err_mem_ctx);
+	
+	compiler->depth += stack_effect(op, arg);
+	if (compiler->depth > compiler->chunk.max_stack) compiler->chunk.max_stack = compiler->depth;
+	
+	return index;
+}
+
+static void patch_jump(struct Compiler *compiler, size_t jump) {
+	compiler->chunk.code[jump].arg = compiler->chunk.code_len;
+}
+
+static void push_frame(struct Compiler *compiler, struct Expression *expression) {
+	struct CompileFrame *frames = grow_array(compiler->frames, &compiler->frame_cap, compiler->frame_count, sizeof *frames);
+	if (!frames) cease_mem(compiler->point, err_mem_ctx);
+	compiler->frames = frames;
+	compiler->frames[compiler->frame_count++] = (struct CompileFrame){.expression = expression, .stage = 0};
+}
+
+static struct Operand *compile_step(struct Compiler *compiler, struct CompileFrame *frame) {
+	struct Expression *expression = frame->expression;
+	struct Operand *operands = expression->operands;
+	size_t stage = frame->stage++;
+	
+	switch (expression->op) {
+		case OP_AND:
+		case OP_OR:
+			// Short-circuit evaluation, the result is always a boolean
+			switch (stage) {
+				case 0:
+					return &operands[0];
+				case 1:
+					emit(compiler, INS_TRUTH, 0);
+					frame->jumps[0] = emit(compiler, expression->op == OP_AND ? INS_JUMP_FALSE_KEEP : INS_JUMP_TRUE_KEEP, 0);
+					return &operands[1];
+				default:
+					emit(compiler, INS_TRUTH, 0);
+					patch_jump(compiler, frame->jumps[0]);
+					return NULL;
+			}
+		case OP_CON:
+			switch (stage) {
+				case 0:
+					return &operands[0];
+				case 1:
+					frame->jumps[0] = emit(compiler, INS_JUMP_FALSE, 0);
+					return &operands[1];
+				case 2:
+					frame->jumps[1] = emit(compiler, INS_JUMP, 0);
+					// Only one of the branches pushes a value at runtime
+					--compiler->depth;
+					patch_jump(compiler, frame->jumps[0]);
+					return &operands[2];
+				default:
+					patch_jump(compiler, frame->jumps[1]);
+					return NULL;
+			}
+		case OP_ACC:
+			return compile_access(compiler, frame, stage);
+		case OP_ASS:
+			return compile_assignment(compiler, frame, stage);
+		case OP_CALL:
+			return compile_call(compiler, frame, stage);
+		case OP_ERR:
+			cease(compiler->point, "Unable to compile an invalid expression", false);
+		default:
+			if (stage < expr_operand_count(expression)) return &operands[stage];
+			if (expression->op != OP_NOP) emit(compiler, OPERATION_OPCODES[expression->op], 0);
+			return NULL;
+	}
+}
+
+static struct Operand *compile_access(struct Compiler *compiler, struct CompileFrame *frame, size_t stage) {
+	struct Expression *expression = frame->expression;
+	
+	// Member access: `expr.Word` or `expr["key"]`
+	char *key = member_key(&expression->operands[1]);
+	if (key) {
+		if (stage == 0) return &expression->operands[0];
+		emit(compiler, INS_MEMBER, add_cache(compiler, key));
+		return NULL;
+	}
+	
+	struct Operand *subscripts[ARRAY_MAX_DIMENSIONS];
+	struct Expression *base;
+	unsigned char count = collect_subscripts(expression, subscripts, &base);
+	if (stage == 0) return &base->operands[0];
+	if (stage <= count) return subscripts[count - stage];
+	emit(compiler, INS_INDEX, count);
+	return NULL;
+}
+
+static struct Operand *compile_assignment(struct Compiler *compiler, struct CompileFrame *frame, size_t stage) {
+	struct Expression *expression = frame->expression;
+	struct Operand *target = &expression->operands[0];
+	if (target->type == OPE_VARIABLE) {
+		if (stage == 0) return &expression->operands[1];
+		emit(compiler, target->variable->scope == SCO_LOCAL ? INS_STORE_LOCAL : INS_STORE_GLOBAL, target->variable->slot);
+		return NULL;
+	}
+	
+	char *key;
+	if (target->type == OPE_EXPRESSION && target->expression->op == OP_ACC && (key = member_key(&target->expression->operands[1]))) {
+		if (stage == 0) return &target->expression->operands[0];
+		if (stage == 1) return &expression->operands[1];
+		emit(compiler, INS_SET_MEMBER, add_cache(compiler, key));
+		return NULL;
+	}
+	
+	// Element of an array or a map: `$a[i][j] = value`
+	if (target->type == OPE_EXPRESSION && target->expression->op == OP_ACC) {
+		struct Operand *subscripts[ARRAY_MAX_DIMENSIONS];
+		struct Expression *base;
+		unsigned char count = collect_subscripts(target->expression, subscripts, &base);
+		if (stage == 0) return &base->operands[0];
+		if (stage <= count) return subscripts[count - stage];
+		if (stage == count + 1u) return &expression->operands[1];
+		emit(compiler, INS_SET_INDEX, count);
+		return NULL;
+	}
+	
+	cease(compiler->point, "Unsupported assignment target", false);
+}
+
+static struct Operand *compile_call(struct Compiler *compiler, struct CompileFrame *frame, size_t stage) {
+	struct Operand *callee = &frame->expression->operands[0];
+	struct ExpressionList *arguments = frame->expression->operands[1].expression_list;
+	if (stage == 0) {
+		if (callee->type != OPE_IDENTIFIER || callee->identifier[0] == '$' || callee->identifier[0] == '@') {
+			cease(compiler->point, "Only functions can be called", false);
+		}
+		if (arguments->count > UINT32_MAX) cease(compiler->point, "Too many arguments in function call", false);
+	}
+	
+	// The arguments are left on the value stack in order, the callee gets a pointer to them
+	if (stage < arguments->count) {
+		frame->operand = (struct Operand){.type = OPE_EXPRESSION, .expression = &arguments->expressions[stage]};
+		return &frame->operand;
+	}
+	
+	// Built-in functions are bound here, the interpreter calls them through the pointer
+	const struct Builtin *builtin = builtin_find(callee->identifier);
+	if (!builtin) cease_fmt(compiler->point, "Unknown function", "Unknown function '%s'", callee->identifier);
+	if (arguments->count < builtin->min_args || arguments->count > builtin->max_args) {
+		if (builtin->min_args == builtin->max_args) {
+			cease_fmt(compiler->point, "Wrong number of arguments", "Function '%s' takes %" PRIu32 " argument%s, not %zu", builtin->name, builtin->min_args, builtin->min_args == 1 ? "" : "s", arguments->count);
+		}
+		cease_fmt(compiler->point, "Wrong number of arguments", "Function '%s' takes %" PRIu32 " to %" PRIu32 " arguments, not %zu", builtin->name, builtin->min_args, builtin->max_args, arguments->count);
+	}
+	
+	struct Regex *regex = compile_pattern(compiler, builtin, arguments);
+	size_t site = chunk_add_call(&compiler->chunk, callee->identifier, arguments->count, builtin->function, regex);
+	if (site == CHUNK_ERROR) {
+		regex_free(regex);
+		cease_mem(compiler->point, err_mem_ctx);
+	}
+	emit(compiler, INS_CALL, site);
+	compiler->depth -= arguments->count;
+	return NULL;
+}
+
+/* A regular expression which is a literal is compiled once here instead of every time the call runs */
+static struct Regex *compile_pattern(struct Compiler *compiler, const struct Builtin *builtin, struct ExpressionList *arguments) {
+	if (!builtin->pattern || arguments->count < builtin->pattern) return NULL;
+	struct Expression *argument = &arguments->expressions[builtin->pattern - 1];
+	struct Operand *operand = &argument->operands[0];
+	if (argument->op != OP_NOP || operand->type != OPE_PRIMITIVE || operand->value->type != PRI_STRING) return NULL;
+	
+	struct RegexError error;
+	struct Regex *regex = regex_compile((struct String){operand->value->string, strlen(operand->value->string)}, &error);
+	if (!regex) {
+		if (!error.msg) cease_mem(compiler->point, err_mem_ctx);
+		cease_fmt(compiler->point, "Invalid regular expression", "Invalid regular expression: %s at offset %zu of the pattern", error.msg, error.offset);
+	}
+	return regex;
+}
+
+static void compile_leaf(struct Compiler *compiler, struct Operand *operand) {
+	struct Value value;
+	switch (operand->type) {
+		case OPE_PRIMITIVE:
+			switch (operand->value->type) {
+				case PRI_NUMBER:
+					value = (struct Value){.type = VAL_NUMBER, .number = operand->value->number};
+					break;
+				case PRI_STRING:
+					value = (struct Value){.type = VAL_STRING, .string = operand->value->string};
+					break;
+				case PRI_BOOLEAN:
+					value = (struct Value){.type = VAL_BOOLEAN, .boolean = operand->value->boolean};
+					break;
+				case PRI_INT32:
+				case PRI_INT64:
+					value = value_from_integer(operand->value->integer, operand->value->type == PRI_INT64);
+					break;
+			}
+			size_t constant = chunk_add_constant(&compiler->chunk, value);
+			if (constant == CHUNK_ERROR) cease_mem(compiler->point, err_mem_ctx);
+			emit(compiler, INS_CONST, constant);
+			break;
+		case OPE_VARIABLE:
+			emit(compiler, operand->variable->scope == SCO_LOCAL ? INS_LOAD_LOCAL : INS_LOAD_GLOBAL, operand->variable->slot);
+			break;
+		case OPE_IDENTIFIER:
+			cease_fmt(compiler->point, "Unknown identifier", "Unknown identifier '%s'", operand->identifier);
+		case OPE_EXPRESSION_LIST:
+			cease(compiler->point, "Unexpected expression list", false);
+		case OPE_EXPRESSION:
+			break;
+	}
+}
+
+static uint32_t add_cache(struct Compiler *compiler, char *key) {
+	size_t cache = chunk_add_cache(&compiler->chunk, key);
+	if (cache == CHUNK_ERROR) cease_mem(compiler->point, err_mem_ctx);
+	return cache;
+}
+
+static char *member_key(struct Operand *operand) {
+	if (operand->type == OPE_IDENTIFIER) return operand->identifier;
+	if (operand->type == OPE_PRIMITIVE && operand->value->type == PRI_STRING) return operand->value->string;
+	return NULL;
+}
+
+/* All subscripts of `$a[i][j]...` are handled by a single instruction, they are collected from the outermost one */
+static unsigned char collect_subscripts(struct Expression *expression, struct Operand *subscripts[], struct Expression **base) {
+	unsigned char count = 0;
+	*base = expression;
+	while (true) {
+		subscripts[count++] = &(*base)->operands[1];
+		struct Operand *inner = &(*base)->operands[0];
+		if (count == ARRAY_MAX_DIMENSIONS) break;
+		if (inner->type != OPE_EXPRESSION || inner->expression->op != OP_ACC) break;
+		if (member_key(&inner->expression->operands[1])) break;
+		*base = inner->expression;
+	}
+	return count;
+}
+
+static void compile_operand(struct Compiler *compiler, struct Operand *operand) {
+	if (operand->type == OPE_EXPRESSION) {
+		compile_expression(compiler, operand->expression);
+	} else {
+		compile_leaf(compiler, operand);
+	}
+}
+
+static int stack_effect(enum Opcode op, uint32_t arg) {
+	switch (op) {
+		case INS_CONST:
+		case INS_CALL:
+		case INS_LOAD_LOCAL:
+		case INS_LOAD_GLOBAL:
+		case INS_MAP:
+			return +1;
+		case INS_POP:
+		case INS_ADD:
+		case INS_SUB:
+		case INS_MUL:
+		case INS_DIV:
+		case INS_EXP:
+		case INS_CAT:
+		case INS_EQU:
+		case INS_SEQU:
+		case INS_NEQ:
+		case INS_LT:
+		case INS_LTE:
+		case INS_GT:
+		case INS_GTE:
+		case INS_JUMP_FALSE:
+		case INS_JUMP_FALSE_KEEP:
+		case INS_JUMP_TRUE_KEEP:
+		case INS_SET_MEMBER:
+		case INS_RETURN:
+			return -1;
+		case INS_INDEX:
+			return -(int) arg;
+		case INS_SET_INDEX:
+		case INS_REDIM:
+			return -(int) arg - 1;
+		case INS_ARRAY:
+			return 1 - (int) arg;
+		default:
+			return 0;
+	}
+}
+
+static void compile_statements(struct Compiler *compiler, struct Statement block[], uint32_t start, uint32_t end) {
+	for (uint32_t i = start; i < end; i = block[i].end) {
+		struct Statement *statement = &block[i];
+		switch (statement->type) {
+			case SMT_DECLARATION:
+				compile_declaration(compiler, statement->declaration);
+				break;
+			case SMT_EXPRESSION:
+				compile_expression(compiler, statement->expression);
+				emit(compiler, INS_POP, 0);
+				break;
+			case SMT_FOR:
+				compile_for(compiler, block, i);
+				break;
+			case SMT_EXIT_LOOP:
+			case SMT_CONTINUE_LOOP:
+				compile_loop_jump(compiler, statement);
+				break;
+			case SMT_REDIM:
+				compile_redim(compiler, statement->expression);
+				break;
+			default:
+				cease(compiler->point, "Statement can't be compiled yet", false);
+		}
+	}
+}
+
+static void compile_declaration(struct Compiler *compiler, struct Declaration *declaration) {
+	bool is_array = declaration->dimensions && declaration->dimensions->count;
+	if (declaration->is_function || declaration->is_static || (is_array && declaration->initializer)) {
+		cease(compiler->point, "Statement can't be compiled yet", false);
+	}
+	
+	// Variables are declared with an empty string unless they are arrays or maps
+	if (is_array) {
+		if (declaration->dimensions->count > ARRAY_MAX_DIMENSIONS) cease(compiler->point, "Too many dimensions in an array", false);
+		for (size_t i = 0; i < declaration->dimensions->count; ++i) compile_expression(compiler, &declaration->dimensions->expressions[i]);
+		emit(compiler, INS_ARRAY, declaration->dimensions->count);
+	} else if (declaration->dimensions) {
+		emit(compiler, INS_MAP, 0);
+	} else if (declaration->initializer) {
+		compile_expression(compiler, declaration->initializer);
+	} else {
+		size_t constant = chunk_add_constant(&compiler->chunk, (struct Value){.type = VAL_STRING, .string = ""});
+		if (constant == CHUNK_ERROR) cease_mem(compiler->point, err_mem_ctx);
+		emit(compiler, INS_CONST, constant);
+	}
+	emit(compiler, declaration->variable->scope == SCO_LOCAL ? INS_STORE_LOCAL : INS_STORE_GLOBAL, declaration->variable->slot);
+	emit(compiler, INS_POP, 0);
+}
+
+static void compile_for(struct Compiler *compiler, struct Statement block[], uint32_t index) {
+	struct Statement *statement = &block[index];
+	struct Operand *counter = &statement->expressions[0].operands[0];
+	if (counter->type != OPE_VARIABLE) cease(compiler->point, "Loop counter must be a variable", false);
+	enum Opcode store = counter->variable->scope == SCO_LOCAL ? INS_STORE_LOCAL : INS_STORE_GLOBAL;
+	
+	// The start, stop and step are evaluated once, in that order, and stay on the stack until the loop ends
+	for (int i = 1; i < 4; ++i) compile_expression(compiler, &statement->expressions[i]);
+	size_t prep = emit(compiler, INS_FOR_PREP, 0);
+	emit(compiler, store, counter->variable->slot);
+	
+	struct CompileLoop *loops = grow_array(compiler->loops, &compiler->loop_cap, compiler->loop_count, sizeof *loops);
+	if (!loops) cease_mem(compiler->point, err_mem_ctx);
+	compiler->loops = loops;
+	compiler->loops[compiler->loop_count++] = (struct CompileLoop){.depth = compiler->depth, .jumps = compiler->loop_jump_count};
+	
+	size_t body = compiler->chunk.code_len;
+	compile_statements(compiler, block, index + 1, statement->end);
+	patch_loop_jumps(compiler, false);
+	emit(compiler, INS_FOR_NEXT, body);
+	emit(compiler, store, counter->variable->slot);
+	patch_jump(compiler, prep);
+	patch_loop_jumps(compiler, true);
+	--compiler->loop_count;
+	
+	for (int i = 0; i < 3; ++i) emit(compiler, INS_POP, 0);
+}
+
+static void compile_loop_jump(struct Compiler *compiler, struct Statement *statement) {
+	// The level is optional, but it has to be known while compiling
+	size_t level = 1;
+	if (statement->expression) {
+		struct Operand *operand = &statement->expression->operands[0];
+		if (statement->expression->op != OP_NOP || operand->type != OPE_PRIMITIVE || operand->value->type != PRI_INT32 || operand->value->integer < 1) {
+			cease(compiler->point, "Loop level must be a positive integer", false);
+		}
+		level = operand->value->integer;
+	}
+	if (level > compiler->loop_count) cease(compiler->point, "Not enough loops to leave or continue", false);
+	size_t loop = compiler->loop_count - level;
+	
+	// The states of the inner loops are dropped, the code after the jump still sees them though
+	size_t depth = compiler->depth;
+	while (compiler->depth > compiler->loops[loop].depth) emit(compiler, INS_POP, 0);
+	compiler->depth = depth;
+	
+	struct LoopJump *jumps = grow_array(compiler->loop_jumps, &compiler->loop_jump_cap, compiler->loop_jump_count, sizeof *jumps);
+	if (!jumps) cease_mem(compiler->point, err_mem_ctx);
+	compiler->loop_jumps = jumps;
+	compiler->loop_jumps[compiler->loop_jump_count++] = (struct LoopJump){
+		.loop = loop,
+		.jump = emit(compiler, INS_JUMP, 0),
+		.is_exit = statement->type == SMT_EXIT_LOOP,
+	};
+}
+
+static void patch_loop_jumps(struct Compiler *compiler, bool is_exit) {
+	// Jumps to outer loops are kept, the ones to this loop are removed once the exits are patched
+	size_t loop = compiler->loop_count - 1;
+	size_t kept = compiler->loops[loop].jumps;
+	for (size_t i = kept; i < compiler->loop_jump_count; ++i) {
+		struct LoopJump *jump = &compiler->loop_jumps[i];
+		if (jump->loop == loop && jump->is_exit == is_exit) {
+			patch_jump(compiler, jump->jump);
+			if (is_exit) continue;
+		}
+		if (!is_exit || jump->loop != loop) compiler->loop_jumps[kept++] = *jump;
+	}
+	if (is_exit) compiler->loop_jump_count = kept;
+}
+
+/* `ReDim $a[i][j]` is parsed as an index, the subscripts are the new bounds */
+static void compile_redim(struct Compiler *compiler, struct Expression *expression) {
+	if (expression->op != OP_ACC || member_key(&expression->operands[1])) cease(compiler->point, "ReDim needs the new bounds of an array", false);
+	struct Operand *subscripts[ARRAY_MAX_DIMENSIONS];
+	struct Expression *base;
+	unsigned char count = collect_subscripts(expression, subscripts, &base);
+	struct Operand *array = &base->operands[0];
+	if (array->type == OPE_EXPRESSION && array->expression->op == OP_ACC && !member_key(&array->expression->operands[1])) {
+		cease(compiler->point, "Too many dimensions in an array", false);
+	}
+	
+	compile_operand(compiler, array);
+	for (unsigned char i = count; i-- > 0;) compile_operand(compiler, subscripts[i]);
+	emit(compiler, INS_REDIM, count);
+}
@@ -0,0 +1,67 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "cease/cease.h"
+#include "parser/tree.h"
+#include "runtime/bytecode.h"
+
+struct CompileFrame {
+	struct Expression *expression;
+	size_t stage;
+	size_t jumps[2];
+	struct Operand operand; // Scratch operand for expressions which aren't wrapped in one
+};
+
+struct CompileLoop {
+	size_t depth; // Depth of the value stack in the body
+	size_t jumps; // Index of the first jump in loop_jumps which may belong to the loop
+};
+
+/* ExitLoop and ContinueLoop, patched when the loop they refer to is closed */
+struct LoopJump {
+	size_t loop;
+	size_t jump;
+	bool is_exit;
+};
+
+struct Compiler {
+	struct Chunk chunk;
+	CeasePoint *point;
+	size_t depth; // Current depth of the value stack
+	struct CompileFrame *frames;
+	size_t frame_count;
+	size_t frame_cap;
+	struct CompileLoop *loops;
+	size_t loop_count;
+	size_t loop_cap;
+	struct LoopJump *loop_jumps;
+	size_t loop_jump_count;
+	size_t loop_jump_cap;
+};
+
+struct Chunk compile_exprlist(struct ExpressionList *list, CeasePoint *point);
+struct Chunk compile_block(struct Statement block[], size_t size, CeasePoint *point);
+void compile_expression(struct Compiler *compiler, struct Expression *expression);
+
+#endif
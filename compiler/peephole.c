@@ -0,0 +1,162 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "compiler/peephole.h"
+#include "runtime/bytecode.h"
+
+static bool is_jump(enum Opcode op);
+static bool is_boolean(enum Opcode op);
+static bool fuse(struct Instruction *first, struct Instruction second);
+
+bool peephole(struct Chunk *chunk) {
+	struct Instruction *code = chunk->code;
+	size_t len = chunk->code_len;
+	bool *targets = calloc(len + 1, sizeof *targets);
+	size_t *map = malloc(sizeof *map * (len + 1)); // Index of each instruction in the new code
+	if (!targets || !map) {
+		free(targets);
+		free(map);
+		return false;
+	}
+	
+	for (size_t i = 0; i < len; ++i) {
+		if (!is_jump(code[i].op)) continue;
+		// A jump to a jump goes to the final target right away, the hops are bounded in case of a cycle
+		for (size_t hops = 0; code[i].arg < len && code[code[i].arg].op == INS_JUMP && hops < len; ++hops) {
+			code[i].arg = code[code[i].arg].arg;
+		}
+		if (code[i].arg <= len) targets[code[i].arg] = true;
+	}
+	
+	size_t out = 0;
+	size_t fence = 0; // Instructions before it can't be changed anymore
+	for (size_t i = 0; i < len; ++i) {
+		struct Instruction instruction = code[i];
+		map[i] = out;
+		
+		// The operand word after a loop instruction stays as it is
+		if ((instruction.op == INS_FOR_PREP || instruction.op == INS_FOR_NEXT) && i + 1 < len) {
+			code[out++] = instruction;
+			map[++i] = out;
+			code[out++] = code[i];
+			fence = out;
+			continue;
+		}
+		
+		if (instruction.op == INS_JUMP && instruction.arg == i + 1) continue;
+		
+		struct Instruction *previous = out > fence && !targets[i] ? &code[out - 1] : NULL;
+		if (previous) {
+			if (instruction.op == INS_TRUTH && is_boolean(previous->op)) continue;
+			if (instruction.op == INS_POP && (previous->op == INS_CONST || previous->op == INS_LOAD_LOCAL || previous->op == INS_LOAD_GLOBAL)) {
+				// The dropped load may have been a jump target, what comes next can't be fused with what came before it
+				map[i] = --out;
+				fence = out;
+				continue;
+			}
+			// A load of the last subscript is kept for the index after it
+			bool subscript = (instruction.op == INS_LOAD_LOCAL || instruction.op == INS_LOAD_GLOBAL) && i + 1 < len && code[i + 1].op == INS_INDEX && !targets[i + 1];
+			if (!subscript && fuse(previous, instruction)) continue;
+		}
+		
+		code[out++] = instruction;
+	}
+	map[len] = out;
+	
+	for (size_t i = 0; i < out; ++i) {
+		if (!is_jump(code[i].op)) continue;
+		if (code[i].arg <= len) code[i].arg = map[code[i].arg];
+		if (code[i].op == INS_FOR_PREP || code[i].op == INS_FOR_NEXT) ++i;
+	}
+	chunk->code_len = out;
+	
+	free(targets);
+	free(map);
+	return true;
+}
+
+static bool is_jump(enum Opcode op) {
+	switch (op) {
+		case INS_JUMP:
+		case INS_JUMP_FALSE:
+		case INS_JUMP_FALSE_KEEP:
+		case INS_JUMP_TRUE_KEEP:
+		case INS_FOR_PREP:
+		case INS_FOR_NEXT:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* Instructions which always leave a Boolean, the truth of it is the same */
+static bool is_boolean(enum Opcode op) {
+	switch (op) {
+		case INS_NOT:
+		case INS_TRUTH:
+		case INS_EQU:
+		case INS_SEQU:
+		case INS_NEQ:
+		case INS_LT:
+		case INS_LTE:
+		case INS_GT:
+		case INS_GTE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * The pairs were picked by counting the pairs of instructions which run in our scripts:
+ * two loads in a row, the store of an assignment statement followed by the pop of its
+ * value, a constant as the right operand of an addition or subtraction, and a variable
+ * as the last subscript of an index.
+ */
+static bool fuse(struct Instruction *first, struct Instruction second) {
+	switch (first->op) {
+		case INS_LOAD_LOCAL:
+		case INS_LOAD_GLOBAL:
+			if (second.op == INS_INDEX) {
+				if (first->arg >> INDEX_SLOT_BITS) return false;
+				first->op = first->op == INS_LOAD_LOCAL ? INS_LOAD_LOCAL_INDEX : INS_LOAD_GLOBAL_INDEX;
+				first->arg |= second.arg << INDEX_SLOT_BITS;
+				return true;
+			}
+			if (second.op != first->op || first->arg > UINT16_MAX || second.arg > UINT16_MAX) return false;
+			first->op = first->op == INS_LOAD_LOCAL ? INS_LOAD_LOCAL_PAIR : INS_LOAD_GLOBAL_PAIR;
+			first->arg |= second.arg << 16;
+			return true;
+		case INS_STORE_LOCAL:
+		case INS_STORE_GLOBAL:
+			if (second.op != INS_POP) return false;
+			first->op = first->op == INS_STORE_LOCAL ? INS_STORE_LOCAL_POP : INS_STORE_GLOBAL_POP;
+			return true;
+		case INS_CONST:
+			if (second.op != INS_ADD && second.op != INS_SUB) return false;
+			first->op = second.op == INS_ADD ? INS_ADD_CONST : INS_SUB_CONST;
+			return true;
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,34 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPILER_PEEPHOLE_H
+#define COMPILER_PEEPHOLE_H
+
+#include <stdbool.h>
+#include "runtime/bytecode.h"
+
+/*
+ * Rewrites the finished code of a chunk in place: jumps to jumps are threaded, instructions
+ * which don't do anything are dropped and the hottest pairs of instructions are fused into
+ * superinstructions. Nothing is fused across a jump target. False if memory ran out, the
+ * code is untouched then.
+ */
+bool peephole(struct Chunk *chunk);
+
+#endif
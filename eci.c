@@ -17,72 +17,256 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdnoreturn.h>
 #include <string.h>
+#include <time.h>
 #include "utils.h"
+#include "cease/cease.h"
+#include "compiler/compiler.h"
+#include "parser/deps.h"
+#include "parser/include.h"
 #include "parser/parser.h"
+#include "parser/resolve.h"
+#include "parser/source.h"
+#include "runtime/heap.h"
+#include "runtime/value.h"
+#include "runtime/vm.h"
+#include "watch/watch.h"
+
+// Every file is only read from the disk once, watch mode forgets the ones which change
+struct SourceCache {
+	char *name;
+	char *code;
+	size_t size;
+	bool once; // Seen with #include-once in the current parse
+};
+
+static struct SourceCache *sources = NULL;
+static size_t sources_len = 0, sources_cap = 0;
+
+static struct Watcher watcher;
+static bool watching; // Files which can't be opened are left out instead of ending eci, watch mode waits for them
+static struct VM vm;
+
+static const char *type_names[] = {
+	[VAL_EMPTY] = "Empty",
+	[VAL_NUMBER] = "Double",
+	[VAL_STRING] = "String",
+	[VAL_BOOLEAN] = "Bool",
+	[VAL_ARRAY] = "Array",
+	[VAL_MAP] = "Map",
+	[VAL_INT32] = "Int32",
+	[VAL_INT64] = "Int64",
+};
+
+static struct SourceCache *load_source(char *file) {
+	for (size_t i = 0; i < sources_len; ++i) {
+		if (strcmp(sources[i].name, file) == 0) return &sources[i];
+	}
+	
+	// Open the source file, includes are resolved before they are read so this is the script itself
+	FILE *source_file = fopen(file, "r");
+	if (!source_file) {
+		if (!watching) die("Failed to open source file!");
+		return NULL;
+	}
+	
+	// Read the source file
+	char *code = readfile(source_file);
+	fclose(source_file);
+	if (!code) die("Failed to read from source file!");
+	
+	struct SourceCache *new_sources = grow_array(sources, &sources_cap, sources_len, sizeof *sources);
+	if (!new_sources) die("Failed to cache source file!");
+	sources = new_sources;
+	struct SourceCache *source = &sources[sources_len];
+	*source = (struct SourceCache){.name = strdup(file), .code = code, .size = strlen(code)};
+	if (!source->name) die("Failed to cache source file!");
+	++sources_len;
+	return source;
+}
 
 static char *provide_code(char *file, size_t *size, bool once) {
-	static char **once_list = NULL;
-	static size_t once_list_len = 0;
+	struct SourceCache *source = load_source(file);
+	if (!source) return NULL;
 	if (once) {
 		// Add the file to "include once" list
-		if (!once_list) {
-			once_list = malloc(sizeof(char *));
-			if (!once_list) return NULL;
-			++once_list_len;
-		} else {
-			char **expanded_list = realloc(once_list, sizeof(char *) * ++once_list_len);
-			if (!expanded_list) {
-				--once_list_len;
-				return NULL;
-			}
-			once_list = expanded_list;
-		}
-		once_list[once_list_len - 1] = strdup(file);
-		
+		source->once = true;
 		return NULL;
-	} else {
-		// Skip if the file is in the "include once" list
-		for (size_t i = 0; i < once_list_len; ++i) {
-			if (strcmp(once_list[i], file) == 0) return NULL;
-		}
 	}
 	
-	// Open the source file
-	char *code;
-	FILE *source_file = fopen(file, "r");
-	if (source_file) {
-		// Read the source file
-		code = readfile(source_file);
-		fclose(source_file);
-		if (!code) die("Failed to read from source file!");
-	} else {
-		code = malloc(1);
-		code[0] = '\0';
-	}
+	// Skip if the file is in the "include once" list
+	if (source->once) return NULL;
 	
 	// The following is required because the parser needs a string with two null terminators
-	*size = strlen(code);
-	char *code_padded = realloc(code, *size + 2);
-	if (!code_padded) {
-		free(code);
-		die("Failed to expand code buffer");
+	char *code = malloc(source->size + 2);
+	if (!code) die("Failed to expand code buffer");
+	memcpy(code, source->code, source->size + 1);
+	code[source->size + 1] = '\0';
+	*size = source->size;
+	
+	return code;
+}
+
+static void forget_source(char *file) {
+	for (size_t i = 0; i < sources_len; ++i) {
+		if (strcmp(sources[i].name, file) != 0) continue;
+		free(sources[i].name);
+		free(sources[i].code);
+		sources[i] = sources[--sources_len];
+		break;
+	}
+	
+	// A file which was added or removed can change where an include is found
+	include_forget();
+}
+
+static noreturn void watch(char *file) {
+	if (!watch_init(&watcher)) die("Failed to watch for changes!");
+	watching = true;
+	for (;;) {
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		
+		// The script may be gone for a moment while it is saved, or for good until it is put back
+		if (!load_source(file)) {
+			fprintf(stderr, "Failed to open %s: %s, watching for it to come back...\n", file, strerror(errno));
+			if (!watch_file(&watcher, file)) die("Failed to watch the source file!");
+			if (!watch_wait(&watcher, forget_source)) die("Failed to wait for changes!");
+			continue;
+		}
+		
+		// Only the files which changed are read again, the others come from the cache
+		for (size_t i = 0; i < sources_len; ++i) sources[i].once = false;
+		Allocator *allocator = parse(file, provide_code);
+		struct Diagnostic *diagnostics = parser_diagnostics();
+		print_diagnostics(diagnostics);
+		if (allocator) {
+			size_t size;
+			struct Statement *unit = parser_unit(&size);
+			print_block(unit, size);
+			alloc_free_all(allocator);
+		}
+		source_free();
+		
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double time = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+		fflush(stdout);
+		fprintf(stderr, "%s in %.2f ms, watching for changes...\n", diagnostics ? "Errors" : "No errors", time);
+		
+		// Includes which were just added are watched from now on too
+		for (size_t i = 0; i < sources_len; ++i) {
+			if (!watch_file(&watcher, sources[i].name)) die("Failed to watch a source file!");
+		}
+		if (!watch_wait(&watcher, forget_source)) die("Failed to wait for changes!");
+	}
+}
+
+static int write_deps(char *file, char *target) {
+	// Only the includes are scanned, the script isn't parsed
+	struct DependencyList deps = {.files = NULL};
+	if (!deps_scan(file, provide_code, &deps)) die("Failed to scan the includes!");
+	deps_write(stdout, target, &deps);
+	deps_free(&deps);
+	return EXIT_SUCCESS;
+}
+
+static void print_globals(struct SymbolTable *globals) {
+	// In the order of the slots, which is the order in which the script first uses them
+	char **names = calloc(globals->slots, sizeof *names);
+	if (globals->slots && !names) die("Failed to list the global variables!");
+	for (size_t i = 0; i < globals->capacity; ++i) {
+		if (globals->entries[i].name) names[globals->entries[i].slot] = globals->entries[i].name;
+	}
+	for (size_t slot = 0; slot < globals->slots; ++slot) {
+		struct Value *value = &vm.globals[slot];
+		char buffer[VALUE_STRING_BUFFER_SIZE];
+		printf("$%s %s %s\n", names[slot], type_names[value->type], value_to_string(value, buffer));
 	}
-	code_padded[*size + 1] = '\0';
+	free(names);
+}
+
+static int run(char *file, bool jit) {
+	Allocator *allocator = parse(file, provide_code);
+	struct Diagnostic *diagnostics = parser_diagnostics();
+	print_diagnostics(diagnostics);
+	if (!allocator || diagnostics) return EXIT_FAILURE;
+	
+	size_t size;
+	struct Statement *unit = parser_unit(&size);
+	struct SymbolTable *globals = parser_globals();
+	vm.globals = calloc(globals->slots ? globals->slots : 1, sizeof *vm.globals);
+	if (!vm.globals) die("Failed to allocate the global variables!");
+	vm.jit = jit;
+	
+	// Errors while compiling or running the script end it
+	CeasePoint point = cease_get_point();
+	vm.point = &point;
+	if (setjmp(point.jump)) die(point.msg);
+	struct Chunk chunk = compile_block(unit, size, &point);
+	vm_run(&vm, &chunk, NULL);
 	
-	return code_padded;
+	// Only the globals are left to keep objects alive, everything else is garbage by now, cycles too
+	if (!heap_collect(NULL, 0, true)) die("Failed to collect the garbage!");
+	print_globals(globals);
+	printf("Objects left on the heap: %zu\n", heap_stats().objects);
+	chunk_free(&chunk);
+	alloc_free_all(allocator);
+	return EXIT_SUCCESS;
 }
 
 int main(int argc, char *argv[]) {
 	if (argc < 2) die("No arguments!");
 	
+	// eci [-I <dir>]... [--deps | --watch | --run [--jit | --no-jit]] <script> [target]
+	bool deps = false, watch_mode = false, run_mode = false, jit = true;
+	char *args[2];
+	size_t args_len = 0;
+	for (int i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "-I", 2) == 0) {
+			// Include directories are searched in the order they are given
+			char *dir = argv[i][2] ? argv[i] + 2 : argv[++i];
+			if (!dir) die("No include directory after -I!");
+			if (!include_add_dir(dir)) die("Failed to add include directory!");
+		} else if (strcmp(argv[i], "--deps") == 0) {
+			deps = true;
+		} else if (strcmp(argv[i], "--watch") == 0) {
+			watch_mode = true;
+		} else if (strcmp(argv[i], "--run") == 0) {
+			run_mode = true;
+		} else if (strcmp(argv[i], "--jit") == 0 || strcmp(argv[i], "--no-jit") == 0) {
+			jit = argv[i][2] == 'j';
+		} else if (args_len < lenof(args)) {
+			args[args_len++] = argv[i];
+		} else {
+			die("Too many arguments!");
+		}
+	}
+	if (!args_len) die("No script!");
+	
+	// --deps: Print a depfile with the files included by the script
+	if (deps) return write_deps(args[0], args_len > 1 ? args[1] : args[0]);
+	
+	// --watch: Parse the script again whenever it or one of its includes changes
+	if (watch_mode) watch(args[0]);
+	
+	// --run: Run the script and print the global variables it leaves behind
+	if (run_mode) return run(args[0], jit);
+	
 	// Parse the code
-	//scan(argv[1], provide_code);
-	parse(argv[1], provide_code);
+	//scan(args[0], provide_code);
+	Allocator *allocator = parse(args[0], provide_code);
+	struct Diagnostic *diagnostics = parser_diagnostics();
+	print_diagnostics(diagnostics);
+	if (allocator) {
+		size_t size;
+		struct Statement *unit = parser_unit(&size);
+		print_block(unit, size);
+	}
 	
-	return EXIT_SUCCESS;
+	return diagnostics ? EXIT_FAILURE : EXIT_SUCCESS;
 }
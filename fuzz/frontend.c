@@ -0,0 +1,56 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/* Fuzz target for the parser, or just the lexer when built with FUZZ_SCAN, see fuzz/harness.c */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alloc/alloc.h"
+#include "fuzz/fuzz.h"
+#include "parser/parser.h"
+#include "parser/source.h"
+
+static char *fuzz_code;
+static size_t fuzz_size;
+
+static char *provide_fuzz_code(char *file, size_t *size, bool once) {
+	(void) file;
+	// Only the input itself can be read, and only once so it can't include itself forever
+	if (once || !fuzz_code) return NULL;
+	char *code = malloc(fuzz_size + 2);
+	if (!code) return NULL;
+	memcpy(code, fuzz_code, fuzz_size + 2);
+	*size = fuzz_size;
+	fuzz_code = NULL;
+	return code;
+}
+
+void fuzz_target(char *code, size_t size) {
+	fuzz_code = code;
+	fuzz_size = size;
+#ifdef FUZZ_SCAN
+	scan("fuzz.au3", provide_fuzz_code);
+#else
+	Allocator *allocator = parse("fuzz.au3", provide_fuzz_code);
+	if (allocator) alloc_free_all(allocator);
+#endif
+	source_free();
+}
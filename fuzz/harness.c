@@ -0,0 +1,125 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Fuzzing harness shared by all the fuzz targets
+ * 
+ * It provides the libFuzzer entry points (which AFL++ can also drive) or, when
+ * built with FUZZ_STANDALONE, a main() that runs every file given to it.
+ * 
+ * Setting ECI_FUZZ_SCALING turns on the performance mode: every input is also
+ * repeated SCALING_REPEAT times and the target aborts if the repeated input
+ * takes more than ECI_FUZZ_SCALING (default 4) times longer per byte, so that
+ * the fuzzer keeps the input which triggered the super-linear behaviour.
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fuzz/fuzz.h"
+#include "utils.h"
+
+#define SCALING_REPEAT 8
+#define SCALING_RUNS 3 // The fastest run is used to filter out noise
+#define SCALING_MIN_TIME 1e-3 // Shorter times are too noisy to compare
+
+static double scaling_factor = 0;
+
+static double run_target(const uint8_t *data, size_t size, size_t repeat) {
+	size_t code_size = size * repeat;
+	char *code = malloc(code_size + 2);
+	if (!code) die("Failed to allocate memory for the fuzzing input");
+	for (size_t i = 0; i < repeat; ++i) memcpy(code + size * i, data, size);
+	code[code_size] = code[code_size + 1] = '\0';
+	
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	fuzz_target(code, code_size);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	
+	free(code);
+	return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static double fastest_run(const uint8_t *data, size_t size, size_t repeat) {
+	double fastest = run_target(data, size, repeat);
+	for (int i = 1; i < SCALING_RUNS; ++i) {
+		double time = run_target(data, size, repeat);
+		if (time < fastest) fastest = time;
+	}
+	return fastest;
+}
+
+int LLVMFuzzerInitialize(int *argc, char ***argv) {
+	(void) argc;
+	(void) argv;
+	
+	// The targets print what they scan and parse, it is of no use here and would only slow them down
+	if (!freopen("/dev/null", "w", stdout)) die("Failed to discard the standard output");
+	
+	char *scaling = getenv("ECI_FUZZ_SCALING");
+	if (scaling) {
+		scaling_factor = strtod(scaling, NULL);
+		if (scaling_factor <= 1) scaling_factor = 4;
+	}
+	return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	if (!scaling_factor || !size) {
+		run_target(data, size, 1);
+		return 0;
+	}
+	
+	double single = fastest_run(data, size, 1);
+	double repeated = fastest_run(data, size, SCALING_REPEAT);
+	if (repeated < SCALING_MIN_TIME) return 0;
+	
+	double single_per_byte = single / size;
+	double repeated_per_byte = repeated / (size * SCALING_REPEAT);
+	if (repeated_per_byte > single_per_byte * scaling_factor) {
+		fprintf(stderr,
+			"Super-linear input: %zu bytes took %.3f ns per byte but %zu bytes took %.3f ns per byte\n",
+			size, single_per_byte * 1e9, size * SCALING_REPEAT, repeated_per_byte * 1e9
+		);
+		abort();
+	}
+	return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+int main(int argc, char *argv[]) {
+	LLVMFuzzerInitialize(&argc, &argv);
+	for (int i = 1; i < argc; ++i) {
+		FILE *file = fopen(argv[i], "rb");
+		if (!file) die("Failed to open input file!");
+		char *input = readfile(file);
+		fclose(file);
+		if (!input) die("Failed to read from input file!");
+		LLVMFuzzerTestOneInput((uint8_t *) input, strlen(input));
+		free(input);
+	}
+	return EXIT_SUCCESS;
+}
+#endif
@@ -0,0 +1,35 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/* Fuzz target for the tokenizer of the legacy parser in parse.c, see fuzz/harness.c */
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include "fuzz/fuzz.h"
+#include "parse.h"
+
+void fuzz_target(char *code, size_t size) {
+	(void) size;
+	if (setjmp(parse_error.jump)) return;
+	struct TokenList list = token_get_list(code);
+	free(list.tokens);
+	free(list.numbers);
+}
@@ -23,13 +23,17 @@
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdnoreturn.h>
 #include <string.h>
 #include "parse.h"
+#include "parser/number.h"
 #include "utils.h"
 
+_Static_assert(sizeof(struct Token) == 16, "Size of a token");
+
 const char CHR_COMMENT = ';';
 const char CHR_DIRECTIVE = '#';
 const char CHR_MACRO = '@';
@@ -106,13 +110,9 @@ struct KeywordMap KEYWORD_MAP[] = {
 	{"Not", KWD_NOT},
 };
 
-struct {
-	jmp_buf jump;
-	char *msg;
-	bool free_msg;
-} parse_error = {.free_msg = false};
+struct ParseError parse_error = {.free_msg = false};
 
-static void print_token(struct Token *token) {
+static void print_token(struct TokenList *list, struct Token *token) {
 	puts("---### TOKEN ###---");
 	char *token_type;
 	switch (token->type) {
@@ -172,7 +172,7 @@ static void print_token(struct Token *token) {
 			break;
 		default:
 			print_raw_data:
-			for (size_t c = 0; c < token->data_len; c++) putchar(token->data[c]);
+			fwrite(token_data(list, token), 1, token->data_len, stdout);
 	}
 	putchar('\n');
 }
@@ -182,23 +182,18 @@ bool parse(char *code) {
 	
 	struct TokenList token_list = token_get_list(code);
 	if (!token_list.length) raise_mem("generating token list");
-	struct TokenListNode *token_list_node = token_list.head;
 	
 	if (token_list.dirty) fputs("!!! WARNING: Unknown token(s) encountered !!!\n", stderr);
-	do {
-		struct Token *token = token_list_node->token;
-		if (token->type != TOK_WHITESPACE) print_token(token);
-		token_list_node = token_list_node->next;
-	} while (token_list_node);
-}
-
-struct Token token_get(char *code, char **next) {
-	struct Token token = {
-		.type = TOK_UNKNOWN,
-		.data = NULL,
-		.data_len = 0,
-		.info = NULL,
-	};
+	for (size_t i = 0; i < token_list.length; ++i) {
+		struct Token *token = &token_list.tokens[i];
+		if (token->type != TOK_WHITESPACE) print_token(&token_list, token);
+	}
+}
+
+struct Token token_get(struct TokenList *list, char *code, char **next) {
+	struct Token token = {.type = TOK_UNKNOWN};
+	char *data = NULL;
+	size_t data_len = 0;
 	size_t length;
 	char *next_code = NULL;
 	
@@ -206,13 +201,13 @@ struct Token token_get(char *code, char **next) {
 	if (length = scan_string(code, char_is_whitespace)) {
 		// Whitespace
 		token.type = TOK_WHITESPACE;
-		token.data = code;
-		token.data_len = length;
+		data = code;
+		data_len = length;
 	} else if (*code == CHR_COMMENT || *code == CHR_DIRECTIVE) {
 		// Comment or Directive
 		token.type = *code == CHR_COMMENT ? TOK_COMMENT : TOK_DIRECTIVE;
-		token.data = ++code;
-		token.data_len = scan_string(code, char_is_not_eol);
+		data = ++code;
+		data_len = scan_string(code, char_is_not_eol);
 		
 		// Check if this is a multi-line comment
 		bool multiline_comment = false;
@@ -228,13 +223,13 @@ struct Token token_get(char *code, char **next) {
 			}
 			if (multiline_comment) {
 				token.type = TOK_COMMENT;
-				token.data = code = comment_start;
+				data = code = comment_start;
 			}
 		}
 		
 		if (multiline_comment) {
 			// Scan for the ending directive token
-			char *comment_end;
+			char *comment_end = NULL;
 			size_t level = 1;
 			while (true) {
 				while (*++code != '\0') if (*code == CHR_DIRECTIVE) break;
@@ -242,7 +237,7 @@ struct Token token_get(char *code, char **next) {
 				
 				bool match_short, match_long = false, match = false;
 				bool begin = false, end = false;
-				++code;
+				if (*++code == '\0') break;
 				match_short = (
 					(end = strncasecmp(STRING_CE, code, (sizeof STRING_CE) - 1) == 0)
 					||
@@ -261,39 +256,37 @@ struct Token token_get(char *code, char **next) {
 				if (match) level += begin ? +1 : -1;
 				if (!level) break;
 			}
-			token.data_len = (code - token.data) - 1;
-			next_code = comment_end;
+			// A block which isn't closed runs to the end of the code
+			data_len = (code - data) - (level ? 0 : 1);
+			next_code = level ? code : comment_end;
 		} else {
-			token.data_len = scan_string(code, char_is_not_eol);
+			data_len = scan_string(code, char_is_not_eol);
 		}
 	} else if (length = scan_number(code)){
 		// Number
 		token.type = TOK_NUMBER;
-		token.data = code;
-		token.data_len = length;
+		data = code;
+		data_len = length;
 		
-		// Parse the number
-		char boundary_char = code[length];
-		code[length] = '\0';
-		token.number = strtod(code, NULL);
-		code[length] = boundary_char;
+		// Parse the number, token_get_list makes room for it
+		token.number = list->number_count;
+		list->numbers[list->number_count++] = number_from_str(code, length);
 	} else if (chrcmp(*code, CHRSET_QUOTE, sizeof CHRSET_QUOTE)) {
 		// String
 		token.type = TOK_STRING;
 		token.quote = *code;
-		token.data = code + 1;
-		for (token.data_len = 0; token.data[token.data_len] != '\0' && (token.data[token.data_len] != token.quote || (token.data[token.data_len + 1] == token.quote ? ++token.data_len : false)); ++token.data_len);
-		next_code = token.data + token.data_len + 1;
+		data = code + 1;
+		for (data_len = 0; data[data_len] != '\0' && (data[data_len] != token.quote || (data[data_len + 1] == token.quote ? ++data_len : false)); ++data_len);
+		next_code = data + data_len + 1;
 	} else if (length = scan_string(code, char_is_alphanum)){
 		// Word
 		token.type = TOK_WORD;
-		token.data = code;
-		token.data_len = length;
+		data = code;
+		data_len = length;
 		token.keyword = KWD_NONE;
 		
 		// Identify keywords
 		for (size_t i = 0; i < sizeof KEYWORD_MAP / sizeof(struct KeywordMap); ++i) if (strncmp(KEYWORD_MAP[i].string, code, length) == 0) {
-			token.info = &(KEYWORD_MAP[i].symbol);
 			token.keyword = KEYWORD_MAP[i].symbol;
 			break;
 		}
@@ -311,23 +304,23 @@ struct Token token_get(char *code, char **next) {
 	} else if (*code == CHR_MACRO || *code == CHR_VARIABLE){
 		// Macro or Variable
 		token.type = *code == CHR_MACRO ? TOK_MACRO : TOK_VARIABLE;
-		token.data = ++code;
-		token.data_len = scan_string(code, char_is_alphanum);
+		data = ++code;
+		data_len = scan_string(code, char_is_alphanum);
 	} else if (char_is_opsym(*code)) {
 		// Operator
 		token.type = TOK_OPERATOR;
-		token.data = code;
+		data = code;
 		token.op_info.sym = opsym_to_opr(*code);
 		
 		// Include the trailing `=` if possible
 		bool equable = code[1] == '=' && chrcmp(*code, CHRSET_OPERATOR_EQUABLE, sizeof CHRSET_OPERATOR_EQUABLE);
 		if (equable) {
-			token.data_len = 2;
+			data_len = 2;
 			//token.equal_op = token.op;
 			token.op_info.sym = OPR_EQU;
 			token.op_info.op = OP_EQU;
 		} else {
-			token.data_len = 1;
+			data_len = 1;
 		}
 		
 		// Assign the operation
@@ -343,63 +336,63 @@ struct Token token_get(char *code, char **next) {
 	} else if (char_is_bracket(*code)) {
 		// Bracket (Parenthesis)
 		token.type = TOK_BRACKET;
-		token.data = code;
-		token.data_len = 1;
+		token.bracket = *code;
+		data = code;
+		data_len = 1;
 	} else if (*code == CHR_DOT) {
 		// Dot (Full Stop)
 		token.type = TOK_DOT;
-		token.data = code;
-		token.data_len = 1;
+		data = code;
+		data_len = 1;
 	} else if (*code == CHR_COMMA) {
 		// Comma
 		token.type = TOK_COMMA;
-		token.data = code;
-		token.data_len = 1;
+		data = code;
+		data_len = 1;
 	} else {
 		// Unknown
-		token.data = code;
-		token.data_len = 1;
+		data = code;
+		data_len = 1;
 	}
 	
 	// Set the next code
 	if (next_code) {
 		*next = *next_code == '\0' ? NULL : next_code;
 	} else {
-		code += token.data_len;
+		code += data_len;
 		*next = *code == '\0' ? NULL : code;
 	}
 	
 	// Return the token
+	token.offset = data - list->code;
+	token.data_len = data_len;
 	return token;
 }
 
 struct TokenList token_get_list(char *code) {
-	struct TokenList list = {.length = 0, .dirty = false};
+	struct TokenList list = {.length = 0, .dirty = false, .code = code};
+	
+	// Offsets and lengths of tokens are 32-bit
+	if (strlen(code) > UINT32_MAX) raise_error("Code is too large to parse, the limit is 4 GiB", false);
 	
 	while (code) {
-		struct Token *token = malloc(sizeof(struct Token));
-		if (!token) goto end;
+		// Any token may be a number
+		struct Token *tokens = grow_array(list.tokens, &list.cap, list.length, sizeof *tokens);
+		if (tokens) list.tokens = tokens;
+		double *numbers = tokens ? grow_array(list.numbers, &list.number_cap, list.number_count, sizeof *numbers) : NULL;
+		if (!numbers) {
+			free(list.tokens);
+			free(list.numbers);
+			raise_mem("generating token list");
+		}
+		list.numbers = numbers;
 		
-		*token = token_get(code, &code);
+		struct Token *token = &list.tokens[list.length++];
+		*token = token_get(&list, code, &code);
 		if (token->type == TOK_UNKNOWN) list.dirty = true;
-		
-		struct TokenListNode *new_node = malloc(sizeof(struct TokenListNode));
-		if (!new_node) goto end;
-		if (list.tail) {
-			list.tail->next = new_node;
-			new_node->prev = list.tail;
-			list.tail = new_node;
-		} else {
-			list.head = new_node;
-			list.tail = new_node;
-			new_node->prev = NULL;
-		}
-		new_node->token = token;
-		new_node->next = NULL;
-		list.length += 1;
 	}
 	
-	end: return list;
+	return list;
 };
 
 struct Token *token_list_to_array(struct TokenList *list, bool pad) {
@@ -407,23 +400,19 @@ struct Token *token_list_to_array(struct TokenList *list, bool pad) {
 	if (!tokens) return NULL;
 	if (pad) /* Reserve first element for padding */ ++tokens;
 	
-	struct TokenListNode *node = list->head;
-	for (size_t i = 0; i < list->length; ++i) {
-		tokens[i] = *node->token;
-		node = node->next;
-	}
+	if (list->length) memcpy(tokens, list->tokens, sizeof(struct Token) * list->length);
 	
 	if (pad) {
 		// Apply padding
 		//struct Token padding = {.type = TOK_EOF};
 		tokens[list->length] = (struct Token){
 			.type = TOK_EOF,
-			.data = list->tail->token->data + list->tail->token->data_len,
+			.offset = list->tokens[list->length - 1].offset + list->tokens[list->length - 1].data_len,
 			.data_len = 0,
 		};
 		*--tokens = (struct Token){
 			.type = TOK_EOF,
-			.data = list->head->token->data,
+			.offset = list->tokens[0].offset,
 			.data_len = 0,
 		};
 	}
@@ -431,6 +420,14 @@ struct Token *token_list_to_array(struct TokenList *list, bool pad) {
 	return tokens;
 }
 
+char *token_data(struct TokenList *list, struct Token *token) {
+	return list->code + token->offset;
+}
+
+double token_number(struct TokenList *list, struct Token *token) {
+	return list->numbers[token->number];
+}
+
 enum Operator opsym_to_opr(char sym) {
 	enum Operator opr = OPR_ERR;
 	switch (sym) {
@@ -640,18 +637,18 @@ bool char_is_not_eol(char chr) {
 	return chr != '\n' && chr != '\0';
 }
 
-struct Primitive primitive_get(struct Token *token) {
+struct Primitive primitive_get(struct TokenList *list, struct Token *token) {
 	struct Primitive value;
 	
 	switch (token->type) {
 		case TOK_NUMBER:
 			value.type = PRI_NUMBER;
-			value.number = token->number;
+			value.number = token_number(list, token);
 			break;
 		case TOK_STRING:
 			value.type = PRI_STRING;
 			value.string = malloc(token->data_len + 1);
-			strncpy(value.string, token->data, token->data_len);
+			strncpy(value.string, token_data(list, token), token->data_len);
 			break;
 		case TOK_BOOL:
 			// FIXME: Parse booleans
@@ -668,7 +665,7 @@ bool kwd_is_declarator(enum Keyword kwd) {
 	return false;
 }
 
-struct Expression expression_get(struct Token *tokens, size_t count) {
+struct Expression expression_get(struct TokenList *list, struct Token *tokens, size_t count) {
 	struct Expression expression = {.op = OP_NOP};
 	
 	// Calculate the number of actual tokens (anything not a whitespace)
@@ -687,14 +684,14 @@ struct Expression expression_get(struct Token *tokens, size_t count) {
 	enum Precedence precedence = PRE__START;
 	bool success;
 	do {
-		success = expression_parse(actual_tokens, actual_count, --precedence, &expression);
+		success = expression_parse(list, actual_tokens, actual_count, --precedence, &expression);
 		if (expression.op == OP_ERR) raise_error("Unable to parse expression", false);
 	} while (!success);
 	
 	return expression;
 }
 
-bool expression_parse(struct Token *token, size_t count, enum Precedence precedence, struct Expression *expression) {
+bool expression_parse(struct TokenList *list, struct Token *token, size_t count, enum Precedence precedence, struct Expression *expression) {
 	static char *err_mem_ctx = "parsing expression";
 	
 	size_t operand_count = 2;
@@ -707,7 +704,7 @@ bool expression_parse(struct Token *token, size_t count, enum Precedence precede
 		
 		term->value = malloc(sizeof(struct Primitive));
 		if (!term->value) raise_mem(err_mem_ctx);
-		*term->value = primitive_get(token);
+		*term->value = primitive_get(list, token);
 		
 		expression->operands = term;
 	} else {
@@ -717,40 +714,40 @@ bool expression_parse(struct Token *token, size_t count, enum Precedence precede
 				if (token->type != TOK_OPERATOR || token->op_info.sym != OPR_SUB) return false;
 				expression->op = OP_INV;
 				expression->operands = expression_alloc_operands(operand_count = 1);
-				*expression->operands[0].expression = expression_get(token + 1, count - 1);
+				*expression->operands[0].expression = expression_get(list, token + 1, count - 1);
 				break;
 			case PRE_NEG:
 				if (token->type != TOK_WORD || token->keyword != KWD_NOT) return false;
 				expression->op = OP_NOT;
 				expression->operands = expression_alloc_operands(operand_count = 1);
-				*expression->operands[0].expression = expression_get(token + 1, count - 1);
+				*expression->operands[0].expression = expression_get(list, token + 1, count - 1);
 				break;
 			case PRE_EXP:
-				op_token = expression_parse_infix_binary(token, count, (enum Operator []){OPR_EXP}, 1, false, expression);
+				op_token = expression_parse_infix_binary(list, token, count, (enum Operator []){OPR_EXP}, 1, false, expression);
 				if (!op_token) return false;
 				break;
 			case PRE_MUL_DIV:
-				op_token = expression_parse_infix_binary(token, count, (enum Operator []){OPR_MUL, OPR_DIV}, 2, true, expression);
+				op_token = expression_parse_infix_binary(list, token, count, (enum Operator []){OPR_MUL, OPR_DIV}, 2, true, expression);
 				if (!op_token) return false;
 				break;
 			case PRE_ADD_SUB:
-				op_token = expression_parse_infix_binary(token, count, (enum Operator []){OPR_ADD, OPR_SUB}, 2, true, expression);
+				op_token = expression_parse_infix_binary(list, token, count, (enum Operator []){OPR_ADD, OPR_SUB}, 2, true, expression);
 				if (!op_token) return false;
 				break;
 			case PRE_CAT:
-				op_token = expression_parse_infix_binary(token, count, (enum Operator []){OPR_CAT}, 1, true, expression);
+				op_token = expression_parse_infix_binary(list, token, count, (enum Operator []){OPR_CAT}, 1, true, expression);
 				if (!op_token) return false;
 				break;
 			case PRE_COMP:
-				op_token = expression_parse_comp(token, count, expression);
+				op_token = expression_parse_comp(list, token, count, expression);
 				if (!op_token) return false;
 				break;
 			case PRE_CONJ:
-				op_token = expression_parse_infix_binary(token, count, (enum Operator []){OPR_AND, OPR_OR}, 2, true, expression);
+				op_token = expression_parse_infix_binary(list, token, count, (enum Operator []){OPR_AND, OPR_OR}, 2, true, expression);
 				if (!op_token) return false;
 				break;
 			case PRE_ASS:
-				op_token = expression_parse_assign(token, count, expression);
+				op_token = expression_parse_assign(list, token, count, expression);
 				if (!op_token) return false;
 				break;
 			default:
@@ -771,18 +768,18 @@ bool expression_parse(struct Token *token, size_t count, enum Precedence precede
 	return true;
 }
 
-struct Token *expression_parse_infix_binary(struct Token *tokens, size_t count, enum Operator opr_list[], size_t opr_count, bool left, struct Expression *expression) {
+struct Token *expression_parse_infix_binary(struct TokenList *list, struct Token *tokens, size_t count, enum Operator opr_list[], size_t opr_count, bool left, struct Expression *expression) {
 	if (count < 3) return false;
 	struct Token *op_token = find_token_by_opr(tokens, count, opr_list, opr_count, left);
 	if (!op_token) return NULL;
 	expression->op = opr_to_op(op_token->op_info.sym);
 	expression->operands = expression_alloc_operands(2);
-	*expression->operands[0].expression = expression_get(tokens, op_token - tokens);
-	*expression->operands[1].expression = expression_get(op_token + 1, count - (op_token - tokens) - 1);
+	*expression->operands[0].expression = expression_get(list, tokens, op_token - tokens);
+	*expression->operands[1].expression = expression_get(list, op_token + 1, count - (op_token - tokens) - 1);
 	return op_token;
 }
 
-struct Token *expression_parse_comp(struct Token *tokens, size_t count, struct Expression *expression) {
+struct Token *expression_parse_comp(struct TokenList *list, struct Token *tokens, size_t count, struct Expression *expression) {
 	if (count < 3) return false;
 	struct Token *op_token = find_token_by_opr(tokens, count, (enum Operator []){OPR_GRT, OPR_LES, OPR_EQU}, 3, true);
 	if (!op_token) return false;
@@ -815,8 +812,8 @@ struct Token *expression_parse_comp(struct Token *tokens, size_t count, struct E
 		} else return NULL;
 		
 		expression->operands = expression_alloc_operands(2);
-		*expression->operands[0].expression = expression_get(tokens, op_token - tokens);
-		*expression->operands[1].expression = expression_get(op_token + 2, count - ((op_token + 1) - tokens) - 1);
+		*expression->operands[0].expression = expression_get(list, tokens, op_token - tokens);
+		*expression->operands[1].expression = expression_get(list, op_token + 2, count - ((op_token + 1) - tokens) - 1);
 	} else {
 		switch (op_token->op_info.sym) {
 			case OPR_EQU:
@@ -837,15 +834,15 @@ struct Token *expression_parse_comp(struct Token *tokens, size_t count, struct E
 	}
 	
 	expression->operands = expression_alloc_operands(2);
-	*expression->operands[0].expression = expression_get(tokens, op_token - tokens);
+	*expression->operands[0].expression = expression_get(list, tokens, op_token - tokens);
 	if (dual_token) op_token += 1;
-	*expression->operands[1].expression = expression_get(op_token + 1, count - (op_token - tokens) - 1);
+	*expression->operands[1].expression = expression_get(list, op_token + 1, count - (op_token - tokens) - 1);
 	
 	return op_token;
 }
 
-struct Token *expression_parse_assign(struct Token *tokens, size_t count, struct Expression *expression) {
-	struct Token *op_token = expression_parse_infix_binary(tokens, count, &(enum Operator){OPR_EQU}, 1, false, expression);
+struct Token *expression_parse_assign(struct TokenList *list, struct Token *tokens, size_t count, struct Expression *expression) {
+	struct Token *op_token = expression_parse_infix_binary(list, tokens, count, &(enum Operator){OPR_EQU}, 1, false, expression);
 	if (!op_token) return NULL;
 	
 	if (op_token->op_info.equal_op != OP_EQU) {
@@ -886,12 +883,12 @@ struct Token *find_token_by_opr(struct Token *tokens, size_t count, enum Operato
 	size_t open_brackets = 0;
 	size_t i = left ? 0 : count - 1;
 	while (true) {
-		if (tokens[i].type == TOK_BRACKET && tokens[i].data[0] == '(') {
+		if (tokens[i].type == TOK_BRACKET && tokens[i].bracket == '(') {
 			++open_brackets;
 			goto next;
 		}
 		if (open_brackets) {
-			if (tokens[i].type == TOK_BRACKET && tokens[i].data[0] == ')') --open_brackets;
+			if (tokens[i].type == TOK_BRACKET && tokens[i].bracket == ')') --open_brackets;
 			goto next;
 		}
 		if (tokens[i].type == TOK_OPERATOR) {
@@ -935,38 +932,37 @@ noreturn void raise_mem(char *context) {
 	};
 }
 
-noreturn void raise_unexpected_token(char *expected, struct Token *got_token) {
+noreturn void raise_unexpected_token(struct TokenList *list, char *expected, struct Token *got_token) {
 	char *def_msg = "Unexpected token encountered!";
 	
 	// Find line number and position
 	size_t line_num = 0;
-	struct Token *first_token = got_token;
-	while (first_token[-1].type != TOK_EOF) --first_token;
-	char *code = first_token->data;
+	char *code = list->code;
+	char *data = token_data(list, got_token);
 	char *line_start = code;
 	do {
 		if (*code == '\n') {
 			++line_num;
 			line_start = code + 1;
 		}
-	} while (++code != got_token->data);
+	} while (++code != data);
 	
 	if (expected) {
 		raise_error_fmt(def_msg,
 			"Unexpected token encountered at %zu:%tu! Was expecting %s but instead got '%.*s'",
 			line_num,
-			got_token->data - line_start,
+			data - line_start,
 			expected,
 			(int) got_token->data_len,
-			got_token->data
+			data
 		);
 	} else {
 		raise_error_fmt(def_msg,
 			"Unexpected token encountered at %zu:%tu! Was not expecting '%.*s'",
 			line_num,
-			got_token->data - line_start,
+			data - line_start,
 			(int) got_token->data_len,
-			got_token->data
+			data
 		);
 	}
 }
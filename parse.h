@@ -20,8 +20,10 @@
 #ifndef PARSE_H
 #define PARSE_H
 
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 enum TokenType {
 	TOK_UNKNOWN,
@@ -143,19 +145,24 @@ enum Precedence {
 };
 
 struct TokenOperator {
-	enum Operator sym;
-	enum Operation op;
-	enum Operation equal_op; // For equable operations (+=, *=, -=, /= etc.)
-	int precedence;
+	uint8_t sym; // enum Operator
+	uint8_t op; // enum Operation
+	uint8_t equal_op; // For equable operations (+=, *=, -=, /= etc.)
+	int8_t precedence;
 };
 
+/*
+ * Tokens are 16 bytes so that the scans of the expression parser stay within a few cache lines.
+ * The data is found with the offset in the code of the list (see token_data) and the values of
+ * numbers are kept in a table of the list.
+ */
 struct Token {
-	enum TokenType type;
-	char *data;
-	size_t data_len;
+	uint32_t offset;
+	uint32_t data_len;
+	uint8_t type; // enum TokenType
 	union {
-		// Number
-		double number;
+		// Number, index in the table of the list
+		uint32_t number;
 		
 		// String
 		char quote;
@@ -164,24 +171,23 @@ struct Token {
 		struct TokenOperator op_info;
 		
 		// Keyword
-		enum Keyword keyword;
+		uint8_t keyword; // enum Keyword
 		
-		// Generic
-		void *info;
+		// Bracket
+		char bracket;
 	};
 };
 
+/* The tokens are kept next to each other in a growable array, the same as the table of numbers */
 struct TokenList {
+	struct Token *tokens;
 	size_t length;
-	struct TokenListNode *head;
-	struct TokenListNode *tail;
+	size_t cap;
 	bool dirty;
-};
-
-struct TokenListNode {
-	struct Token *token;
-	struct TokenListNode *prev;
-	struct TokenListNode *next;
+	char *code;
+	double *numbers;
+	size_t number_count;
+	size_t number_cap;
 };
 
 struct Primitive {
@@ -261,9 +267,11 @@ struct Unit {
 };
 
 bool parse(char *code);
-struct Token token_get(char *code, char **next);
+struct Token token_get(struct TokenList *list, char *code, char **next);
 struct TokenList token_get_list(char *code);
 struct Token *token_list_to_array(struct TokenList *list, bool pad);
+char *token_data(struct TokenList *list, struct Token *token);
+double token_number(struct TokenList *list, struct Token *token);
 
 enum Operator opsym_to_opr(char sym);
 enum Operation opr_to_op(enum Operator opr);
@@ -281,17 +289,24 @@ bool char_is_opsym(char chr);
 bool char_is_bracket(char chr);
 bool char_is_not_eol(char chr);
 
-struct Expression expression_get(struct Token *tokens, size_t count);
-bool expression_parse(struct Token *token, size_t count, enum Precedence precedence, struct Expression *expression);
-struct Token *expression_parse_infix_binary(struct Token *tokens, size_t count, enum Operator opr_list[], size_t opr_count, bool left, struct Expression *expression);
-struct Token *expression_parse_comp(struct Token *tokens, size_t count, struct Expression *expression);
-struct Token *expression_parse_assign(struct Token *tokens, size_t count, struct Expression *expression);
+struct Expression expression_get(struct TokenList *list, struct Token *tokens, size_t count);
+bool expression_parse(struct TokenList *list, struct Token *token, size_t count, enum Precedence precedence, struct Expression *expression);
+struct Token *expression_parse_infix_binary(struct TokenList *list, struct Token *tokens, size_t count, enum Operator opr_list[], size_t opr_count, bool left, struct Expression *expression);
+struct Token *expression_parse_comp(struct TokenList *list, struct Token *tokens, size_t count, struct Expression *expression);
+struct Token *expression_parse_assign(struct TokenList *list, struct Token *tokens, size_t count, struct Expression *expression);
 struct Operand *expression_alloc_operands(size_t count);
 struct Token *find_token_by_opr(struct Token *tokens, size_t count, enum Operator opr_list[], size_t opr_count, bool left);
 
+/* The errors raised while parsing jump back to here */
+extern struct ParseError {
+	jmp_buf jump;
+	char *msg;
+	bool free_msg;
+} parse_error;
+
 noreturn void raise_error(char *msg, bool free_msg);
 noreturn void raise_error_fmt(char *def, char *fmt, ...);
 noreturn void raise_mem(char *context);
-noreturn void raise_unexpected_token(char *expected, struct Token *got_token);
+noreturn void raise_unexpected_token(struct TokenList *list, char *expected, struct Token *got_token);
 
 #endif
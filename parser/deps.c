@@ -0,0 +1,212 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parser/deps.h"
+#include "parser/include.h"
+#include "parser/parser.h"
+#include "utils.h"
+
+#define IS_WS(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
+/* The code is always NUL terminated, so comparing with a literal never reads past the end */
+#define MATCH(str, literal) (strncmp(str, literal, sizeof literal - 1) == 0)
+
+static bool scan_code(struct DependencyList *list, char *from, char *code, size_t size);
+static char *comment_start(char *cursor);
+static bool add_include(struct DependencyList *list, char *from, char *path, size_t len, bool angle);
+static bool add_file(struct DependencyList *list, char *file, size_t len);
+static void write_escaped(FILE *stream, char *file);
+
+bool deps_scan(char *file, source_reader read_func, struct DependencyList *list) {
+	if (!add_file(list, file, strlen(file))) return false;
+	
+	// Every file which is found is added to the end of the list, so the list is also the queue of files to scan
+	for (size_t i = 0; i < list->count; ++i) {
+		size_t size;
+		char *code = read_func(list->files[i], &size, false);
+		if (!code) continue;
+		bool success = scan_code(list, list->files[i], code, size);
+		free(code);
+		if (!success) return false;
+	}
+	return true;
+}
+
+void deps_write(FILE *stream, char *target, struct DependencyList *list) {
+	// Make-style rule, which Ninja understands too
+	write_escaped(stream, target);
+	fputc(':', stream);
+	for (size_t i = 0; i < list->count; ++i) {
+		fputs(" \\\n  ", stream);
+		write_escaped(stream, list->files[i]);
+	}
+	fputc('\n', stream);
+	
+	// Empty rules for the includes so that make doesn't fail when one of them is deleted
+	for (size_t i = 1; i < list->count; ++i) {
+		fputc('\n', stream);
+		write_escaped(stream, list->files[i]);
+		fputs(":\n", stream);
+	}
+}
+
+void deps_free(struct DependencyList *list) {
+	for (size_t i = 0; i < list->count; ++i) free(list->files[i]);
+	free(list->files);
+	*list = (struct DependencyList){.files = NULL};
+}
+
+static bool scan_code(struct DependencyList *list, char *from, char *code, size_t size) {
+	char *cursor = code, *end = code + size;
+	size_t comment_level = 0;
+	bool line_start = true;
+	
+	while (cursor < end) {
+		if (comment_level) {
+			// Only the end of the block and nested blocks matter in a comment
+			cursor = memchr(cursor, '#', end - cursor);
+			if (!cursor) break;
+			char *nested = comment_start(++cursor);
+			if (nested) {
+				cursor = nested;
+				++comment_level;
+			} else if (MATCH(cursor, "ce") || MATCH(cursor, "comments-end")) {
+				cursor += cursor[1] == 'e' ? 2 : sizeof "comments-end" - 1;
+				--comment_level;
+				line_start = false;
+			}
+			continue;
+		}
+		
+		if (line_start) {
+			line_start = false;
+			char *line_end = memchr(cursor, '\n', end - cursor);
+			if (!line_end) line_end = end;
+			
+			if (MATCH(cursor, "#include") && IS_WS(cursor[8])) {
+				// Same rules as the lexer: the path is in quotes or angle brackets, anything after it is ignored
+				char *path = cursor + 8;
+				while (IS_WS(*path)) ++path;
+				if (*path == '"' || *path == '<') {
+					bool angle = *path == '<';
+					char *path_end = ++path;
+					while (path_end < end && *path_end != '\n' && *path_end != '"' && *path_end != '>') ++path_end;
+					if (path_end != path && !add_include(list, from, path, path_end - path, angle)) return false;
+					line_end = memchr(path_end, '\n', end - path_end);
+					if (!line_end) break;
+					cursor = line_end + 1;
+					line_start = true;
+					continue;
+				}
+			}
+			
+			// Most lines don't have a '#' at all
+			if (!memchr(cursor, '#', line_end - cursor)) {
+				cursor = line_end + 1;
+				line_start = true;
+				continue;
+			}
+		}
+		
+		// A line with a '#' somewhere, look for it outside of strings and comments
+		switch (*cursor++) {
+			case '\n':
+				line_start = true;
+				break;
+			case ';':
+				while (cursor < end && *cursor != '\n') ++cursor;
+				break;
+			case '"':
+			case '\'': {
+				// An unterminated string is just a stray quote
+				char *string_end = cursor;
+				while (string_end < end && *string_end != '\n' && *string_end != cursor[-1]) ++string_end;
+				if (string_end < end && *string_end == cursor[-1]) cursor = string_end + 1;
+				break;
+			}
+			case '#': {
+				char *comment = comment_start(cursor);
+				if (comment) {
+					cursor = comment;
+					comment_level = 1;
+				} else if (MATCH(cursor, "include-once")) {
+					cursor += sizeof "include-once" - 1;
+				} else {
+					// Any other directive takes up the rest of the line
+					while (cursor < end && *cursor != '\n') ++cursor;
+				}
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+static char *comment_start(char *cursor) {
+	// Returns the end of a "#cs" or "#comments-start" without the '#', NULL if there is none
+	if (MATCH(cursor, "cs") && IS_WS(cursor[2])) return cursor + 2;
+	if (MATCH(cursor, "comments-start") && IS_WS(cursor[14])) return cursor + 14;
+	return NULL;
+}
+
+static bool add_include(struct DependencyList *list, char *from, char *path, size_t len, bool angle) {
+	// Includes which can't be found are left out, parsing the script reports them
+	char *name = strndup(path, len);
+	if (!name) return false;
+	char *file = include_resolve(name, angle, from);
+	free(name);
+	if (!file) return true;
+	bool success = add_file(list, file, strlen(file));
+	free(file);
+	return success;
+}
+
+static bool add_file(struct DependencyList *list, char *file, size_t len) {
+	for (size_t i = 0; i < list->count; ++i) {
+		if (strncmp(list->files[i], file, len) == 0 && list->files[i][len] == '\0') return true;
+	}
+	
+	char **files = grow_array(list->files, &list->cap, list->count, sizeof *files);
+	if (!files) return false;
+	list->files = files;
+	char *copy = strndup(file, len);
+	if (!copy) return false;
+	list->files[list->count++] = copy;
+	return true;
+}
+
+static void write_escaped(FILE *stream, char *file) {
+	for (; *file; ++file) {
+		switch (*file) {
+			case ' ':
+			case '#':
+				fputc('\\', stream);
+				break;
+			case '$':
+				fputc('$', stream);
+				break;
+		}
+		fputc(*file, stream);
+	}
+}
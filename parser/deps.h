@@ -0,0 +1,42 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARSER_DEPS_H
+#define PARSER_DEPS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "parser/parser.h"
+
+/*
+ * Prescan for the files which a script includes, transitively. Only the lines which
+ * can hold an #include are looked at, comment blocks are honored like the lexer does.
+ */
+struct DependencyList {
+	char **files; // The script itself comes first, then the includes in the order they are found
+	size_t count;
+	size_t cap;
+};
+
+bool deps_scan(char *file, source_reader read_func, struct DependencyList *list);
+void deps_write(FILE *stream, char *target, struct DependencyList *list);
+void deps_free(struct DependencyList *list);
+
+#endif
@@ -0,0 +1,270 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parser/include.h"
+#include "utils.h"
+
+struct Directory {
+	char **names; // Sorted, sub-directories are left out
+	size_t count;
+};
+
+struct CacheEntry {
+	enum CacheKind {
+		CACHE_DIRECTORY,
+		CACHE_LOOKUP,
+	} kind;
+	uint32_t hash;
+	char *key; // NULL for an empty slot
+	void *value; // A directory, or the resolved path of a lookup which is NULL when nothing was found
+};
+
+static char **dirs = NULL;
+static size_t dirs_len = 0, dirs_cap = 0;
+
+static struct CacheEntry *cache = NULL;
+static size_t cache_count = 0, cache_cap = 0;
+
+static bool file_exists(char *path);
+static struct Directory *list_directory(char *path);
+static char *join_path(char *dir, size_t dir_len, char *name);
+static struct CacheEntry *cache_find(enum CacheKind kind, char *key);
+static bool cache_insert(struct CacheEntry *entry, enum CacheKind kind, char *key, void *value);
+static int compare_names(const void *a, const void *b);
+
+bool include_add_dir(char *dir) {
+	char **new_dirs = grow_array(dirs, &dirs_cap, dirs_len, sizeof *dirs);
+	if (!new_dirs) return false;
+	dirs = new_dirs;
+	dirs[dirs_len] = strdup(dir);
+	if (!dirs[dirs_len]) return false;
+	++dirs_len;
+	return true;
+}
+
+char *include_resolve(char *name, bool angle, char *from) {
+	// The directory of the including file, empty for the current directory
+	char *slash = strrchr(from, '/');
+	size_t from_len = angle || !slash ? 0 : slash - from + 1;
+	
+	// The key is the kind of include, the name and then the directory which it is relative to
+	size_t name_len = strlen(name);
+	char *key = malloc(1 + name_len + 1 + from_len + 1);
+	if (!key) return NULL;
+	key[0] = angle ? '<' : '"';
+	memcpy(key + 1, name, name_len);
+	key[1 + name_len] = '\n'; // Can't be a part of an include path
+	memcpy(key + 1 + name_len + 1, from, from_len);
+	key[1 + name_len + 1 + from_len] = '\0';
+	
+	struct CacheEntry *entry = cache_find(CACHE_LOOKUP, key);
+	if (entry->key) {
+		free(key);
+		return entry->value ? strdup(entry->value) : NULL;
+	}
+	
+	// Scripts are usually written on Windows, where backslashes separate directories too
+	char *path = key + 1;
+	path[name_len] = '\0';
+	for (char *c = path; *c; ++c) if (*c == '\\') *c = '/';
+	
+	char *found = NULL;
+	if (path[0] == '/') {
+		found = strdup(path);
+		if (found && !file_exists(found)) {
+			free(found);
+			found = NULL;
+		}
+	} else {
+		if (!angle) {
+			found = join_path(from, from_len, path);
+			if (found && !file_exists(found)) {
+				free(found);
+				found = NULL;
+			}
+		}
+		for (size_t i = 0; !found && i < dirs_len; ++i) {
+			found = join_path(dirs[i], strlen(dirs[i]), path);
+			if (found && !file_exists(found)) {
+				free(found);
+				found = NULL;
+			}
+		}
+	}
+	
+	// Restore the key and remember the result, failed lookups included
+	path[name_len] = '\n';
+	memcpy(key + 1, name, name_len);
+	entry = cache_find(CACHE_LOOKUP, key);
+	if (!cache_insert(entry, CACHE_LOOKUP, key, found)) {
+		free(key);
+		return found;
+	}
+	return found ? strdup(found) : NULL;
+}
+
+void include_forget(void) {
+	// Drop the cached listings and lookups, the include directories are kept
+	for (size_t i = 0; i < cache_cap; ++i) {
+		struct CacheEntry *entry = &cache[i];
+		if (!entry->key) continue;
+		if (entry->kind == CACHE_DIRECTORY) {
+			struct Directory *directory = entry->value;
+			for (size_t j = 0; j < directory->count; ++j) free(directory->names[j]);
+			free(directory->names);
+		}
+		free(entry->value);
+		free(entry->key);
+	}
+	free(cache);
+	cache = NULL;
+	cache_count = cache_cap = 0;
+}
+
+void include_free(void) {
+	for (size_t i = 0; i < dirs_len; ++i) free(dirs[i]);
+	free(dirs);
+	dirs = NULL;
+	dirs_len = dirs_cap = 0;
+	include_forget();
+}
+
+static bool file_exists(char *path) {
+	// Look for the name in the listing of its directory instead of trying to open it
+	char *slash = strrchr(path, '/');
+	char *name = slash ? slash + 1 : path;
+	char *dir = slash ? strndup(path, slash == path ? 1 : slash - path) : ".";
+	if (!dir) return false;
+	struct Directory *directory = list_directory(dir);
+	if (slash) free(dir);
+	return directory && directory->count && bsearch(&name, directory->names, directory->count, sizeof *directory->names, compare_names);
+}
+
+static struct Directory *list_directory(char *path) {
+	struct CacheEntry *entry = cache_find(CACHE_DIRECTORY, path);
+	if (entry->key) return entry->value;
+	
+	struct Directory *directory = malloc(sizeof *directory);
+	if (!directory) return NULL;
+	*directory = (struct Directory){.names = NULL};
+	
+	// A directory which can't be opened is cached as an empty one
+	DIR *stream = opendir(path);
+	if (stream) {
+		size_t names_cap = 0;
+		for (struct dirent *dirent; (dirent = readdir(stream));) {
+			if (dirent->d_type == DT_DIR) continue;
+			char **new_names = grow_array(directory->names, &names_cap, directory->count, sizeof *directory->names);
+			if (!new_names) break;
+			directory->names = new_names;
+			if (!(directory->names[directory->count] = strdup(dirent->d_name))) break;
+			++directory->count;
+		}
+		closedir(stream);
+		if (directory->count) qsort(directory->names, directory->count, sizeof *directory->names, compare_names);
+	}
+	
+	char *key = strdup(path);
+	if (!key || !cache_insert(entry, CACHE_DIRECTORY, key, directory)) {
+		for (size_t i = 0; i < directory->count; ++i) free(directory->names[i]);
+		free(directory->names);
+		free(directory);
+		free(key);
+		return NULL;
+	}
+	return directory;
+}
+
+static char *join_path(char *dir, size_t dir_len, char *name) {
+	bool separate = dir_len && dir[dir_len - 1] != '/';
+	size_t name_len = strlen(name);
+	char *path = malloc(dir_len + separate + name_len + 1);
+	if (!path) return NULL;
+	memcpy(path, dir, dir_len);
+	if (separate) path[dir_len] = '/';
+	memcpy(path + dir_len + separate, name, name_len + 1);
+	return path;
+}
+
+static uint32_t hash_key(enum CacheKind kind, char *key) {
+	// FNV-1a
+	uint32_t hash = 2166136261u ^ kind;
+	for (; *key; ++key) {
+		hash ^= (unsigned char) *key;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static struct CacheEntry *cache_find(enum CacheKind kind, char *key) {
+	// Returns the entry with the key, or the empty slot where it belongs
+	if (cache_count * 2 >= cache_cap) {
+		size_t new_cap = cache_cap ? cache_cap * 2 : 64;
+		struct CacheEntry *new_cache = calloc(new_cap, sizeof *new_cache);
+		if (new_cache) {
+			for (size_t i = 0; i < cache_cap; ++i) {
+				if (!cache[i].key) continue;
+				size_t j = cache[i].hash & (new_cap - 1);
+				while (new_cache[j].key) j = (j + 1) & (new_cap - 1);
+				new_cache[j] = cache[i];
+			}
+			free(cache);
+			cache = new_cache;
+			cache_cap = new_cap;
+		}
+	}
+	
+	static struct CacheEntry no_entry;
+	if (cache_count + 1 >= cache_cap) {
+		// Only when the table couldn't grow, nothing more can be cached
+		no_entry = (struct CacheEntry){.key = NULL};
+		return &no_entry;
+	}
+	
+	uint32_t hash = hash_key(kind, key);
+	size_t mask = cache_cap - 1;
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		struct CacheEntry *entry = &cache[i];
+		if (!entry->key) return entry;
+		if (entry->kind == kind && entry->hash == hash && strcmp(entry->key, key) == 0) return entry;
+	}
+}
+
+static bool cache_insert(struct CacheEntry *entry, enum CacheKind kind, char *key, void *value) {
+	if (entry < cache || entry >= cache + cache_cap) return false;
+	*entry = (struct CacheEntry){
+		.kind = kind,
+		.hash = hash_key(kind, key),
+		.key = key,
+		.value = value,
+	};
+	++cache_count;
+	return true;
+}
+
+static int compare_names(const void *a, const void *b) {
+	return strcmp(*(char **) a, *(char **) b);
+}
@@ -0,0 +1,37 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARSER_INCLUDE_H
+#define PARSER_INCLUDE_H
+
+#include <stdbool.h>
+
+/*
+ * Resolution of #include paths. A path in quotes is looked up next to the file which
+ * includes it first and then in the include directories, a path in angle brackets only
+ * in the include directories. Each directory is listed once per run and the results of
+ * every lookup are kept, the failed ones too, so the file system is never asked twice.
+ */
+
+bool include_add_dir(char *dir);
+char *include_resolve(char *name, bool angle, char *from);
+void include_forget(void);
+void include_free(void);
+
+#endif
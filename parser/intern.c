@@ -0,0 +1,225 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alloc/alloc.h"
+#include "cease/cease.h"
+#include "parser/intern.h"
+#include "parser/parser_internal.h"
+#include "parser/tree.h"
+
+#define INTERNER_MIN_CAPACITY 64
+
+struct StringKey {
+	char *str;
+	size_t len;
+};
+
+static char *err_mem_ctx = "sharing expressions";
+
+static struct InternEntry *lookup(struct Interner *interner, enum InternKind kind, uint32_t hash, bool (*equal)(void *node, void *key), void *key);
+static void *insert(struct Interner *interner, struct InternEntry *entry, enum InternKind kind, uint32_t hash, void *node);
+static void grow(struct Interner *interner);
+static bool string_equal(void *node, void *key);
+static bool primitive_equal(void *node, void *key);
+static bool expression_equal(void *node, void *key);
+static void *operand_node(struct Operand *operand);
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t size);
+
+struct Interner interner_init(Allocator *alloc) {
+	return (struct Interner){
+		.alloc = alloc,
+		.entries = NULL,
+		.generation = 1,
+	};
+}
+
+void interner_reset(struct Interner *interner) {
+	// Forgetting every node is just a matter of starting a new generation
+	interner->count = 0;
+	if (++interner->generation) return;
+	memset(interner->entries, 0, sizeof *interner->entries * interner->capacity);
+	interner->generation = 1;
+}
+
+void interner_free(struct Interner *interner) {
+	free(interner->entries);
+	*interner = interner_init(interner->alloc);
+}
+
+char *intern_string(struct Interner *interner, char *str, size_t len) {
+	struct StringKey key = {str, len};
+	uint32_t hash = hash_bytes(2166136261u, str, len);
+	struct InternEntry *entry = lookup(interner, INT_STRING, hash, string_equal, &key);
+	if (entry->generation == interner->generation) return entry->node;
+	
+	char *copy = alloc_ctx(interner->alloc, len + 1, err_mem_ctx);
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+	return insert(interner, entry, INT_STRING, hash, copy);
+}
+
+struct Primitive *intern_primitive(struct Interner *interner, struct Primitive *primitive) {
+	// Strings are expected to be interned already, so they are hashed and compared by their pointer
+	uint32_t hash = hash_bytes(2166136261u, &primitive->type, sizeof primitive->type);
+	switch (primitive->type) {
+		case PRI_NUMBER:
+			hash = hash_bytes(hash, &primitive->number, sizeof primitive->number);
+			break;
+		case PRI_STRING:
+			hash = hash_bytes(hash, &primitive->string, sizeof primitive->string);
+			break;
+		case PRI_BOOLEAN:
+			hash = hash_bytes(hash, &primitive->boolean, sizeof primitive->boolean);
+			break;
+		case PRI_INT32:
+		case PRI_INT64:
+			hash = hash_bytes(hash, &primitive->integer, sizeof primitive->integer);
+			break;
+	}
+	struct InternEntry *entry = lookup(interner, INT_PRIMITIVE, hash, primitive_equal, primitive);
+	if (entry->generation == interner->generation) return entry->node;
+	
+	struct Primitive *copy = alloc_ctx(interner->alloc, sizeof *copy, err_mem_ctx);
+	*copy = *primitive;
+	return insert(interner, entry, INT_PRIMITIVE, hash, copy);
+}
+
+struct Expression *intern_expression(struct Interner *interner, struct Expression *expression) {
+	// The operands are shared already, so the node is identified by their pointers
+	unsigned short count = expr_operand_count(expression);
+	uint32_t hash = hash_bytes(2166136261u, &expression->op, sizeof expression->op);
+	for (unsigned short i = 0; i < count; ++i) {
+		void *node = operand_node(&expression->operands[i]);
+		hash = hash_bytes(hash, &expression->operands[i].type, sizeof expression->operands[i].type);
+		hash = hash_bytes(hash, &node, sizeof node);
+	}
+	struct InternEntry *entry = lookup(interner, INT_EXPRESSION, hash, expression_equal, expression);
+	if (entry->generation == interner->generation) return entry->node;
+	
+	struct Expression *copy = alloc_ctx(interner->alloc, sizeof *copy, err_mem_ctx);
+	*copy = *expression;
+	copy->operands = alloc_ctx(interner->alloc, sizeof *copy->operands * count, err_mem_ctx);
+	memcpy(copy->operands, expression->operands, sizeof *copy->operands * count);
+	copy->is_shared = true;
+	return insert(interner, entry, INT_EXPRESSION, hash, copy);
+}
+
+static struct InternEntry *lookup(struct Interner *interner, enum InternKind kind, uint32_t hash, bool (*equal)(void *node, void *key), void *key) {
+	// Make room beforehand so that the empty entry which is returned can be used to insert the node, keep the load factor under 3/4
+	if ((interner->count + 1) * 4 > interner->capacity * 3) grow(interner);
+	
+	size_t mask = interner->capacity - 1;
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		struct InternEntry *entry = &interner->entries[i];
+		if (entry->generation != interner->generation) return entry;
+		if (entry->kind == kind && entry->hash == hash && equal(entry->node, key)) return entry;
+	}
+}
+
+static void *insert(struct Interner *interner, struct InternEntry *entry, enum InternKind kind, uint32_t hash, void *node) {
+	*entry = (struct InternEntry){
+		.kind = kind,
+		.hash = hash,
+		.generation = interner->generation,
+		.node = node,
+	};
+	++interner->count;
+	return node;
+}
+
+static void grow(struct Interner *interner) {
+	size_t capacity = interner->capacity ? interner->capacity * 2 : INTERNER_MIN_CAPACITY;
+	struct InternEntry *entries = calloc(capacity, sizeof *entries);
+	if (!entries) cease_mem(interner->alloc->point, err_mem_ctx);
+	for (size_t i = 0; i < interner->capacity; ++i) {
+		struct InternEntry *entry = &interner->entries[i];
+		if (entry->generation != interner->generation) continue;
+		size_t j = entry->hash & (capacity - 1);
+		while (entries[j].generation == interner->generation) j = (j + 1) & (capacity - 1);
+		entries[j] = *entry;
+	}
+	free(interner->entries);
+	interner->entries = entries;
+	interner->capacity = capacity;
+}
+
+static bool string_equal(void *node, void *key) {
+	struct StringKey *string = key;
+	return strncmp(node, string->str, string->len) == 0 && ((char *) node)[string->len] == '\0';
+}
+
+static bool primitive_equal(void *node, void *key) {
+	struct Primitive *a = node, *b = key;
+	if (a->type != b->type) return false;
+	switch (a->type) {
+		case PRI_NUMBER:
+			// Compare the bits, 0 and -0 are different constants
+			return memcmp(&a->number, &b->number, sizeof a->number) == 0;
+		case PRI_STRING:
+			return a->string == b->string;
+		case PRI_BOOLEAN:
+			return a->boolean == b->boolean;
+		case PRI_INT32:
+		case PRI_INT64:
+			return a->integer == b->integer;
+	}
+	return false;
+}
+
+static bool expression_equal(void *node, void *key) {
+	struct Expression *a = node, *b = key;
+	if (a->op != b->op) return false;
+	unsigned short count = expr_operand_count(a);
+	for (unsigned short i = 0; i < count; ++i) {
+		if (a->operands[i].type != b->operands[i].type) return false;
+		if (operand_node(&a->operands[i]) != operand_node(&b->operands[i])) return false;
+	}
+	return true;
+}
+
+static void *operand_node(struct Operand *operand) {
+	switch (operand->type) {
+		case OPE_PRIMITIVE:
+			return operand->value;
+		case OPE_IDENTIFIER:
+			return operand->identifier;
+		case OPE_VARIABLE:
+			return operand->variable;
+		case OPE_EXPRESSION:
+			return operand->expression;
+		case OPE_EXPRESSION_LIST:
+			return operand->expression_list;
+	}
+	return NULL;
+}
+
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t size) {
+	// FNV-1a
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
@@ -0,0 +1,61 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARSER_INTERN_H
+#define PARSER_INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "alloc/alloc.h"
+#include "parser/tree.h"
+
+/*
+ * Hash-consing of expressions which can't have side effects: a structurally identical
+ * expression is only built once and all of its occurences share the node. Shared nodes
+ * must never be modified, and as their children are shared too, two of them are equal
+ * exactly when they are the same pointer.
+ */
+
+struct InternEntry {
+	enum InternKind {
+		INT_STRING,
+		INT_PRIMITIVE,
+		INT_EXPRESSION,
+	} kind;
+	uint32_t hash;
+	uint32_t generation; // Entries of an older generation are empty
+	void *node;
+};
+
+struct Interner {
+	Allocator *alloc; // For the nodes, the table itself is allocated with malloc so that it can outlive them
+	struct InternEntry *entries;
+	size_t count;
+	size_t capacity;
+	uint32_t generation;
+};
+
+struct Interner interner_init(Allocator *alloc);
+void interner_reset(struct Interner *interner);
+void interner_free(struct Interner *interner);
+char *intern_string(struct Interner *interner, char *str, size_t len);
+struct Primitive *intern_primitive(struct Interner *interner, struct Primitive *primitive);
+struct Expression *intern_expression(struct Interner *interner, struct Expression *expression);
+
+#endif
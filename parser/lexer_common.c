@@ -0,0 +1,143 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Lexer routines shared by the flex and direct-coded backends, included into whichever one is built */
+
+static size_t scan_tokens(char *file, source_reader read_func, bool print);
+
+static void print_token(char *str, size_t len, int type) {
+	puts("---### TOKEN ###---");
+	char *token_type;
+	switch (type) {
+		case UNKNOWN:
+			token_type = "Unknown";
+			break;
+		case WS:
+			token_type = "Whitespace";
+			break;
+		case COMMENT:
+			token_type = "Comment";
+			break;
+		case DIRECTIVE:
+			token_type = "Directive";
+			break;
+		case NUMBER:
+			token_type = "Number";
+			break;
+		case STRING:
+			token_type = "String";
+			break;
+		case BOOL:
+			token_type = "Boolean";
+			break;
+		case WORD:
+			token_type = "Word";
+			break;
+		case MACRO:
+			token_type = "Macro";
+			break;
+		case VARIABLE:
+			token_type = "Variable";
+			break;
+		case AND:
+		case OR:
+		case NOT:
+		case LTE:
+		case GTE:
+		case NEQ:
+		case OPERATOR:
+			token_type = "Operator";
+			break;
+		case BRACKET:
+			token_type = "Bracket";
+			break;
+		case DOT:
+			token_type = "Dot";
+			break;
+		case COMMA:
+			token_type = "Comma";
+			break;
+		case EOL:
+			token_type = "End of Line";
+			break;
+		default:
+			token_type = "Unnamed";
+			break;
+	}
+	fputs("Type: ", stdout);
+	puts(token_type);
+	printf("Data: %.*s\n", (int) len, str);
+}
+
+static void push_include(char *name, bool angle) {
+	char *file = include_resolve(name, angle, lex_buffer->file);
+	if (file) {
+		push_file(file);
+		free(file);
+		return;
+	}
+	if (!parse_mode) return;
+	
+	/* The include is skipped, the error is located at the path in the include line */
+	static const char format[] = "Can't find the included file \"%s\"";
+	size_t len = sizeof format + strlen(name);
+	char *message = malloc(len);
+	if (!message) {
+		yyerror("Can't find an included file");
+		return;
+	}
+	snprintf(message, len, format, name);
+	yyerror(message);
+	free(message);
+}
+
+void scan(char *file, source_reader read_func) {
+	scan_tokens(file, read_func, true);
+}
+
+size_t scan_count(char *file, source_reader read_func) {
+	return scan_tokens(file, read_func, false);
+}
+
+static size_t scan_tokens(char *file, source_reader read_func, bool print) {
+	parse_mode = false;
+	begin_default_state();
+	read_file = read_func;
+	push_file(file);
+	size_t count = 0;
+	int type;
+	for (;;) {
+		type = yylex();
+		if (!type) break;
+		++count;
+		if (print) print_token(token_str, token_len, type);
+	}
+	return count;
+}
+
+Allocator *parse(char *file, source_reader read_func) {
+	return parse_stream(file, read_func, NULL);
+}
+
+Allocator *parse_stream(char *file, source_reader read_func, statement_handler handler) {
+	parse_mode = true;
+	read_file = read_func;
+	push_file(file);
+	return start_parser(handler);
+}
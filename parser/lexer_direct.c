@@ -0,0 +1,446 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Direct-coded lexer, an alternative backend to the flex generated one in lexer.l
+ * 
+ * Instead of walking transition tables, every state of the scanner is a label
+ * and every transition is a goto or a switch case, the same shape of code that
+ * re2c generates. It produces the same tokens as lexer.l (including the include,
+ * directive line and multi-line comment states) and is selected at build time
+ * with the DIRECT_LEXER option.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "parser/include.h"
+#include "parser/number.h"
+#include "parser/parser.h"
+#include "parser/source.h"
+#include "cease/cease.h"
+#include "parser.tab.h"
+
+struct BufferStack {
+	struct BufferStack *prev;
+	char *code;
+	char *cursor;
+	char *limit;
+	size_t base;
+	bool ended;
+	char *file;
+} *lex_buffer = NULL;
+
+static char *token_str = NULL;
+static size_t token_len = 0;
+
+static source_reader read_file;
+
+static bool push_file(char *file);
+static void push_include(char *name, bool angle);
+static bool pop_file(void);
+
+static bool parse_mode;
+static int last_token;
+
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+#define IS_XDIGIT(c) (IS_DIGIT(c) || ((c) >= 'A' && (c) <= 'F') || ((c) >= 'a' && (c) <= 'f'))
+#define IS_ALPHA(c) (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z'))
+#define IS_ALNUM(c) (IS_ALPHA(c) || IS_DIGIT(c))
+#define IS_WS(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
+/* The code is always NUL terminated, so comparing with a literal never reads past the end */
+#define MATCH(str, literal) (strncmp(str, literal, sizeof literal - 1) == 0)
+
+#define TOKEN(type) do { \
+	token_str = start; \
+	token_len = cursor - start; \
+	yylloc = lex_buffer->base + (start - lex_buffer->code); \
+	lex_buffer->cursor = cursor; \
+	return last_token = (type); \
+} while (0)
+
+#define STRING_TOKEN(type) do { \
+	yylval.str.str = start; \
+	yylval.str.len = cursor - start; \
+	TOKEN(type); \
+} while (0)
+
+/* Keywords are words outside the parser and after a dot (`$map.Next`), the length has been matched already */
+#define KEYWORD(word, type) do { \
+	if (parse_mode && last_token != '.' && strncasecmp(start, word, sizeof word - 1) == 0) TOKEN(type); \
+} while (0)
+
+int yylex(void) {
+	char *cursor, *start;
+	char hold;
+	size_t comment_level;
+	
+	buffer:
+	if (!lex_buffer) return 0;
+	cursor = lex_buffer->cursor;
+	
+	token:
+	start = cursor;
+	switch (*cursor++) {
+		case '\0':
+			goto end_of_file;
+		case '\n':
+			goto newline;
+		case ' ':
+		case '\t':
+		case '\r':
+			goto whitespace;
+		case '#':
+			goto hash;
+		case ';':
+			goto line_comment;
+		case '0':
+			if ((*cursor == 'x' || *cursor == 'X') && IS_XDIGIT(cursor[1])) {
+				cursor += 2;
+				goto hex_number;
+			}
+			goto number;
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+			goto number;
+		case '"':
+		case '\'':
+			goto string;
+		case '$':
+		case '@':
+			goto variable;
+		case '<':
+			if (*cursor == '=') {
+				++cursor;
+				TOKEN(LTE);
+			}
+			if (*cursor == '>') {
+				++cursor;
+				TOKEN(NEQ);
+			}
+			goto operator;
+		case '>':
+			if (*cursor == '=') {
+				++cursor;
+				TOKEN(GTE);
+			}
+			goto operator;
+		case '=':
+			if (*cursor == '=') {
+				++cursor;
+				TOKEN(SEQU);
+			}
+			goto operator;
+		case '+':
+		case '-':
+		case '*':
+		case '/':
+		case '^':
+		case '&':
+		case '?':
+		case ':':
+			goto operator;
+		case '[':
+		case ']':
+		case '(':
+		case ')':
+			if (parse_mode) TOKEN(start[0]);
+			TOKEN(BRACKET);
+		case '.':
+			if (parse_mode) TOKEN(start[0]);
+			TOKEN(DOT);
+		case ',':
+			if (parse_mode) TOKEN(start[0]);
+			TOKEN(COMMA);
+		default:
+			if (IS_ALPHA(start[0])) goto word;
+			TOKEN(UNKNOWN);
+	}
+	
+	whitespace:
+	while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r') ++cursor;
+	if (*cursor == '_') {
+		/* Line continuation */
+		char *end = cursor + 1;
+		while (*end == ' ' || *end == '\t' || *end == '\r') ++end;
+		if (*end == '\n') {
+			cursor = end + 1;
+			goto token;
+		}
+	}
+	if (*cursor != '\n') goto token;
+	++cursor;
+	
+	newline:
+	/* A run of whitespace with a newline in it ends the line when parsing */
+	while (IS_WS(*cursor)) ++cursor;
+	if (parse_mode) TOKEN(EOL);
+	goto token;
+	
+	hash:
+	if (MATCH(cursor, "include") && IS_WS(cursor[7]) && (start == lex_buffer->code || start[-1] == '\n')) goto include;
+	if (MATCH(cursor, "include-once")) {
+		cursor += sizeof "include-once" - 1;
+		/* Add current file to "include once" list*/
+		read_file(lex_buffer->file, NULL, true);
+		goto token;
+	}
+	if (MATCH(cursor, "cs") && IS_WS(cursor[2])) {
+		cursor += 2;
+		goto ml_comment;
+	}
+	if (MATCH(cursor, "comments-start") && IS_WS(cursor[14])) {
+		cursor += 14;
+		goto ml_comment;
+	}
+	goto directive;
+	
+	include: {
+		char *path = cursor + 7;
+		while (IS_WS(*path)) ++path;
+		if (*path != '"' && *path != '<') goto directive;
+		start = cursor = path + 1;
+		while (*cursor && *cursor != '\n' && *cursor != '"' && *cursor != '>') ++cursor;
+		char *path_end = cursor;
+		
+		/* Eat up any leftover junk in the include line */
+		while (*cursor && *cursor != '\n') ++cursor;
+		if (*cursor) ++cursor;
+		lex_buffer->cursor = cursor;
+		
+		/* Ignore bad include line */
+		if (path_end == start) goto token;
+		
+		hold = *path_end;
+		*path_end = '\0';
+		yylloc = lex_buffer->base + (start - lex_buffer->code);
+		push_include(start, path[0] == '<');
+		*path_end = hold;
+		goto buffer;
+	}
+	
+	directive:
+	while (*cursor && *cursor != '\n') ++cursor;
+	STRING_TOKEN(DIRECTIVE);
+	
+	ml_comment:
+	comment_level = 1;
+	for (;;) switch (*cursor++) {
+		case '\0':
+			/* An unterminated comment ends with its file */
+			--cursor;
+			goto comment;
+		case '#':
+			if (MATCH(cursor, "ce") || MATCH(cursor, "comments-end")) {
+				cursor += cursor[1] == 'e' ? 2 : sizeof "comments-end" - 1;
+				if (--comment_level == 0) goto comment;
+			} else if (MATCH(cursor, "cs") && IS_WS(cursor[2])) {
+				cursor += 2;
+				++comment_level;
+			} else if (MATCH(cursor, "comments-start") && IS_WS(cursor[14])) {
+				cursor += 14;
+				++comment_level;
+			}
+			break;
+	}
+	
+	line_comment:
+	while (*cursor && *cursor != '\r' && *cursor != '\n') ++cursor;
+	
+	comment:
+	if (parse_mode) goto token;
+	TOKEN(COMMENT);
+	
+	number:
+	while (IS_DIGIT(*cursor)) ++cursor;
+	if (*cursor == '.' && IS_DIGIT(cursor[1])) {
+		cursor += 2;
+		while (IS_DIGIT(*cursor)) ++cursor;
+		if (*cursor == 'e' && IS_DIGIT(cursor[1])) {
+			cursor += 2;
+			while (IS_DIGIT(*cursor)) ++cursor;
+		}
+	}
+	goto number_value;
+	
+	hex_number:
+	while (IS_XDIGIT(*cursor)) ++cursor;
+	
+	number_value:
+	yylval.number = prim_from_number(start, cursor - start);
+	TOKEN(NUMBER);
+	
+	string:
+	/* A doubled quote is a part of the string */
+	for (; *cursor != start[0] || cursor[1] == start[0]; ++cursor) {
+		if (*cursor == start[0]) {
+			++cursor;
+			continue;
+		}
+		if (*cursor == '\n' || *cursor == '\0') {
+			/* Unterminated string, only the quote is consumed */
+			cursor = start + 1;
+			TOKEN(UNKNOWN);
+		}
+	}
+	++cursor;
+	STRING_TOKEN(STRING);
+	
+	variable:
+	while (IS_ALNUM(*cursor) || *cursor == '_') ++cursor;
+	if (cursor - start == 1) TOKEN(UNKNOWN);
+	STRING_TOKEN(start[0] == '$' ? VARIABLE : MACRO);
+	
+	operator:
+	if (parse_mode) TOKEN(start[0]);
+	TOKEN(OPERATOR);
+	
+	word:
+	while (IS_ALNUM(*cursor)) ++cursor;
+	switch (cursor - start) {
+		case 2:
+			if (strncasecmp(start, "Or", 2) == 0) TOKEN(OR);
+			KEYWORD("If", IF);
+			KEYWORD("Do", DO);
+			KEYWORD("To", TO);
+			KEYWORD("In", IN);
+			break;
+		case 3:
+			if (strncasecmp(start, "And", 3) == 0) TOKEN(AND);
+			if (strncasecmp(start, "Not", 3) == 0) TOKEN(NOT);
+			KEYWORD("Dim", DIM);
+			KEYWORD("For", FOR);
+			break;
+		case 4:
+			if (strncasecmp(start, "True", 4) == 0) {
+				yylval.boolean = true;
+				TOKEN(BOOL);
+			}
+			KEYWORD("Func", FUNC);
+			KEYWORD("Then", THEN);
+			KEYWORD("Else", ELSE);
+			KEYWORD("WEnd", WEND);
+			KEYWORD("Step", STEP);
+			KEYWORD("Next", NEXT);
+			KEYWORD("Exit", EXIT);
+			break;
+		case 5:
+			if (strncasecmp(start, "False", 5) == 0) {
+				yylval.boolean = false;
+				TOKEN(BOOL);
+			}
+			KEYWORD("Local", LOCAL);
+			KEYWORD("Const", CONST);
+			KEYWORD("ByRef", BYREF);
+			KEYWORD("EndIf", ENDIF);
+			KEYWORD("While", WHILE);
+			KEYWORD("Until", UNTIL);
+			KEYWORD("ReDim", REDIM);
+			break;
+		case 6:
+			KEYWORD("Global", GLOBAL);
+			KEYWORD("Static", STATIC);
+			KEYWORD("Return", RETURN);
+			KEYWORD("ElseIf", ELSEIF);
+			break;
+		case 7:
+			KEYWORD("EndFunc", ENDFUNC);
+			break;
+		case 8:
+			KEYWORD("ExitLoop", EXITLOOP);
+			break;
+		case 12:
+			KEYWORD("ContinueLoop", CONTINUELOOP);
+			break;
+	}
+	STRING_TOKEN(WORD);
+	
+	end_of_file:
+	/* A stray NUL byte in the middle of the code */
+	if (start < lex_buffer->limit) TOKEN(UNKNOWN);
+	
+	/* The last line of every file ends with it */
+	if (parse_mode && !lex_buffer->ended) {
+		lex_buffer->ended = true;
+		cursor = start;
+		TOKEN(EOL);
+	}
+	
+	/* Pop file and terminate if top-level */
+	if (!pop_file()) return 0;
+	goto buffer;
+}
+
+#undef STRING_TOKEN
+#undef TOKEN
+
+static void begin_default_state() {
+	/* There are no start conditions to switch, the default state is implied by parse_mode */
+}
+
+#include "parser/lexer_common.c"
+
+static bool push_file(char *file) {
+	size_t code_len;
+	file = strdup(file);
+	if (!file) return false;
+	char *code = read_file(file, &code_len, false);
+	if (!code) {
+		free(file);
+		return false;
+	}
+	size_t base = source_add(file, code, code_len);
+	struct BufferStack *new_buffer = base == SOURCE_ERROR ? NULL : malloc(sizeof *new_buffer);
+	if (!new_buffer) {
+		free(code);
+		free(file);
+		return false;
+	}
+	*new_buffer = (struct BufferStack){
+		.prev = lex_buffer,
+		.code = code,
+		.cursor = code,
+		.limit = code + code_len,
+		.file = file,
+		.base = base,
+	};
+	lex_buffer = new_buffer;
+	return true;
+}
+
+static bool pop_file() {
+	struct BufferStack *prev_buffer = lex_buffer->prev;
+	free(lex_buffer->code);
+	free(lex_buffer->file);
+	free(lex_buffer);
+	lex_buffer = prev_buffer;
+	return lex_buffer;
+}
@@ -0,0 +1,37 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARSER_NUMBER_H
+#define PARSER_NUMBER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Conversion of numeric literals (decimal, hexadecimal with a "0x" prefix and
+ * scientific notation) without touching the source. Like strtod, the longest
+ * valid prefix of the string is converted, but the result does not depend on
+ * the locale and is always correctly rounded.
+ */
+
+bool integer_from_str(const char *str, size_t len, uint64_t *value);
+double number_from_str(const char *str, size_t len);
+
+#endif
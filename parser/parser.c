@@ -1,15 +1,57 @@
 #define _GNU_SOURCE /* Required to enable (v)asprintf */
+#include <ctype.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include "alloc/alloc.h"
 #include "cease/cease.h"
+#include "parser/intern.h"
+#include "parser/number.h"
+#include "parser/parser.h"
 #include "parser/parser_internal.h"
+#include "parser/resolve.h"
+#include "parser/source.h"
 #include "parser/tree.h"
+#include "utils.h"
 
 #include "jansson.h"
 
+#ifdef SHARE_EXPRESSIONS
+static const bool share_expressions = true;
+#else
+static const bool share_expressions = false;
+#endif
+
 static Allocator parser_alloc;
+static struct Resolver parser_resolver;
+static struct Interner parser_interner;
+static struct Diagnostic *diagnostics, **diagnostics_tail;
+static statement_handler parser_handler;
+static struct AllocatorNode *statement_mark;
+
+/* Statements are collected in growable buffers and copied into the allocator once their block is complete */
+struct StatementBuffer {
+	struct Statement *statements;
+	size_t count, cap;
+};
+
+static struct StatementBuffer unit_buffer, function_buffer, *statement_buffer;
+static size_t statement_start; // Where the top-level statement which is being parsed starts
+static uint32_t function_parameters;
+static struct Declaration declaration_template;
+static struct Statement *parsed_unit;
+static size_t parsed_unit_size;
+
+static void add_diagnostic(size_t offset, const char *format, ...);
+static void free_statement_buffers(void);
+static struct Statement *copy_statements(struct StatementBuffer *buffer);
+static uint32_t append_statement(enum StatementType type);
+static struct Expression *expr_copy(struct Expression *expression);
+static char *str_copy(char *str, size_t len);
+static bool can_share(struct Expression *exp_list[], unsigned short count, enum Operation op);
+static struct Expression share_expr(enum Operation op, struct Operand operands[]);
 
 static void *palloc(size_t size) {
 	return alloc_new(&parser_alloc, size);
@@ -19,24 +61,321 @@ static void *palloc_ctx(size_t size, char *ctx) {
 	return alloc_ctx(&parser_alloc, size, ctx);
 }
 
-Allocator *start_parser() {
+Allocator *start_parser(statement_handler handler) {
 	CeasePoint cease_point = cease_get_point();
 	parser_alloc = alloc_init(malloc, free, &cease_point, "parsing code");
+	parser_resolver = resolver_init(&parser_alloc);
+	parser_interner = interner_init(&parser_alloc);
+	diagnostics = NULL;
+	diagnostics_tail = &diagnostics;
+	parser_handler = handler;
+	statement_mark = alloc_mark(&parser_alloc);
+	statement_buffer = &unit_buffer;
+	statement_start = 0;
+	parsed_unit = NULL;
+	parsed_unit_size = 0;
 	if (setjmp(cease_point.jump)) {
 		alloc_free_all(&parser_alloc);
+		free_statement_buffers();
+		interner_free(&parser_interner);
+		diagnostics = NULL;
+		parsed_unit = NULL;
+		parsed_unit_size = 0;
 		return NULL;
 	}
 	yyparse();
+	free_statement_buffers();
+	interner_free(&parser_interner);
 	return &parser_alloc;
 }
 
+void finish_parse(void) {
+	// Everything has been handed over already when streaming
+	if (parser_handler) return;
+	
+	parsed_unit_size = unit_buffer.count;
+	parsed_unit = copy_statements(&unit_buffer);
+	resolve_statements(&parser_resolver, parsed_unit, parsed_unit_size);
+}
+
+void finish_statement(uint32_t index) {
+	if (parser_handler) {
+		// When streaming, the statement is handed over and everything allocated for it is recycled
+		parser_handler(unit_buffer.statements + index, unit_buffer.count - index);
+		alloc_free_to(&parser_alloc, statement_mark);
+		interner_reset(&parser_interner);
+		unit_buffer.count = 0;
+	}
+	statement_start = unit_buffer.count;
+}
+
+void skip_statement(void) {
+	// The statements of a line with a syntax error are dropped, along with the function it was in
+	statement_buffer = &unit_buffer;
+	unit_buffer.count = statement_start;
+	
+	// Keep whatever was allocated for them though, the diagnostic is among it
+	statement_mark = alloc_mark(&parser_alloc);
+}
+
+void check_directive(char *str, size_t len, size_t offset) {
+	/* Directives for the editor and for the tools around AutoIt don't change what the script does,
+	 * the names which end with an underscore are prefixes of whole families of them */
+	static char *ignored[] = {
+		"Region", "EndRegion", "NoTrayIcon", "RequireAdmin", "pragma", "forceref", "forcedef", "ignorefunc",
+		"AutoIt3Wrapper_", "Au3Check_", "Au3Stripper_", "Obfuscator_", "Tidy_",
+	};
+	char *name = str + 1;
+	size_t name_len = 0;
+	while (name_len < len - 1 && (isalnum((unsigned char) name[name_len]) || name[name_len] == '_')) ++name_len;
+	for (size_t i = 0; i < lenof(ignored); ++i) {
+		size_t ignored_len = strlen(ignored[i]);
+		bool is_prefix = ignored[i][ignored_len - 1] == '_';
+		if ((is_prefix ? name_len >= ignored_len : name_len == ignored_len) && strncasecmp(name, ignored[i], ignored_len) == 0) return;
+	}
+	
+	add_diagnostic(offset, "unsupported directive #%.*s", (int) name_len, name);
+	
+	// Keep the diagnostic when the statements before it are recycled, same as for a syntax error
+	statement_mark = alloc_mark(&parser_alloc);
+}
+
+struct Statement *parser_unit(size_t *size) {
+	*size = parsed_unit_size;
+	return parsed_unit;
+}
+
+struct SymbolTable *parser_globals(void) {
+	return &parser_resolver.globals;
+}
+
+uint32_t add_statement(enum StatementType type, struct Expression *expression) {
+	struct Expression *copy = expr_copy(expression);
+	uint32_t index = append_statement(type);
+	statement_buffer->statements[index].expression = copy;
+	return index;
+}
+
+void close_statement(uint32_t index) {
+	struct Statement *statement = &statement_buffer->statements[index];
+	statement->end = statement_buffer->count;
+	if (statement->type == SMT_IF && !statement->alternative) statement->alternative = statement->end;
+}
+
+void begin_declaration(enum Scope scope, bool is_constant, bool is_static, bool is_reference) {
+	declaration_template = (struct Declaration){
+		.scope = scope,
+		.is_constant = is_constant,
+		.is_static = is_static,
+		.is_reference = is_reference,
+	};
+}
+
+uint32_t add_declaration(char *name, size_t len, struct Expression *initializer, struct ExpressionList *dimensions) {
+	struct Declaration *declaration = palloc(sizeof *declaration);
+	*declaration = declaration_template;
+	declaration->name = str_copy(name, len);
+	declaration->initializer = expr_copy(initializer);
+	if (dimensions) {
+		declaration->dimensions = palloc(sizeof *declaration->dimensions);
+		*declaration->dimensions = *dimensions;
+	}
+	uint32_t index = append_statement(SMT_DECLARATION);
+	statement_buffer->statements[index].declaration = declaration;
+	
+	/* A declaration can change what a name refers to, and the resolver rewrites the identifiers of
+	 * shared nodes in place, so expressions after it must not share nodes with the ones before it */
+	interner_reset(&parser_interner);
+	return index;
+}
+
+void begin_function(void) {
+	interner_reset(&parser_interner);
+	function_buffer.count = 0;
+	statement_buffer = &function_buffer;
+}
+
+void mark_parameters(void) {
+	function_parameters = function_buffer.count;
+}
+
+uint32_t end_function(char *name, size_t len) {
+	struct Declaration *declaration = palloc(sizeof *declaration);
+	*declaration = (struct Declaration){.scope = SCO_GLOBAL, .is_function = true};
+	declaration->name = str_copy(name, len);
+	declaration->code.block = copy_statements(&function_buffer);
+	declaration->code.size = function_buffer.count;
+	declaration->code.parameters = function_parameters;
+	
+	statement_buffer = &unit_buffer;
+	interner_reset(&parser_interner);
+	uint32_t index = append_statement(SMT_DECLARATION);
+	statement_buffer->statements[index].declaration = declaration;
+	return index;
+}
+
+uint32_t add_else_if(uint32_t previous, struct Expression *condition) {
+	statement_buffer->statements[previous].alternative = statement_buffer->count;
+	return add_statement(SMT_IF, condition);
+}
+
+void add_else(uint32_t last) {
+	statement_buffer->statements[last].alternative = statement_buffer->count;
+}
+
+void close_if(uint32_t first, uint32_t last) {
+	// Every If in an ElseIf chain ends at the EndIf, each one being the Else part of the one before it
+	for (uint32_t i = first;; i = statement_buffer->statements[i].alternative) {
+		close_statement(i);
+		if (i == last) break;
+	}
+}
+
+void close_do(uint32_t index, struct Expression *condition) {
+	statement_buffer->statements[index].expression = expr_copy(condition);
+	close_statement(index);
+}
+
+uint32_t add_for(char *name, size_t len, struct Expression *start, struct Expression *stop, struct Expression *step) {
+	struct Expression *expressions = palloc(sizeof *expressions * 4);
+	expressions[0] = expr_from_ident(name, len);
+	expressions[1] = *start;
+	expressions[2] = *stop;
+	expressions[3] = step ? *step : expr_from_prim(&(struct Primitive){.type = PRI_INT32, .integer = 1});
+	uint32_t index = append_statement(SMT_FOR);
+	statement_buffer->statements[index].expressions = expressions;
+	return index;
+}
+
+uint32_t add_for_in(char *name, size_t len, struct Expression *collection) {
+	struct Expression *expressions = palloc(sizeof *expressions * 2);
+	expressions[0] = expr_from_ident(name, len);
+	expressions[1] = *collection;
+	uint32_t index = append_statement(SMT_FOR_IN);
+	statement_buffer->statements[index].expressions = expressions;
+	return index;
+}
+
+static void free_statement_buffers(void) {
+	free(unit_buffer.statements);
+	free(function_buffer.statements);
+	unit_buffer = function_buffer = (struct StatementBuffer){.statements = NULL};
+}
+
+static struct Statement *copy_statements(struct StatementBuffer *buffer) {
+	if (!buffer->count) return NULL;
+	struct Statement *statements = palloc(sizeof *statements * buffer->count);
+	memcpy(statements, buffer->statements, sizeof *statements * buffer->count);
+	return statements;
+}
+
+static uint32_t append_statement(enum StatementType type) {
+	struct StatementBuffer *buffer = statement_buffer;
+	if (buffer->count == UINT32_MAX) cease(parser_alloc.point, "Too many statements in a block", false);
+	struct Statement *statements = grow_array(buffer->statements, &buffer->cap, buffer->count, sizeof *statements);
+	if (!statements) cease_mem(parser_alloc.point, "adding a statement");
+	buffer->statements = statements;
+	
+	uint32_t index = buffer->count++;
+	statements[index] = (struct Statement){.type = type, .end = index + 1};
+	return index;
+}
+
+static struct Expression *expr_copy(struct Expression *expression) {
+	if (!expression) return NULL;
+	struct Expression *copy = palloc(sizeof *copy);
+	*copy = *expression;
+	return copy;
+}
+
+static char *str_copy(char *str, size_t len) {
+	char *copy = palloc(len + 1);
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+	return copy;
+}
+
+static bool can_share(struct Expression *exp_list[], unsigned short count, enum Operation op) {
+	// Calls and assignments have side effects, reading the property of an object can run code too
+	switch (op) {
+		case OP_CALL:
+		case OP_ASS:
+			return false;
+		case OP_ACC:
+			if (exp_list[1]->op == OP_NOP && exp_list[1]->operands[0].type == OPE_IDENTIFIER) {
+				char sigil = exp_list[1]->operands[0].identifier[0];
+				if (sigil != '$' && sigil != '@') return false;
+			}
+			break;
+		default:
+			break;
+	}
+	
+	// Anything which contains a node that can't be shared can't be shared either
+	for (unsigned short i = 0; i < count; ++i) if (!exp_list[i]->is_shared) return false;
+	return count <= 3;
+}
+
+static struct Expression share_expr(enum Operation op, struct Operand operands[]) {
+	// The location of the node is filled in when it is first used as an operand, see operand_from_expr
+	struct Expression expression = {.op = op, .operands = operands, .offset = SOURCE_ERROR};
+	return *intern_expression(&parser_interner, &expression);
+}
+
+struct Diagnostic *parser_diagnostics(void) {
+	return diagnostics;
+}
+
+void print_diagnostics(struct Diagnostic *diagnostic) {
+	for (; diagnostic; diagnostic = diagnostic->next) {
+		struct SourcePosition position;
+		if (source_position(diagnostic->offset, &position)) fprintf(stderr, "%s:%zu:%zu: ", position.file, position.line, position.column);
+		fputs(diagnostic->message, stderr);
+		fputs("\n", stderr);
+	}
+}
+
 void yyerror(char const *s) {
-	fputs(s, stderr);
-	fputs("\n", stderr);
+	add_diagnostic(yylloc, "%s", s);
+}
+
+static void add_diagnostic(size_t offset, const char *format, ...) {
+	// Errors are collected instead of printed so that a caller gets all of them after a single parse
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+	struct Diagnostic *diagnostic = palloc_ctx(sizeof *diagnostic + len + 1, "recording an error");
+	diagnostic->offset = offset;
+	diagnostic->message = (char *) (diagnostic + 1);
+	va_start(args, format);
+	vsnprintf(diagnostic->message, len + 1, format, args);
+	va_end(args);
+	diagnostic->next = NULL;
+	*diagnostics_tail = diagnostic;
+	diagnostics_tail = &diagnostic->next;
+}
+
+struct Primitive prim_from_number(char *str, size_t len) {
+	/* Like in AutoIt, integers are Int32 if they fit and Int64 otherwise. Hexadecimal
+	 * literals are the bits of a two's complement integer, so 0xFFFFFFFF is -1 */
+	uint64_t integer;
+	if (integer_from_str(str, len, &integer)) {
+		bool is_hex = len > 2 && (str[1] == 'x' || str[1] == 'X');
+		if (is_hex && integer <= UINT32_MAX) return (struct Primitive){.type = PRI_INT32, .integer = (int32_t) integer};
+		if (is_hex) return (struct Primitive){.type = PRI_INT64, .integer = (int64_t) integer};
+		if (integer <= INT32_MAX) return (struct Primitive){.type = PRI_INT32, .integer = integer};
+		if (integer <= INT64_MAX) return (struct Primitive){.type = PRI_INT64, .integer = integer};
+	}
+	return (struct Primitive){.type = PRI_NUMBER, .number = number_from_str(str, len)};
 }
 
 struct Operand operand_from_prim(struct Primitive *primitive) {
 	struct Operand operand = {.type = OPE_PRIMITIVE};
+	if (share_expressions) {
+		operand.value = intern_primitive(&parser_interner, primitive);
+		return operand;
+	}
 	operand.value = palloc(sizeof *operand.value);
 	*operand.value = *primitive;
 	return operand;
@@ -45,6 +384,12 @@ struct Operand operand_from_prim(struct Primitive *primitive) {
 struct Operand operand_from_expr(struct Expression *expression) {
 	if (expression->op == OP_NOP) return expression->operands[0];
 	struct Operand operand = {.type = OPE_EXPRESSION};
+	if (expression->is_shared) {
+		// Only the value of a shared node is passed around, look up the node itself
+		operand.expression = intern_expression(&parser_interner, expression);
+		if (operand.expression->offset == SOURCE_ERROR) operand.expression->offset = expression->offset;
+		return operand;
+	}
 	operand.expression = palloc(sizeof *operand.expression);
 	*operand.expression = *expression;
 	return operand;
@@ -53,12 +398,20 @@ struct Operand operand_from_expr(struct Expression *expression) {
 struct Operand operand_from_exprlist(struct ExpressionList *expression_list) {
 	struct Operand operand = {.type = OPE_EXPRESSION_LIST};
 	operand.expression_list = palloc(sizeof *operand.expression_list);
-	*operand.expression_list = *expression_list;
+	if (expression_list) {
+		*operand.expression_list = *expression_list;
+	} else {
+		*operand.expression_list = (struct ExpressionList){.expressions = NULL, .count = 0};
+	}
 	return operand;
 }
 
 struct Expression expr_from_prim(struct Primitive *primitive) {
 	// TODO: Make a copy of primitive
+	if (share_expressions) {
+		struct Operand operand = operand_from_prim(primitive);
+		return share_expr(OP_NOP, &operand);
+	}
 	struct Expression expression = {.op = OP_NOP};
 	expression.operands = palloc(sizeof *expression.operands);
 	expression.operands[0] = operand_from_prim(primitive);
@@ -66,18 +419,35 @@ struct Expression expr_from_prim(struct Primitive *primitive) {
 }
 
 struct Expression expr_from_str(char *str, size_t len) {
+	// The quotes around the literal are dropped, a doubled quote inside of it stands for a single one
+	char quote = str[0];
+	str += 1;
+	len -= 2;
+	if (memchr(str, quote, len)) {
+		char *unescaped = palloc(len);
+		size_t unescaped_len = 0;
+		for (size_t i = 0; i < len; ++i) {
+			unescaped[unescaped_len++] = str[i];
+			if (str[i] == quote) ++i;
+		}
+		str = unescaped;
+		len = unescaped_len;
+	}
+	
 	struct Primitive value = {.type = PRI_STRING};
-	value.string = palloc(len + 1);
-	strncpy(value.string, str, len);
+	value.string = share_expressions ? intern_string(&parser_interner, str, len) : str_copy(str, len);
 	return expr_from_prim(&value);
 }
 
 struct Expression expr_from_ident(char *ident, size_t len) {
+	if (share_expressions) {
+		struct Operand operand = {.type = OPE_IDENTIFIER, .identifier = intern_string(&parser_interner, ident, len)};
+		return share_expr(OP_NOP, &operand);
+	}
 	struct Expression expression = {.op = OP_NOP};
 	expression.operands = palloc(sizeof *expression.operands);
 	expression.operands[0].type = OPE_IDENTIFIER;
-	expression.operands[0].identifier = palloc(len + 1);
-	strncpy(expression.operands[0].identifier, ident, len + 1);
+	expression.operands[0].identifier = str_copy(ident, len);
 	return expression;
 }
 
@@ -90,6 +460,11 @@ struct Expression expr_from_call(struct Expression *caller, struct ExpressionLis
 }
 
 struct Expression expr_from_expr(struct Expression *exp_list[], unsigned short count, enum Operation op) {
+	if (share_expressions && can_share(exp_list, count, op)) {
+		struct Operand operands[3];
+		for (unsigned short i = 0; i < count; ++i) operands[i] = operand_from_expr(exp_list[i]);
+		return share_expr(op, operands);
+	}
 	struct Expression expression = {.op = op};
 	expression.operands = palloc(sizeof *expression.operands * count);
 	for (unsigned short i = 0; i < count; ++i) {
@@ -98,15 +473,36 @@ struct Expression expr_from_expr(struct Expression *exp_list[], unsigned short c
 	return expression;
 }
 
-struct ExpressionList exprlist_from_expr(struct Expression *expr, struct ExpressionList *list) {
-	struct Expression *expr_copy = palloc(sizeof *expr_copy);
-	*expr_copy = *expr;
-	struct ExpressionList *list_copy;
-	if (list) {
-		list_copy = palloc(sizeof *list_copy);
-		*list_copy = *list;
-	} else list_copy = NULL;
-	return (struct ExpressionList){.expression = expr_copy, .list = list_copy};
+struct ExpressionList exprlist_from_expr(struct Expression *expr) {
+	struct ExpressionList list = {.count = 1};
+	list.expressions = palloc(sizeof *list.expressions);
+	list.expressions[0] = *expr;
+	return list;
+}
+
+struct ExpressionList exprlist_append(struct ExpressionList *list, struct Expression *expr) {
+	// The capacity is always the next power of two, so the array is doubled when the count reaches one
+	if ((list->count & (list->count - 1)) == 0) {
+		struct Expression *expressions = palloc(sizeof *expressions * list->count * 2);
+		memcpy(expressions, list->expressions, sizeof *expressions * list->count);
+		alloc_free(&parser_alloc, list->expressions);
+		list->expressions = expressions;
+	}
+	list->expressions[list->count++] = *expr;
+	return *list;
+}
+
+unsigned short expr_operand_count(struct Expression *expr) {
+	switch (expr->op) {
+		case OP_NOP:
+		case OP_NOT:
+		case OP_INV:
+			return 1;
+		case OP_CON:
+			return 3;
+		default:
+			return 2;
+	}
 }
 
 struct Expression binary_expr(struct Expression *a, struct Expression *b, enum Operation op) {
@@ -126,6 +522,10 @@ json_t *prim_to_json(struct Primitive *prim) {
 		case PRI_NUMBER:
 			prim_json = json_real(prim->number);
 			break;
+		case PRI_INT32:
+		case PRI_INT64:
+			prim_json = json_integer(prim->integer);
+			break;
 		case PRI_STRING:
 			prim_json = json_string(prim->string);
 			break;
@@ -160,52 +560,181 @@ json_t *expr_to_json(struct Expression *expr) {
 		[OP_CALL] = "Call",
 	};
 	
-	json_t *expr_json = json_object();
-	json_object_set_new(expr_json, "op", json_string(op_names[expr->op]));
+	// The tree is walked with an explicit stack, nested expressions are added as empty objects and filled in later
+	struct {
+		struct Expression *expr;
+		json_t *json;
+	} *stack = NULL, item;
+	size_t stack_len = 0, stack_cap = 0;
 	
-	json_t *expr_args_json = json_array();
-	short arg_count;
-	if (expr->op == OP_NOP || expr->op == OP_NOT || expr->op == OP_INV) {
-		arg_count = 1;
-	} else if (expr->op == OP_CON) {
-		arg_count = 3;
-	} else {
-		arg_count = 2;
-	}
-	for (short i = 0; i < arg_count; ++i) {
-		json_t *arg = json_null();
-		switch (expr->operands[i].type) {
-			case OPE_EXPRESSION:
-				arg = expr_to_json(expr->operands[i].expression);
-				break;
-			case OPE_EXPRESSION_LIST:
-				arg = exprlist_to_json(expr->operands[i].expression_list);
-				break;
-			case OPE_PRIMITIVE:
-				arg = prim_to_json(expr->operands[i].value);
-				break;
-			case OPE_IDENTIFIER:
-				arg = json_object();
-				json_object_set_new(arg, "ident", json_string(expr->operands[i].identifier));
-				break;
+	#define PUSH(child_expr, child_json) { \
+		void *new_stack = grow_array(stack, &stack_cap, stack_len, sizeof *stack); \
+		if (!new_stack) goto nomem; \
+		stack = new_stack; \
+		stack[stack_len].expr = (child_expr); \
+		stack[stack_len++].json = (child_json); \
+	}
+	
+	json_t *root_json = json_object();
+	item.expr = expr;
+	item.json = root_json;
+	while (true) {
+		expr = item.expr;
+		json_t *expr_json = item.json;
+		json_object_set_new(expr_json, "op", json_string(op_names[expr->op]));
+		
+		json_t *expr_args_json = json_array();
+		json_object_set_new(expr_json, "args", expr_args_json);
+		unsigned short arg_count = expr_operand_count(expr);
+		for (unsigned short i = 0; i < arg_count; ++i) {
+			json_t *arg = json_null();
+			switch (expr->operands[i].type) {
+				case OPE_EXPRESSION:
+					arg = json_object();
+					json_array_append_new(expr_args_json, arg);
+					PUSH(expr->operands[i].expression, arg);
+					continue;
+				case OPE_EXPRESSION_LIST:
+					arg = json_array();
+					json_array_append_new(expr_args_json, arg);
+					struct ExpressionList *list = expr->operands[i].expression_list;
+					for (size_t j = 0; j < list->count; ++j) {
+						json_t *element = json_object();
+						json_array_append_new(arg, element);
+						PUSH(&list->expressions[j], element);
+					}
+					continue;
+				case OPE_PRIMITIVE:
+					arg = prim_to_json(expr->operands[i].value);
+					break;
+				case OPE_IDENTIFIER:
+					arg = json_object();
+					json_object_set_new(arg, "ident", json_string(expr->operands[i].identifier));
+					break;
+				case OPE_VARIABLE:
+					arg = json_object();
+					json_object_set_new(arg, "variable", json_string(expr->operands[i].variable->name));
+					json_object_set_new(arg, "scope", json_string(expr->operands[i].variable->scope == SCO_LOCAL ? "Local" : "Global"));
+					json_object_set_new(arg, "slot", json_integer(expr->operands[i].variable->slot));
+					break;
+			}
+			json_array_append_new(expr_args_json, arg);
 		}
-		json_array_append_new(expr_args_json, arg);
+		
+		if (!stack_len) break;
+		item = stack[--stack_len];
 	}
-	json_object_set_new(expr_json, "args", expr_args_json);
 	
-	return expr_json;
+	#undef PUSH
+	
+	free(stack);
+	return root_json;
+	
+	nomem:
+	free(stack);
+	json_decref(root_json);
+	return NULL;
 }
 
 json_t *exprlist_to_json(struct ExpressionList *expr_list) {
-	if (!expr_list) return json_null();
 	json_t *expr_list_json = json_array();
-	json_array_append_new(expr_list_json, expr_to_json(expr_list->expression));
-	json_array_append_new(expr_list_json, exprlist_to_json(expr_list->list));
+	for (size_t i = 0; i < expr_list->count; ++i) {
+		json_t *expr_json = expr_to_json(&expr_list->expressions[i]);
+		if (!expr_json) {
+			json_decref(expr_list_json);
+			return NULL;
+		}
+		json_array_append_new(expr_list_json, expr_json);
+	}
 	return expr_list_json;
 }
 
+static json_t *declaration_to_json(struct Declaration *declaration) {
+	static char *scope_names[] = {
+		[SCO_AUTO] = "Auto",
+		[SCO_LOCAL] = "Local",
+		[SCO_GLOBAL] = "Global",
+	};
+	
+	json_t *json = json_object();
+	json_object_set_new(json, "name", json_string(declaration->name));
+	if (declaration->is_function) {
+		json_object_set_new(json, "parameters", json_integer(declaration->code.parameters));
+		json_object_set_new(json, "body", block_to_json(declaration->code.block, declaration->code.size));
+		return json;
+	}
+	json_object_set_new(json, "scope", json_string(scope_names[declaration->scope]));
+	json_object_set_new(json, "constant", json_boolean(declaration->is_constant));
+	json_object_set_new(json, "static", json_boolean(declaration->is_static));
+	json_object_set_new(json, "byref", json_boolean(declaration->is_reference));
+	if (declaration->initializer) json_object_set_new(json, "initializer", expr_to_json(declaration->initializer));
+	if (declaration->dimensions) json_object_set_new(json, "dimensions", exprlist_to_json(declaration->dimensions));
+	return json;
+}
+
+json_t *statement_to_json(struct Statement *statement) {
+	static char *type_names[] = {
+		[SMT_DECLARATION] = "Declaration",
+		[SMT_EXPRESSION] = "Expression",
+		[SMT_IF] = "If",
+		[SMT_WHILE] = "While",
+		[SMT_DO] = "Do",
+		[SMT_FOR] = "For",
+		[SMT_FOR_IN] = "For In",
+		[SMT_RETURN] = "Return",
+		[SMT_EXIT] = "Exit",
+		[SMT_EXIT_LOOP] = "Exit Loop",
+		[SMT_CONTINUE_LOOP] = "Continue Loop",
+		[SMT_REDIM] = "ReDim",
+	};
+	
+	json_t *json = json_object();
+	json_object_set_new(json, "type", json_string(type_names[statement->type]));
+	json_object_set_new(json, "end", json_integer(statement->end));
+	switch (statement->type) {
+		case SMT_DECLARATION:
+			json_object_set_new(json, "declaration", declaration_to_json(statement->declaration));
+			break;
+		case SMT_FOR:
+			json_object_set_new(json, "variable", expr_to_json(&statement->expressions[0]));
+			json_object_set_new(json, "start", expr_to_json(&statement->expressions[1]));
+			json_object_set_new(json, "stop", expr_to_json(&statement->expressions[2]));
+			json_object_set_new(json, "step", expr_to_json(&statement->expressions[3]));
+			break;
+		case SMT_FOR_IN:
+			json_object_set_new(json, "variable", expr_to_json(&statement->expressions[0]));
+			json_object_set_new(json, "collection", expr_to_json(&statement->expressions[1]));
+			break;
+		case SMT_IF:
+			json_object_set_new(json, "else", json_integer(statement->alternative));
+			/* Fall through */
+		default:
+			if (statement->expression) json_object_set_new(json, "expression", expr_to_json(statement->expression));
+			break;
+	}
+	return json;
+}
+
+json_t *block_to_json(struct Statement block[], size_t size) {
+	// The block is printed as it is stored, flat with the indices of nested statements
+	json_t *block_json = json_array();
+	for (size_t i = 0; i < size; ++i) json_array_append_new(block_json, statement_to_json(&block[i]));
+	return block_json;
+}
+
+void print_block(struct Statement *block, size_t size) {
+	json_t *json = block_to_json(block, size);
+	json_dumpf(json, stdout, JSON_INDENT(4));
+	fputc('\n', stdout);
+	json_decref(json);
+}
+
 void print_expr(struct Expression *expr) {
 	json_t *json = expr_to_json(expr);
+	if (!json) {
+		fputs("Failed to allocate memory when converting expression to JSON\n", stderr);
+		return;
+	}
 	json_dumpf(json, stdout, JSON_INDENT(4));
 	fputc('\n', stdout);
 	json_decref(json);
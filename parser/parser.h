@@ -1,12 +1,30 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <stddef.h>
 #include "alloc/alloc.h"
 
+struct Statement;
+struct SymbolTable;
+
 typedef char *(*source_reader)(char *file, size_t *size, bool once);
+typedef void (*statement_handler)(struct Statement *block, size_t size);
+
+struct Diagnostic {
+	size_t offset; // See parser/source.h
+	char *message;
+	struct Diagnostic *next;
+};
 
 void scan(char *file, source_reader read_func);
+size_t scan_count(char *file, source_reader read_func); // Only counts the tokens, to measure the lexer by itself
 Allocator *parse(char *file, source_reader read_func);
-Allocator *start_parser(void);
+Allocator *parse_stream(char *file, source_reader read_func, statement_handler handler);
+Allocator *start_parser(statement_handler handler);
+struct Statement *parser_unit(size_t *size);
+struct SymbolTable *parser_globals(void);
+struct Diagnostic *parser_diagnostics(void);
+void print_diagnostics(struct Diagnostic *diagnostic);
+void print_block(struct Statement *block, size_t size);
 
 #endif
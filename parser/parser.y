@@ -18,6 +18,9 @@
  */
 
 %define parse.trace
+%define parse.error verbose
+%locations
+%define api.location.type {size_t}
 
 %code requires {
 	#define _GNU_SOURCE /* Required to enable (v)asprintf */
@@ -27,7 +30,7 @@
 }
 
 %union {
-	double num;
+	struct Primitive number;
 	struct {
 		char *str;
 		size_t len;
@@ -35,6 +38,10 @@
 	bool boolean;
 	struct Expression expr;
 	struct ExpressionList expr_list;
+	uint32_t index;
+	struct {
+		uint32_t first, last;
+	} chain;
 }
 
 %token UNKNOWN
@@ -42,9 +49,9 @@
 %token WS
 
 %token COMMENT
-%token DIRECTIVE
+%token <str> DIRECTIVE
 
-%token <num> NUMBER
+%token <number> NUMBER
 %token <str> STRING
 %token <boolean> BOOL
 
@@ -57,17 +64,32 @@
 %token BRACKET
 %token DOT
 %token COMMA
+%token EOL "end of line"
+
+ /* Keywords */
+%token LOCAL "Local" GLOBAL "Global" DIM "Dim" CONST "Const" STATIC "Static" BYREF "ByRef"
+%token FUNC "Func" ENDFUNC "EndFunc" RETURN "Return"
+%token IF "If" THEN "Then" ELSEIF "ElseIf" ELSE "Else" ENDIF "EndIf"
+%token WHILE "While" WEND "WEnd" DO "Do" UNTIL "Until"
+%token FOR "For" TO "To" STEP "Step" NEXT "Next" IN "In"
+%token EXIT "Exit" EXITLOOP "ExitLoop" CONTINUELOOP "ContinueLoop"
+%token REDIM "ReDim"
 
- /* Operators */
+ /* Operators, the aliases have to be declared here to be usable in the rules */
+%token AND "And" OR "Or" NOT "Not"
+%token LTE "<=" GTE ">=" NEQ "<>" SEQU "=="
+
+ /* Lower than '=', so that a target at the start of a statement is assigned to rather than compared */
+%precedence TARGET
 %precedence '?'
 %precedence ':'
-%left AND "And" OR "Or"
-%left LT '<' GT '>' LTE "<=" GTE ">=" EQU '=' NEQ "<>" SEQU "=="
+%left AND OR
+%left LT '<' GT '>' LTE GTE EQU '=' NEQ SEQU
 %left '&'
 %left '+' '-'
 %left '*' '/'
 %left '^'
-%left NOT "Not"
+%left NOT
 %precedence INVERSION
 %precedence '.'
  /* WORKAROUND: Bison can't handle "sandwhich" operators which surround the 2nd part of a binary expression */
@@ -75,61 +97,182 @@
 %precedence '('
 %precedence GROUPING
 
-%type <expr> expression
-%type <expr_list> expression_list
+%type <expr> expression target
+%type <expr_list> expression_list subscripts
+%type <index> statement simple_statement function declarators declarator
+%type <index> if_then while_header do_header for_header
+%type <chain> if_chain
 
 %{
 int yylex();
 void yyerror(const char *s);
+
+/* Locations are byte offsets (see parser/source.h), a rule is located at its first symbol */
+#define YYLLOC_DEFAULT(Current, Rhs, N) ((Current) = YYRHSLOC(Rhs, (N) ? 1 : 0))
+
+/* Bison's stack lives on the heap, only deeply nested expressions need it to grow this far */
+#define YYMAXDEPTH 10000000
 %}
 
 %%
 
-top: /* nothing */
-	| expression_list {print_expr($1.expression);}
+top: unit {finish_parse();}
+
+ /* A line with a syntax error is skipped and reported, parsing resumes on the next one */
+unit:
+	  %empty
+	| unit EOL
+	| unit statement {finish_statement($2);}
+	| unit function {finish_statement($2);}
+	| unit DIRECTIVE EOL {check_directive($2.str, $2.len, @2);}
+	| unit error EOL {skip_statement(); yyerrok;}
+
+block:
+	  %empty
+	| block EOL
+	| block statement
+	| block DIRECTIVE EOL {check_directive($2.str, $2.len, @2);}
+	| block error EOL {yyerrok;}
+
+function:
+	  FUNC WORD '(' {begin_function();} parameters ')' {mark_parameters();} EOL block ENDFUNC EOL {$$ = end_function($2.str, $2.len);}
+
+parameters:
+	  %empty
+	| parameter_list
+
+parameter_list:
+	  parameter
+	| parameter_list ',' parameter
+
+parameter:
+	  parameter_flags VARIABLE {add_declaration($2.str, $2.len, NULL, NULL);}
+	| parameter_flags VARIABLE '=' expression {add_declaration($2.str, $2.len, &$4, NULL);}
+
+parameter_flags:
+	  %empty {begin_declaration(SCO_LOCAL, false, false, false);}
+	| BYREF {begin_declaration(SCO_LOCAL, false, false, true);}
+	| CONST {begin_declaration(SCO_LOCAL, true, false, false);}
+	| BYREF CONST {begin_declaration(SCO_LOCAL, true, false, true);}
+
+statement:
+	  simple_statement EOL {$$ = $1;}
+	| if_then simple_statement EOL {$$ = $1; close_statement($1);}
+	| if_chain ENDIF EOL {$$ = $1.first; close_if($1.first, $1.last);}
+	| if_chain ELSE {add_else($1.last);} EOL block ENDIF EOL {$$ = $1.first; close_if($1.first, $1.last);}
+	| while_header block WEND EOL {$$ = $1; close_statement($1);}
+	| do_header block UNTIL expression EOL {$$ = $1; close_do($1, &$4);}
+	| for_header block NEXT EOL {$$ = $1; close_statement($1);}
+
+simple_statement:
+	  expression {$$ = add_statement(SMT_EXPRESSION, &$1);}
+	| target '=' expression {
+		struct Expression assignment = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_ASS);
+		assignment.offset = @$;
+		$$ = add_statement(SMT_EXPRESSION, &assignment);
+	}
+	| declaration_scope declarators {$$ = $2;}
+	| RETURN {$$ = add_statement(SMT_RETURN, NULL);}
+	| RETURN expression {$$ = add_statement(SMT_RETURN, &$2);}
+	| EXIT {$$ = add_statement(SMT_EXIT, NULL);}
+	| EXIT expression {$$ = add_statement(SMT_EXIT, &$2);}
+	| EXITLOOP {$$ = add_statement(SMT_EXIT_LOOP, NULL);}
+	| EXITLOOP expression {$$ = add_statement(SMT_EXIT_LOOP, &$2);}
+	| CONTINUELOOP {$$ = add_statement(SMT_CONTINUE_LOOP, NULL);}
+	| CONTINUELOOP expression {$$ = add_statement(SMT_CONTINUE_LOOP, &$2);}
+	| REDIM target {$$ = add_statement(SMT_REDIM, &$2);}
+
+declaration_scope:
+	  DIM {begin_declaration(SCO_AUTO, false, false, false);}
+	| LOCAL {begin_declaration(SCO_LOCAL, false, false, false);}
+	| GLOBAL {begin_declaration(SCO_GLOBAL, false, false, false);}
+	| CONST {begin_declaration(SCO_AUTO, true, false, false);}
+	| DIM CONST {begin_declaration(SCO_AUTO, true, false, false);}
+	| LOCAL CONST {begin_declaration(SCO_LOCAL, true, false, false);}
+	| GLOBAL CONST {begin_declaration(SCO_GLOBAL, true, false, false);}
+	| STATIC {begin_declaration(SCO_AUTO, false, true, false);}
+	| STATIC LOCAL {begin_declaration(SCO_LOCAL, false, true, false);}
+	| LOCAL STATIC {begin_declaration(SCO_LOCAL, false, true, false);}
+
+declarators:
+	  declarator {$$ = $1;}
+	| declarators ',' declarator {$$ = $1;}
+
+declarator:
+	  VARIABLE {$$ = add_declaration($1.str, $1.len, NULL, NULL);}
+	| VARIABLE '=' expression {$$ = add_declaration($1.str, $1.len, &$3, NULL);}
+	| VARIABLE '[' ']' {$$ = add_declaration($1.str, $1.len, NULL, &(struct ExpressionList){.count = 0});}
+	| VARIABLE subscripts {$$ = add_declaration($1.str, $1.len, NULL, &$2);}
+	| VARIABLE subscripts '=' expression {$$ = add_declaration($1.str, $1.len, &$4, &$2);}
+
+subscripts:
+	  '[' expression ']' {$$ = exprlist_from_expr(&$2);}
+	| subscripts '[' expression ']' {$$ = exprlist_append(&$1, &$3);}
+
+if_then:
+	  IF expression THEN {$$ = add_statement(SMT_IF, &$2);}
+
+if_chain:
+	  if_then EOL block {$$.first = $$.last = $1;}
+	| if_chain ELSEIF expression THEN {$<index>$ = add_else_if($1.last, &$3);} EOL block {$$.first = $1.first; $$.last = $<index>5;}
+
+while_header:
+	  WHILE expression EOL {$$ = add_statement(SMT_WHILE, &$2);}
+
+do_header:
+	  DO EOL {$$ = add_statement(SMT_DO, NULL);}
+
+for_header:
+	  FOR VARIABLE '=' expression TO expression EOL {$$ = add_for($2.str, $2.len, &$4, &$6, NULL);}
+	| FOR VARIABLE '=' expression TO expression STEP expression EOL {$$ = add_for($2.str, $2.len, &$4, &$6, &$8);}
+	| FOR VARIABLE IN expression EOL {$$ = add_for_in($2.str, $2.len, &$4);}
 
 expression:
-	  BOOL {$$ = expr_from_prim(&(struct Primitive){.type = PRI_BOOLEAN, .boolean = $1});}
-	| NUMBER {$$ = expr_from_prim(&(struct Primitive){.type = PRI_NUMBER, .number = $1});}
-	| STRING {$$ = expr_from_str($1.str, $1.len);}
-	| WORD {$$ = expr_from_ident($1.str, $1.len);}
-	| MACRO {$$ = expr_from_ident($1.str, $1.len);}
-	| VARIABLE {$$ = expr_from_ident($1.str, $1.len);}
-	| expression '?' expression ':' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3, &$5}, 3, OP_CON);}
-	| expression "And" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_AND);}
-	| expression "Or" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_OR);}
-	| expression '<' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_LT);}
-	| expression '>' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_GT);}
-	| expression '=' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_EQU);}
-	| expression "<=" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_LTE);}
-	| expression ">=" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_GTE);}
-	| expression "<>" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_NEQ);}
-	| expression "==" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_SEQU);}
-	| expression '&' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_CAT);}
-	| expression '+' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_ADD);}
-	| expression '-' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_SUB);}
-	| expression '*' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_MUL);}
-	| expression '/' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_DIV);}
-	| expression '^' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_EXP);}
-	| "Not" expression {$$ = expr_from_expr((struct Expression *[]){&$2}, 1, OP_NOT);}
-	| '-' expression %prec INVERSION {$$ = expr_from_expr((struct Expression *[]){&$2}, 1, OP_INV);}
+	  BOOL {$$ = expr_from_prim(&(struct Primitive){.type = PRI_BOOLEAN, .boolean = $1}); $$.offset = @$;}
+	| NUMBER {$$ = expr_from_prim(&$1); $$.offset = @$;}
+	| STRING {$$ = expr_from_str($1.str, $1.len); $$.offset = @$;}
+	| WORD {$$ = expr_from_ident($1.str, $1.len); $$.offset = @$;}
+	| MACRO {$$ = expr_from_ident($1.str, $1.len); $$.offset = @$;}
+	| target %prec TARGET {$$ = $1;}
+	| expression '?' expression ':' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3, &$5}, 3, OP_CON); $$.offset = @$;}
+	| expression "And" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_AND); $$.offset = @$;}
+	| expression "Or" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_OR); $$.offset = @$;}
+	| expression '<' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_LT); $$.offset = @$;}
+	| expression '>' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_GT); $$.offset = @$;}
+	| expression '=' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_EQU); $$.offset = @$;}
+	| expression "<=" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_LTE); $$.offset = @$;}
+	| expression ">=" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_GTE); $$.offset = @$;}
+	| expression "<>" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_NEQ); $$.offset = @$;}
+	| expression "==" expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_SEQU); $$.offset = @$;}
+	| expression '&' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_CAT); $$.offset = @$;}
+	| expression '+' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_ADD); $$.offset = @$;}
+	| expression '-' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_SUB); $$.offset = @$;}
+	| expression '*' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_MUL); $$.offset = @$;}
+	| expression '/' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_DIV); $$.offset = @$;}
+	| expression '^' expression {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_EXP); $$.offset = @$;}
+	| "Not" expression {$$ = expr_from_expr((struct Expression *[]){&$2}, 1, OP_NOT); $$.offset = @$;}
+	| '-' expression %prec INVERSION {$$ = expr_from_expr((struct Expression *[]){&$2}, 1, OP_INV); $$.offset = @$;}
+	| expression '(' expression_list ')' {$$ = expr_from_call(&$1, &$3); $$.offset = @$;}
+	| expression '(' ')' {$$ = expr_from_call(&$1, NULL); $$.offset = @$;}
+	/* | expression '(' expression_list ')' %prec CALL {$$ = expr_from_call(&$1, &$3);}
+	| expression '(' ')' %prec CALL {$$ = expr_from_call(&$1, NULL);} */
+	| '(' expression ')' %prec GROUPING {$$ = $2;}
+
+ /* What can be assigned to, the right side of an assignment is a whole expression (`$a = $b = $c` compares) */
+target:
+	  VARIABLE {$$ = expr_from_ident($1.str, $1.len); $$.offset = @$;}
 	/*| expression '.' WORD {$$ = expr_from_expr((struct Expression *[]){&$1, &(struct Expression){expr_from_ident($3.str, $3.len)}}, 2, OP_ACC);}*/
 	| expression '.' WORD {
 		struct Expression ident_expr = expr_from_ident($3.str, $3.len);
+		ident_expr.offset = @3;
 		$$ = expr_from_expr((struct Expression *[]){&$1, &ident_expr}, 2, OP_ACC);
+		$$.offset = @$;
 	}
-	| expression '[' expression ']' {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_ACC);}
-	| expression '(' expression_list ')' {$$ = expr_from_call(&$1, &$3);}
-	| expression '(' ')' {$$ = expr_from_call(&$1, NULL);}
-	/* | expression '(' expression_list ')' %prec CALL {$$ = expr_from_call(&$1, &$3);}
-	| expression '(' ')' %prec CALL {$$ = expr_from_call(&$1, NULL);} */
-	| '(' expression ')' %prec GROUPING {$$ = $2;}
+	| expression '[' expression ']' {$$ = expr_from_expr((struct Expression *[]){&$1, &$3}, 2, OP_ACC); $$.offset = @$;}
 
 expression_list:
-	/*  expression {$$ = (struct ExpressionList){.expression = , .list = NULL};}
-	| expression ',' expression_list {$$ = (struct ExpressionList){.expression = &$1, .list = &$3};} */
-	  expression {$$ = exprlist_from_expr(&$1, NULL);}
-	| expression ',' expression_list {$$ = exprlist_from_expr(&$1, &$3);}
+	  expression {$$ = exprlist_from_expr(&$1);}
+	| expression_list ',' expression {$$ = exprlist_append(&$1, &$3);}
 
 %%
 
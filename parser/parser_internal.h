@@ -2,7 +2,9 @@
 #define PARSER_INTERNAL_H
 
 #include "jansson.h"
+#include "parser/tree.h"
 
+struct Primitive prim_from_number(char *str, size_t len);
 struct Operand operand_from_prim(struct Primitive *primitive);
 struct Operand operand_from_expr(struct Expression *expression);
 struct Operand operand_from_exprlist(struct ExpressionList *expression_list);
@@ -11,11 +13,33 @@ struct Expression expr_from_str(char *str, size_t len);
 struct Expression expr_from_ident(char *ident, size_t len);
 struct Expression expr_from_call(struct Expression *caller, struct ExpressionList *arguments);
 struct Expression expr_from_expr(struct Expression *exp_list[], unsigned short count, enum Operation op);
-struct ExpressionList exprlist_from_expr(struct Expression *expr, struct ExpressionList *list);
+struct ExpressionList exprlist_from_expr(struct Expression *expr);
+struct ExpressionList exprlist_append(struct ExpressionList *list, struct Expression *expr);
+unsigned short expr_operand_count(struct Expression *expr);
 struct Expression binary_expr(struct Expression *a, struct Expression *b, enum Operation op);
+void yyerror(const char *s);
+void finish_parse(void);
+void finish_statement(uint32_t index);
+void skip_statement(void);
+void check_directive(char *str, size_t len, size_t offset);
+uint32_t add_statement(enum StatementType type, struct Expression *expression);
+void close_statement(uint32_t index);
+void begin_declaration(enum Scope scope, bool is_constant, bool is_static, bool is_reference);
+uint32_t add_declaration(char *name, size_t len, struct Expression *initializer, struct ExpressionList *dimensions);
+void begin_function(void);
+void mark_parameters(void);
+uint32_t end_function(char *name, size_t len);
+uint32_t add_else_if(uint32_t previous, struct Expression *condition);
+void add_else(uint32_t last);
+void close_if(uint32_t first, uint32_t last);
+void close_do(uint32_t index, struct Expression *condition);
+uint32_t add_for(char *name, size_t len, struct Expression *start, struct Expression *stop, struct Expression *step);
+uint32_t add_for_in(char *name, size_t len, struct Expression *collection);
 json_t *prim_to_json(struct Primitive *prim);
 json_t *expr_to_json(struct Expression *expr);
 json_t *exprlist_to_json(struct ExpressionList *expr_list);
+json_t *statement_to_json(struct Statement *statement);
+json_t *block_to_json(struct Statement block[], size_t size);
 void print_expr(struct Expression *expr);
 
 #endif
@@ -0,0 +1,276 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "alloc/alloc.h"
+#include "cease/cease.h"
+#include "parser/parser_internal.h"
+#include "parser/resolve.h"
+#include "parser/tree.h"
+#include "utils.h"
+
+#define SYMTAB_MIN_CAPACITY 16
+
+static char *err_mem_ctx = "resolving variables";
+
+static void collect_globals(struct Resolver *resolver, struct Statement block[], size_t size, bool top_level);
+static struct Symbol *declare(struct Resolver *resolver, struct Declaration *declaration);
+static void resolve_variable(struct Resolver *resolver, struct Operand *operand);
+static struct Symbol *symtab_add(struct Resolver *resolver, struct SymbolTable *table, char *name, enum Scope scope, size_t slot);
+static uint32_t symbol_hash(char *name);
+static char *variable_name(char *name);
+
+struct Resolver resolver_init(Allocator *alloc) {
+	return (struct Resolver){
+		.alloc = alloc,
+		.globals = {.entries = NULL},
+		.locals = NULL,
+	};
+}
+
+void resolve_statements(struct Resolver *resolver, struct Statement block[], size_t size) {
+	// Globals are declared beforehand so that functions can use globals which are declared after them
+	if (!resolver->locals) collect_globals(resolver, block, size, true);
+	
+	// Nested statements are stored after their parent in the same block, so a linear scan visits all of them
+	for (size_t i = 0; i < size; ++i) {
+		struct Statement *statement = &block[i];
+		switch (statement->type) {
+			case SMT_DECLARATION:
+				resolve_declaration(resolver, statement->declaration);
+				break;
+			case SMT_FOR:
+				for (int j = 0; j < 4; ++j) resolve_expression(resolver, &statement->expressions[j]);
+				break;
+			case SMT_FOR_IN:
+				for (int j = 0; j < 2; ++j) resolve_expression(resolver, &statement->expressions[j]);
+				break;
+			default:
+				if (statement->expression) resolve_expression(resolver, statement->expression);
+				break;
+		}
+	}
+}
+
+void resolve_declaration(struct Resolver *resolver, struct Declaration *declaration) {
+	if (declaration->is_function) {
+		struct SymbolTable *locals = alloc_ctx(resolver->alloc, sizeof *locals, err_mem_ctx);
+		*locals = (struct SymbolTable){.entries = NULL};
+		declaration->code.locals = locals;
+		
+		struct SymbolTable *outer = resolver->locals;
+		resolver->locals = locals;
+		resolve_statements(resolver, declaration->code.block, declaration->code.size);
+		resolver->locals = outer;
+		return;
+	}
+	
+	// The initializer is resolved first, `Local $x = $x` refers to the outer variable
+	if (declaration->initializer) resolve_expression(resolver, declaration->initializer);
+	if (declaration->dimensions) resolve_exprlist(resolver, declaration->dimensions);
+	struct Symbol *symbol = declare(resolver, declaration);
+	symbol->is_constant = declaration->is_constant;
+	symbol->is_static = declaration->is_static;
+	
+	declaration->variable = alloc_ctx(resolver->alloc, sizeof *declaration->variable, err_mem_ctx);
+	*declaration->variable = (struct Variable){
+		.scope = symbol->scope,
+		.slot = symbol->slot,
+		.name = symbol->name,
+	};
+}
+
+void resolve_expression(struct Resolver *resolver, struct Expression *expression) {
+	// Nested expressions are visited with an explicit stack so that deep trees can't overflow the C stack
+	struct Expression **stack = NULL;
+	size_t stack_len = 0, stack_cap = 0;
+	
+	#define PUSH(expr) { \
+		struct Expression **new_stack = grow_array(stack, &stack_cap, stack_len, sizeof *stack); \
+		if (!new_stack) { \
+			free(stack); \
+			cease_mem(resolver->alloc->point, err_mem_ctx); \
+		} \
+		stack = new_stack; \
+		stack[stack_len++] = (expr); \
+	}
+	
+	while (true) {
+		unsigned short count = expr_operand_count(expression);
+		for (unsigned short i = 0; i < count; ++i) {
+			struct Operand *operand = &expression->operands[i];
+			switch (operand->type) {
+				case OPE_EXPRESSION:
+					PUSH(operand->expression);
+					break;
+				case OPE_EXPRESSION_LIST:
+					for (size_t j = 0; j < operand->expression_list->count; ++j) PUSH(&operand->expression_list->expressions[j]);
+					break;
+				case OPE_IDENTIFIER:
+					if (operand->identifier[0] == '$') resolve_variable(resolver, operand);
+					break;
+				default:
+					break;
+			}
+		}
+		
+		if (!stack_len) break;
+		expression = stack[--stack_len];
+	}
+	
+	#undef PUSH
+	
+	free(stack);
+}
+
+void resolve_exprlist(struct Resolver *resolver, struct ExpressionList *list) {
+	for (size_t i = 0; i < list->count; ++i) resolve_expression(resolver, &list->expressions[i]);
+}
+
+struct Symbol *resolve_by_name(struct Resolver *resolver, struct SymbolTable *locals, char *name) {
+	// Fallback for `Eval`, `Assign` and `IsDeclared` which look up variables at runtime
+	name = variable_name(name);
+	struct Symbol *symbol = locals ? symtab_find(locals, name) : NULL;
+	if (!symbol) symbol = symtab_find(&resolver->globals, name);
+	return symbol;
+}
+
+struct Symbol *symtab_find(struct SymbolTable *table, char *name) {
+	if (!table->count) return NULL;
+	size_t mask = table->capacity - 1;
+	for (size_t i = symbol_hash(name) & mask;; i = (i + 1) & mask) {
+		struct Symbol *entry = &table->entries[i];
+		if (!entry->name) return NULL;
+		if (strcasecmp(entry->name, name) == 0) return entry;
+	}
+}
+
+static void collect_globals(struct Resolver *resolver, struct Statement block[], size_t size, bool top_level) {
+	for (size_t i = 0; i < size; ++i) {
+		if (block[i].type != SMT_DECLARATION) continue;
+		struct Declaration *declaration = block[i].declaration;
+		if (declaration->is_function) {
+			if (top_level) collect_globals(resolver, declaration->code.block, declaration->code.size, false);
+			continue;
+		}
+		if (!top_level && declaration->scope != SCO_GLOBAL) continue;
+		
+		// Any declaration at the top level is global, regardless of its scope keyword
+		char *name = variable_name(declaration->name);
+		if (!symtab_find(&resolver->globals, name)) {
+			symtab_add(resolver, &resolver->globals, name, SCO_GLOBAL, resolver->globals.slots++);
+		}
+	}
+}
+
+static struct Symbol *declare(struct Resolver *resolver, struct Declaration *declaration) {
+	char *name = variable_name(declaration->name);
+	struct SymbolTable *globals = &resolver->globals;
+	struct SymbolTable *locals = resolver->locals;
+	struct Symbol *symbol;
+	
+	if (!locals || declaration->scope == SCO_GLOBAL) {
+		symbol = symtab_find(globals, name);
+		if (!symbol) symbol = symtab_add(resolver, globals, name, SCO_GLOBAL, globals->slots++);
+		return symbol;
+	}
+	
+	symbol = symtab_find(locals, name);
+	if (symbol) return symbol;
+	
+	if (declaration->is_static) {
+		// Static variables outlive the call, so they live in a hidden global slot which is only visible by name in the function
+		return symtab_add(resolver, locals, name, SCO_GLOBAL, globals->slots++);
+	}
+	
+	// `Dim` reuses an existing global variable
+	if (declaration->scope == SCO_AUTO && (symbol = symtab_find(globals, name))) return symbol;
+	
+	return symtab_add(resolver, locals, name, SCO_LOCAL, locals->slots++);
+}
+
+static void resolve_variable(struct Resolver *resolver, struct Operand *operand) {
+	char *name = variable_name(operand->identifier);
+	struct Symbol *symbol = resolve_by_name(resolver, resolver->locals, name);
+	if (!symbol) {
+		// Undeclared variables are implicitly declared in the current scope, same as an assignment would do
+		struct SymbolTable *table = resolver->locals ? resolver->locals : &resolver->globals;
+		symbol = symtab_add(resolver, table, name, resolver->locals ? SCO_LOCAL : SCO_GLOBAL, table->slots++);
+	}
+	
+	struct Variable *variable = alloc_ctx(resolver->alloc, sizeof *variable, err_mem_ctx);
+	*variable = (struct Variable){
+		.scope = symbol->scope,
+		.slot = symbol->slot,
+		.name = symbol->name,
+	};
+	operand->type = OPE_VARIABLE;
+	operand->variable = variable;
+}
+
+static struct Symbol *symtab_add(struct Resolver *resolver, struct SymbolTable *table, char *name, enum Scope scope, size_t slot) {
+	// Keep the load factor under 3/4
+	if ((table->count + 1) * 4 > table->capacity * 3) {
+		size_t capacity = table->capacity ? table->capacity * 2 : SYMTAB_MIN_CAPACITY;
+		struct Symbol *entries = alloc_ctx(resolver->alloc, sizeof *entries * capacity, err_mem_ctx);
+		memset(entries, 0, sizeof *entries * capacity);
+		for (size_t i = 0; i < table->capacity; ++i) {
+			struct Symbol *entry = &table->entries[i];
+			if (!entry->name) continue;
+			size_t j = symbol_hash(entry->name) & (capacity - 1);
+			while (entries[j].name) j = (j + 1) & (capacity - 1);
+			entries[j] = *entry;
+		}
+		if (table->entries) alloc_free(resolver->alloc, table->entries);
+		table->entries = entries;
+		table->capacity = capacity;
+	}
+	
+	size_t mask = table->capacity - 1;
+	size_t i = symbol_hash(name) & mask;
+	while (table->entries[i].name) i = (i + 1) & mask;
+	table->entries[i] = (struct Symbol){
+		.name = name,
+		.scope = scope,
+		.slot = slot,
+	};
+	++table->count;
+	return &table->entries[i];
+}
+
+static uint32_t symbol_hash(char *name) {
+	// FNV-1a of the case-folded name
+	uint32_t hash = 2166136261u;
+	for (; *name; ++name) {
+		hash ^= (unsigned char) tolower((unsigned char) *name);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static char *variable_name(char *name) {
+	return name[0] == '$' ? name + 1 : name;
+}
@@ -0,0 +1,58 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARSER_RESOLVE_H
+#define PARSER_RESOLVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "alloc/alloc.h"
+#include "parser/tree.h"
+
+struct Symbol {
+	char *name; // Without the leading '$', NULL if the entry is empty
+	enum Scope scope;
+	size_t slot;
+	bool is_constant : 1;
+	bool is_static : 1;
+};
+
+struct SymbolTable {
+	// Open addressing hash table with case-insensitive names
+	struct Symbol *entries;
+	size_t count;
+	size_t capacity;
+	size_t slots; // Number of slots in the frame of this scope
+};
+
+struct Resolver {
+	Allocator *alloc;
+	struct SymbolTable globals;
+	struct SymbolTable *locals; // NULL when resolving at the global scope
+};
+
+struct Resolver resolver_init(Allocator *alloc);
+void resolve_statements(struct Resolver *resolver, struct Statement block[], size_t size);
+void resolve_declaration(struct Resolver *resolver, struct Declaration *declaration);
+void resolve_expression(struct Resolver *resolver, struct Expression *expression);
+void resolve_exprlist(struct Resolver *resolver, struct ExpressionList *list);
+struct Symbol *resolve_by_name(struct Resolver *resolver, struct SymbolTable *locals, char *name);
+struct Symbol *symtab_find(struct SymbolTable *table, char *name);
+
+#endif
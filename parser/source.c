@@ -0,0 +1,106 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parser/source.h"
+#include "utils.h"
+
+static struct SourceFile *files = NULL;
+static size_t files_len = 0, files_cap = 0;
+
+size_t source_add(char *name, char *code, size_t size) {
+	struct SourceFile *new_files = grow_array(files, &files_cap, files_len, sizeof *files);
+	if (!new_files) return SOURCE_ERROR;
+	files = new_files;
+	
+	// One extra offset is left after each file for its end
+	struct SourceFile *file = &files[files_len];
+	*file = (struct SourceFile){
+		.base = files_len ? files[files_len - 1].base + files[files_len - 1].size + 1 : 0,
+		.size = size,
+	};
+	file->name = strdup(name);
+	if (!file->name) return SOURCE_ERROR;
+	
+	// Index the newlines, memchr is vectorized by the C library so this is a lot quicker than checking every token
+	size_t newlines_cap = 0;
+	char *end = code + size;
+	for (char *newline = code; (newline = memchr(newline, '\n', end - newline)); ++newline) {
+		size_t *new_newlines = grow_array(file->newlines, &newlines_cap, file->newline_count, sizeof *file->newlines);
+		if (!new_newlines) {
+			free(file->newlines);
+			free(file->name);
+			return SOURCE_ERROR;
+		}
+		file->newlines = new_newlines;
+		file->newlines[file->newline_count++] = newline - code;
+	}
+	
+	++files_len;
+	return file->base;
+}
+
+bool source_position(size_t offset, struct SourcePosition *position) {
+	// Find the last file starting at or before the offset
+	size_t low = 0, high = files_len;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (files[mid].base <= offset) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (low == 0) return false;
+	struct SourceFile *file = &files[low - 1];
+	offset -= file->base;
+	if (offset > file->size) return false;
+	
+	// Count the newlines before the offset
+	low = 0;
+	high = file->newline_count;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (file->newlines[mid] < offset) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	
+	position->file = file->name;
+	position->line = low + 1;
+	position->column = offset - (low ? file->newlines[low - 1] + 1 : 0) + 1;
+	return true;
+}
+
+void source_free(void) {
+	for (size_t i = 0; i < files_len; ++i) {
+		free(files[i].name);
+		free(files[i].newlines);
+	}
+	free(files);
+	files = NULL;
+	files_len = files_cap = 0;
+}
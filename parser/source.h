@@ -0,0 +1,52 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PARSER_SOURCE_H
+#define PARSER_SOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SOURCE_ERROR SIZE_MAX
+
+/*
+ * Every file read by the lexer is placed one after another in a single offset
+ * space, so a plain byte offset on a token or node identifies both the file and
+ * the position in it. Lines and columns are only worked out when they are needed.
+ */
+struct SourceFile {
+	char *name;
+	size_t base; // Offset of the first byte
+	size_t size;
+	size_t *newlines; // Offsets of every newline relative to base, in order
+	size_t newline_count;
+};
+
+struct SourcePosition {
+	char *file;
+	size_t line, column;
+};
+
+size_t source_add(char *name, char *code, size_t size);
+bool source_position(size_t offset, struct SourcePosition *position);
+void source_free(void);
+
+#endif
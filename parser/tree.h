@@ -22,6 +22,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 enum TokenType {
 	TOK_UNKNOWN,
@@ -162,25 +163,37 @@ struct Token {
 
 struct Primitive {
 	enum {
-		PRI_NUMBER,
+		PRI_NUMBER, // Double
 		PRI_STRING,
 		PRI_BOOLEAN,
+		PRI_INT32,
+		PRI_INT64,
 		// ...
 	} type;
 	union {
 		double number;
+		int64_t integer; // Int32 and Int64
 		char *string;
 		bool boolean;
 	};
 };
 
+enum Scope {SCO_AUTO, SCO_LOCAL, SCO_GLOBAL};
+
+struct Variable {
+	enum Scope scope; // Only local or global after resolution
+	size_t slot;
+	char *name;
+};
+
 struct Expression;
+struct SymbolTable;
 
 struct Operand {
 	enum {
 		OPE_PRIMITIVE,
 		OPE_IDENTIFIER,
-		//OPE_VARIABLE,
+		OPE_VARIABLE,
 		//OPE_MACRO,
 		OPE_EXPRESSION,
 		OPE_EXPRESSION_LIST,
@@ -188,7 +201,7 @@ struct Operand {
 	union {
 		struct Primitive *value;
 		char *identifier;
-		//struct Variable *variable;
+		struct Variable *variable;
 		//struct Macro *macro;
 		struct Expression *expression;
 		struct ExpressionList *expression_list;
@@ -197,39 +210,67 @@ struct Operand {
 
 struct Expression {
 	enum Operation op;
+	bool is_shared; // The operands belong to a shared node, see parser/intern.h
 	struct Operand *operands;
+	size_t offset; // Location of the first token, see parser/source.h
 };
 
 struct ExpressionList {
-	struct Expression *expression;
-	struct ExpressionList *list;
+	struct Expression *expressions;
+	size_t count;
 };
 
 struct Declaration {
-	enum {SCO_AUTO, SCO_LOCAL, SCO_GLOBAL} scope;
+	enum Scope scope;
 	bool is_constant : 1;
 	bool is_static : 1;
 	bool is_function : 1;
+	bool is_reference : 1; // ByRef parameter
 	char *name;
 	union {
 		// Variable or constant
-		struct Expression *initializer;
+		struct {
+			struct Expression *initializer;
+			struct ExpressionList *dimensions; // Only for arrays, empty for maps
+			struct Variable *variable; // Filled in by the resolver
+		};
 		// Function
 		struct {
-			struct Statement *block;
+			struct Statement *block; // Starts with the declarations of the parameters
 			size_t size;
+			uint32_t parameters;
+			struct SymbolTable *locals; // Filled in by the resolver
 		} code;
 	};
 };
 
+/*
+ * Statements are stored in flat arrays of fixed-size records, one array for each
+ * function body and one for the top level. The body of a statement follows it in
+ * the same array and is referred to by 32-bit indices, so the statements of a block
+ * are visited by skipping to `end` and the whole array by a plain linear scan.
+ */
 struct Statement {
 	enum StatementType {
 		SMT_DECLARATION,
 		SMT_EXPRESSION,
+		SMT_IF,
+		SMT_WHILE,
+		SMT_DO,
+		SMT_FOR,
+		SMT_FOR_IN,
+		SMT_RETURN,
+		SMT_EXIT,
+		SMT_EXIT_LOOP,
+		SMT_CONTINUE_LOOP,
+		SMT_REDIM,
 	} type;
+	uint32_t end; // Index of the first statement after this one and its body
+	uint32_t alternative; // If: Index of the first statement of the Else part, same as end when there is none
 	union {
 		struct Declaration *declaration;
-		struct Expression *expression;
+		struct Expression *expression; // Condition of If, While and Do, optional value of Return, Exit, ExitLoop and ContinueLoop, array with the new bounds of ReDim
+		struct Expression *expressions; // For: Variable, start, stop and step. For...In: Variable and collection.
 	};
 };
 
@@ -0,0 +1,174 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runtime/array.h"
+#include "runtime/heap.h"
+#include "runtime/value.h"
+
+#define ARRAY_MIN_CAPACITY 8
+
+static bool array_reserve(struct Array *array, size_t size);
+static void array_copy_common(struct Array *dest, struct Array *src);
+
+struct Array *array_new(size_t bounds[], unsigned char dimensions) {
+	if (dimensions == 0 || dimensions > ARRAY_MAX_DIMENSIONS) return NULL;
+	
+	struct Array *array = malloc(sizeof *array);
+	if (!array) return NULL;
+	*array = (struct Array){.dimensions = dimensions, .elements = NULL};
+	array->dim = malloc(sizeof *array->dim * dimensions);
+	if (!array->dim) goto fail;
+	
+	// Calculate the strides from the innermost dimension outwards
+	size_t size = 1;
+	for (unsigned char i = dimensions; i-- > 0;) {
+		array->dim[i].bound = bounds[i];
+		array->dim[i].stride = size;
+		if (__builtin_mul_overflow(size, bounds[i], &size)) goto fail;
+	}
+	
+	array->size = size;
+	array->capacity = size;
+	if (size) {
+		if (size > SIZE_MAX / sizeof *array->elements) goto fail;
+		array->elements = calloc(size, sizeof *array->elements);
+		if (!array->elements) goto fail;
+	}
+	
+	return array;
+	
+	fail:
+	free(array->dim);
+	free(array);
+	return NULL;
+}
+
+bool array_redim(struct Array *array, size_t bounds[], unsigned char dimensions) {
+	// Check if only the first dimension is changing
+	bool same_layout = dimensions == array->dimensions;
+	for (unsigned char i = 1; same_layout && i < dimensions; ++i) {
+		same_layout = bounds[i] == array->dim[i].bound;
+	}
+	
+	if (same_layout) {
+		// Rows are stored back to back, so the existing elements stay where they are
+		size_t size;
+		if (__builtin_mul_overflow(bounds[0], array->dim[0].stride, &size)) return false;
+		if (size > array->capacity && !array_reserve(array, size)) return false;
+		if (size > array->size) memset(array->elements + array->size, 0, sizeof *array->elements * (size - array->size));
+		for (size_t i = size; i < array->size; ++i) heap_release(&array->elements[i]);
+		array->dim[0].bound = bounds[0];
+		array->size = size;
+		return true;
+	}
+	
+	// Rebuild the array, preserving elements only if the number of dimensions is unchanged
+	struct Array *new_array = array_new(bounds, dimensions);
+	if (!new_array) return false;
+	if (dimensions == array->dimensions) array_copy_common(new_array, array);
+	
+	// The elements which were kept are referenced twice for a moment, the old array's references are dropped
+	for (size_t i = 0; i < new_array->size; ++i) heap_retain(&new_array->elements[i]);
+	for (size_t i = 0; i < array->size; ++i) heap_release(&array->elements[i]);
+	
+	// The array stays where it is, only its contents are replaced
+	free(array->elements);
+	free(array->dim);
+	array->elements = new_array->elements;
+	array->size = new_array->size;
+	array->capacity = new_array->capacity;
+	array->dimensions = new_array->dimensions;
+	array->dim = new_array->dim;
+	free(new_array);
+	return true;
+}
+
+struct Value *array_at(struct Array *array, size_t indices[], unsigned char count) {
+	if (count != array->dimensions) return NULL;
+	size_t offset = 0;
+	for (unsigned char i = 0; i < count; ++i) {
+		if (indices[i] >= array->dim[i].bound) return NULL;
+		offset += indices[i] * array->dim[i].stride;
+	}
+	return array->elements + offset;
+}
+
+size_t array_bound(struct Array *array, unsigned char dimension) {
+	if (dimension >= array->dimensions) return 0;
+	return array->dim[dimension].bound;
+}
+
+void array_free(struct Array *array) {
+	// The elements aren't released, the heap takes care of that when it frees an array
+	if (!array) return;
+	free(array->elements);
+	free(array->dim);
+	free(array);
+}
+
+static bool array_reserve(struct Array *array, size_t size) {
+	// Grow geometrically so that repeated ReDims take amortized constant time
+	size_t capacity = array->capacity < ARRAY_MIN_CAPACITY ? ARRAY_MIN_CAPACITY : array->capacity;
+	while (capacity < size) {
+		if (capacity > SIZE_MAX / 2) {
+			capacity = size;
+			break;
+		}
+		capacity *= 2;
+	}
+	if (capacity > SIZE_MAX / sizeof *array->elements) return false;
+	
+	struct Value *elements = realloc(array->elements, sizeof *array->elements * capacity);
+	if (!elements) return false;
+	array->elements = elements;
+	array->capacity = capacity;
+	return true;
+}
+
+static void array_copy_common(struct Array *dest, struct Array *src) {
+	// Find the common region
+	size_t common[ARRAY_MAX_DIMENSIONS];
+	unsigned char dimensions = dest->dimensions;
+	for (unsigned char i = 0; i < dimensions; ++i) {
+		common[i] = dest->dim[i].bound < src->dim[i].bound ? dest->dim[i].bound : src->dim[i].bound;
+		if (common[i] == 0) return;
+	}
+	
+	// Copy one innermost row at a time, counting through the outer indices like an odometer
+	size_t indices[ARRAY_MAX_DIMENSIONS] = {0};
+	unsigned char last = dimensions - 1;
+	size_t row_size = sizeof *dest->elements * common[last];
+	while (true) {
+		size_t dest_offset = 0, src_offset = 0;
+		for (unsigned char i = 0; i < last; ++i) {
+			dest_offset += indices[i] * dest->dim[i].stride;
+			src_offset += indices[i] * src->dim[i].stride;
+		}
+		memcpy(dest->elements + dest_offset, src->elements + src_offset, row_size);
+		
+		unsigned char i = last;
+		while (i > 0 && ++indices[i - 1] == common[i - 1]) indices[--i] = 0;
+		if (i == 0) break;
+	}
+}
@@ -0,0 +1,51 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_ARRAY_H
+#define RUNTIME_ARRAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "runtime/heap.h"
+#include "runtime/value.h"
+
+#define ARRAY_MAX_DIMENSIONS 64
+
+struct ArrayDimension {
+	size_t bound;
+	size_t stride; // Number of elements between two consecutive indices
+};
+
+struct Array {
+	struct HeapObject object;
+	// All elements are stored contiguously in row-major order
+	struct Value *elements;
+	size_t size;
+	size_t capacity;
+	unsigned char dimensions;
+	struct ArrayDimension *dim; // Separate from the array so that it stays in place when it is rebuilt
+};
+
+struct Array *array_new(size_t bounds[], unsigned char dimensions);
+bool array_redim(struct Array *array, size_t bounds[], unsigned char dimensions);
+struct Value *array_at(struct Array *array, size_t indices[], unsigned char count);
+size_t array_bound(struct Array *array, unsigned char dimension);
+void array_free(struct Array *array);
+
+#endif
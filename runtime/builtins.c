@@ -0,0 +1,618 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "cease/cease.h"
+#include "runtime/builtins.h"
+#include "runtime/array.h"
+#include "runtime/bytecode.h"
+#include "runtime/heap.h"
+#include "runtime/regex.h"
+#include "runtime/string.h"
+#include "runtime/value.h"
+#include "runtime/vm.h"
+#include "utils.h"
+
+#define NUMBER(x) ((struct Value){.type = VAL_NUMBER, .number = (x)})
+#define BOOLEAN(x) ((struct Value){.type = VAL_BOOLEAN, .boolean = (x)})
+
+static NativeFunction builtin_abs, builtin_console_write, builtin_console_write_error, builtin_int, builtin_is_bool, builtin_is_number;
+static NativeFunction builtin_is_string, builtin_mod, builtin_number, builtin_sqrt, builtin_string, builtin_string_in_str;
+static NativeFunction builtin_string_left, builtin_string_len, builtin_string_lower, builtin_string_mid, builtin_string_reg_exp;
+static NativeFunction builtin_string_reg_exp_replace, builtin_string_replace, builtin_string_right, builtin_string_split;
+static NativeFunction builtin_string_upper, builtin_u_bound;
+
+static const struct Builtin builtins[] = {
+	{"Abs", builtin_abs, 1, 1, 0},
+	{"ConsoleWrite", builtin_console_write, 1, 1, 0},
+	{"ConsoleWriteError", builtin_console_write_error, 1, 1, 0},
+	{"Int", builtin_int, 1, 1, 0},
+	{"IsBool", builtin_is_bool, 1, 1, 0},
+	{"IsNumber", builtin_is_number, 1, 1, 0},
+	{"IsString", builtin_is_string, 1, 1, 0},
+	{"Mod", builtin_mod, 2, 2, 0},
+	{"Number", builtin_number, 1, 1, 0},
+	{"Sqrt", builtin_sqrt, 1, 1, 0},
+	{"String", builtin_string, 1, 1, 0},
+	{"StringInStr", builtin_string_in_str, 2, 4, 0},
+	{"StringLeft", builtin_string_left, 2, 2, 0},
+	{"StringLen", builtin_string_len, 1, 1, 0},
+	{"StringLower", builtin_string_lower, 1, 1, 0},
+	{"StringMid", builtin_string_mid, 2, 3, 0},
+	{"StringRegExp", builtin_string_reg_exp, 2, 4, 2},
+	{"StringRegExpReplace", builtin_string_reg_exp_replace, 3, 4, 2},
+	{"StringReplace", builtin_string_replace, 3, 5, 0},
+	{"StringRight", builtin_string_right, 2, 2, 0},
+	{"StringSplit", builtin_string_split, 2, 3, 0},
+	{"StringUpper", builtin_string_upper, 1, 1, 0},
+	{"UBound", builtin_u_bound, 1, 2, 0},
+};
+
+#define BUILTIN_COUNT (sizeof builtins / sizeof *builtins)
+#define BUILTIN_BUCKETS (BUILTIN_COUNT / BUILTIN_BUCKET_SIZE + 1)
+#define BUILTIN_SLOTS (BUILTIN_COUNT + BUILTIN_COUNT / 4 + 1) // A load factor of 0.8
+#define BUILTIN_BUCKET_MAX 32 // A bucket with more names than this means the first hash is broken
+#define BUILTIN_SEED_MAX 1000000 // Tries for the seed of one bucket
+_Static_assert(BUILTIN_COUNT < UINT16_MAX, "Size of the table of built-in functions");
+
+struct Splitter {
+	struct String string;
+	struct String delimiters;
+	bool entire; // The delimiters are one delimiter
+	bool is_delimiter[UCHAR_MAX + 1];
+};
+
+static uint16_t slots[BUILTIN_SLOTS]; // Index of the built-in function plus one, zero if the slot is free
+static uint32_t seeds[BUILTIN_BUCKETS]; // The displacement of each bucket, the seed of the hash which picks the slots
+static bool built;
+
+static void build_table(void);
+static uint32_t name_hash(char *name, uint32_t hash_seed);
+static struct Value new_string(struct VM *vm, char *chars, size_t len);
+static size_t clamp_count(struct Value *value, size_t max);
+static struct Value integer_or_number(double number);
+static size_t next_delimiter(struct Splitter *splitter, size_t from, size_t *len);
+static struct Regex *call_regex(struct VM *vm, struct Value *pattern);
+static size_t *find_matches(struct VM *vm, struct Regex *regex, struct String subject, size_t start, size_t limit, size_t *count);
+static struct Value captured(struct VM *vm, struct String subject, size_t span[2]);
+static size_t expand_replacement(struct String replacement, struct String subject, size_t captures[], size_t groups, char *result);
+
+const struct Builtin *builtin_find(char *name) {
+	if (!built) build_table();
+	uint32_t seed = seeds[name_hash(name, 0) % BUILTIN_BUCKETS];
+	uint16_t slot = slots[name_hash(name, seed) % BUILTIN_SLOTS];
+	if (!slot || strcasecmp(builtins[slot - 1].name, name) != 0) return NULL;
+	return &builtins[slot - 1];
+}
+
+/*
+ * Hash and displace (CHD): the names are split into small buckets by one hash, then each bucket
+ * gets the first seed of a second hash which puts all of its names into free slots. The fullest
+ * buckets are placed first while most slots are free, so each search only takes a few tries even
+ * for hundreds of names, unlike a single seed for all of them.
+ */
+static void build_table(void) {
+	// Group the functions by bucket
+	size_t starts[BUILTIN_BUCKETS + 1] = {0};
+	uint16_t members[BUILTIN_COUNT];
+	size_t buckets[BUILTIN_COUNT];
+	for (size_t i = 0; i < BUILTIN_COUNT; ++i) {
+		buckets[i] = name_hash(builtins[i].name, 0) % BUILTIN_BUCKETS;
+		++starts[buckets[i] + 1];
+	}
+	for (size_t b = 0; b < BUILTIN_BUCKETS; ++b) starts[b + 1] += starts[b];
+	size_t filled[BUILTIN_BUCKETS];
+	memcpy(filled, starts, sizeof filled);
+	for (size_t i = 0; i < BUILTIN_COUNT; ++i) members[filled[buckets[i]]++] = i;
+	
+	// Order the buckets from the fullest
+	size_t order[BUILTIN_BUCKETS];
+	for (size_t b = 0; b < BUILTIN_BUCKETS; ++b) {
+		size_t j = b;
+		for (; j > 0 && starts[order[j - 1] + 1] - starts[order[j - 1]] < starts[b + 1] - starts[b]; --j) order[j] = order[j - 1];
+		order[j] = b;
+	}
+	
+	size_t picked[BUILTIN_BUCKET_MAX];
+	for (size_t o = 0; o < BUILTIN_BUCKETS; ++o) {
+		size_t b = order[o], size = starts[b + 1] - starts[b];
+		if (!size) break;
+		if (size > BUILTIN_BUCKET_MAX) die("Too many built-in functions in one bucket of the hash table");
+		for (seeds[b] = 1; seeds[b] < BUILTIN_SEED_MAX; ++seeds[b]) {
+			// The names of the bucket have to land in free slots which are different from each other
+			size_t count = 0;
+			for (; count < size; ++count) {
+				size_t slot = name_hash(builtins[members[starts[b] + count]].name, seeds[b]) % BUILTIN_SLOTS;
+				bool taken = slots[slot];
+				for (size_t k = 0; k < count && !taken; ++k) taken = picked[k] == slot;
+				if (taken) break;
+				picked[count] = slot;
+			}
+			if (count == size) break;
+		}
+		if (seeds[b] == BUILTIN_SEED_MAX) die("No perfect hash for the names of built-in functions");
+		for (size_t k = 0; k < size; ++k) slots[picked[k]] = members[starts[b] + k] + 1;
+	}
+	built = true;
+}
+
+static uint32_t name_hash(char *name, uint32_t hash_seed) {
+	// FNV-1a of the case-folded name, the seed changes the offset basis
+	uint32_t hash = 2166136261u ^ hash_seed;
+	for (; *name; ++name) {
+		hash ^= (unsigned char) tolower((unsigned char) *name);
+		hash *= 16777619u;
+	}
+	return hash ^ hash >> 16;
+}
+
+static struct Value new_string(struct VM *vm, char *chars, size_t len) {
+	char *result = heap_string(len);
+	if (!result) cease_mem(vm->point, "creating a string");
+	memcpy(result, chars, len);
+	return (struct Value){.type = VAL_STRING, .counted = true, .string = result};
+}
+
+/* Counts of characters below one (and NaN) are zero */
+static size_t clamp_count(struct Value *value, size_t max) {
+	double count = value_to_number(value);
+	if (!(count >= 1)) return 0;
+	return count < max ? (size_t) count : max;
+}
+
+static struct Value integer_or_number(double number) {
+	if (number == trunc(number) && number >= -0x1p63 && number < 0x1p63) return value_from_integer((int64_t) number, false);
+	return NUMBER(number);
+}
+
+/* Index of the next delimiter from the index onwards and its length, STRING_NOT_FOUND after the last piece */
+static size_t next_delimiter(struct Splitter *splitter, size_t from, size_t *len) {
+	struct String string = splitter->string;
+	if (splitter->delimiters.len == 0) {
+		*len = 0;
+		return from + 1 < string.len ? from + 1 : STRING_NOT_FOUND;
+	}
+	
+	*len = splitter->entire ? splitter->delimiters.len : 1;
+	if (splitter->entire || splitter->delimiters.len == 1) return string_find(string, splitter->delimiters, from, true);
+	for (size_t i = from; i < string.len; ++i) {
+		if (splitter->is_delimiter[(unsigned char) string.chars[i]]) return i;
+	}
+	return STRING_NOT_FOUND;
+}
+
+/* The pattern of the running call, compiled along with it if it is a literal and taken from the cache otherwise */
+static struct Regex *call_regex(struct VM *vm, struct Value *pattern) {
+	if (vm->site->regex) return vm->site->regex;
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct RegexError error;
+	struct Regex *regex = regex_cached(string_of(pattern, buffer), &error);
+	if (!regex) {
+		if (!error.msg) cease_mem(vm->point, "compiling a regular expression");
+		cease_fmt(vm->point, "Invalid regular expression", "Invalid regular expression: %s at offset %zu of the pattern", error.msg, error.offset);
+	}
+	return regex;
+}
+
+/*
+ * Captures of the matches from the start onwards, at most the limit of them unless it is zero. An
+ * empty match moves the next search one character ahead. The caller frees the captures.
+ */
+static size_t *find_matches(struct VM *vm, struct Regex *regex, struct String subject, size_t start, size_t limit, size_t *count) {
+	size_t stride = 2 * (regex_groups(regex) + 1);
+	size_t *matches = NULL, cap = 0;
+	*count = 0;
+	for (size_t at = start; at <= subject.len && (limit == 0 || *count < limit); ++*count) {
+		size_t *grown = grow_array(matches, &cap, *count, stride * sizeof *matches);
+		if (!grown) {
+			free(matches);
+			cease_mem(vm->point, "matching a regular expression");
+		}
+		matches = grown;
+		size_t *captures = &matches[*count * stride];
+		if (!regex_match(regex, subject, at, captures)) break;
+		at = captures[1] > captures[0] ? captures[1] : captures[1] + 1;
+	}
+	return matches;
+}
+
+/* Groups which didn't take part in the match are empty */
+static struct Value captured(struct VM *vm, struct String subject, size_t span[2]) {
+	if (span[0] == REGEX_UNSET) return new_string(vm, "", 0);
+	return new_string(vm, subject.chars + span[0], span[1] - span[0]);
+}
+
+/*
+ * Length of the replacement of a match, which is written to the result unless it is NULL. Groups
+ * are put in with \0 to \9, $0 to $9 or ${0} to ${99}, and a backslash escapes a backslash or a
+ * dollar sign. The groups which the pattern doesn't have are empty.
+ */
+static size_t expand_replacement(struct String replacement, struct String subject, size_t captures[], size_t groups, char *result) {
+	size_t len = 0;
+	for (size_t i = 0; i < replacement.len; ++i) {
+		char chr = replacement.chars[i];
+		size_t rest = replacement.len - i - 1;
+		size_t group = SIZE_MAX, skipped = 0;
+		if ((chr == '\\' || chr == '$') && rest >= 1 && isdigit((unsigned char) replacement.chars[i + 1])) {
+			group = replacement.chars[i + 1] - '0';
+			skipped = 1;
+		} else if (chr == '$' && rest >= 3 && replacement.chars[i + 1] == '{' && isdigit((unsigned char) replacement.chars[i + 2])) {
+			size_t end = i + 3;
+			group = replacement.chars[i + 2] - '0';
+			if (isdigit((unsigned char) replacement.chars[end])) group = 10 * group + (replacement.chars[end++] - '0');
+			if (end < replacement.len && replacement.chars[end] == '}') {
+				skipped = end - i;
+			} else {
+				group = SIZE_MAX;
+			}
+		} else if (chr == '\\' && rest >= 1 && (replacement.chars[i + 1] == '\\' || replacement.chars[i + 1] == '$')) {
+			chr = replacement.chars[++i];
+		}
+		
+		if (group == SIZE_MAX) {
+			if (result) result[len] = chr;
+			++len;
+			continue;
+		}
+		i += skipped;
+		if (group > groups || captures[2 * group] == REGEX_UNSET) continue;
+		size_t piece = captures[2 * group + 1] - captures[2 * group];
+		if (result) memcpy(result + len, subject.chars + captures[2 * group], piece);
+		len += piece;
+	}
+	return len;
+}
+
+static struct Value builtin_abs(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	if (VALUE_IS_INTEGER(&args[0]) && args[0].integer != INT64_MIN) {
+		return value_from_integer(args[0].integer < 0 ? -args[0].integer : args[0].integer, args[0].type == VAL_INT64);
+	}
+	return NUMBER(fabs(value_to_number(&args[0])));
+}
+
+static struct Value builtin_console_write(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct String data = string_of(&args[0], buffer);
+	fwrite(data.chars, 1, data.len, stdout);
+	return value_from_integer(data.len, false);
+}
+
+static struct Value builtin_console_write_error(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct String data = string_of(&args[0], buffer);
+	fwrite(data.chars, 1, data.len, stderr);
+	return value_from_integer(data.len, false);
+}
+
+static struct Value builtin_int(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	if (VALUE_IS_INTEGER(&args[0])) return args[0];
+	return integer_or_number(trunc(value_to_number(&args[0])));
+}
+
+static struct Value builtin_is_bool(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	return BOOLEAN(args[0].type == VAL_BOOLEAN);
+}
+
+static struct Value builtin_is_number(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	return BOOLEAN(args[0].type == VAL_NUMBER || VALUE_IS_INTEGER(&args[0]));
+}
+
+static struct Value builtin_is_string(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	return BOOLEAN(args[0].type == VAL_STRING);
+}
+
+static struct Value builtin_mod(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	if (VALUE_IS_INTEGER(&args[0]) && VALUE_IS_INTEGER(&args[1]) && args[1].integer != 0) {
+		// The remainder of INT64_MIN by -1 overflows, it is zero for any dividend anyway
+		int64_t remainder = args[1].integer == -1 ? 0 : args[0].integer % args[1].integer;
+		return value_from_integer(remainder, args[0].type == VAL_INT64 || args[1].type == VAL_INT64);
+	}
+	return NUMBER(fmod(value_to_number(&args[0]), value_to_number(&args[1])));
+}
+
+static struct Value builtin_number(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	if (args[0].type == VAL_NUMBER || VALUE_IS_INTEGER(&args[0])) return args[0];
+	return integer_or_number(value_to_number(&args[0]));
+}
+
+static struct Value builtin_sqrt(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	return NUMBER(sqrt(value_to_number(&args[0])));
+}
+
+static struct Value builtin_string(struct VM *vm, struct Value args[], size_t count) {
+	(void) count;
+	if (args[0].type == VAL_STRING) return args[0];
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct String string = string_of(&args[0], buffer);
+	return new_string(vm, string.chars, string.len);
+}
+
+/* The substring is found case-insensitively unless the case sense is 1, a negative occurrence counts from the end */
+static struct Value builtin_string_in_str(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm;
+	char buffers[2][VALUE_STRING_BUFFER_SIZE];
+	struct String string = string_of(&args[0], buffers[0]);
+	struct String substring = string_of(&args[1], buffers[1]);
+	bool case_sensitive = count > 2 && value_to_number(&args[2]) == 1;
+	double occurrence = count > 3 ? value_to_number(&args[3]) : 1;
+	if (substring.len == 0 || !(fabs(occurrence) >= 1 && fabs(occurrence) <= string.len)) return value_from_integer(0, false);
+	
+	size_t wanted = fabs(occurrence);
+	if (occurrence < 0) {
+		size_t total = 0;
+		for (size_t at = string_find(string, substring, 0, case_sensitive); at != STRING_NOT_FOUND; at = string_find(string, substring, at + 1, case_sensitive)) ++total;
+		if (wanted > total) return value_from_integer(0, false);
+		wanted = total - wanted + 1;
+	}
+	
+	size_t at = string_find(string, substring, 0, case_sensitive);
+	while (at != STRING_NOT_FOUND && --wanted) at = string_find(string, substring, at + 1, case_sensitive);
+	return value_from_integer(at == STRING_NOT_FOUND ? 0 : (int64_t) at + 1, false);
+}
+
+static struct Value builtin_string_left(struct VM *vm, struct Value args[], size_t count) {
+	(void) count;
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct String string = string_of(&args[0], buffer);
+	return new_string(vm, string.chars, clamp_count(&args[1], string.len));
+}
+
+static struct Value builtin_string_len(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm; (void) count;
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	return value_from_integer(string_of(&args[0], buffer).len, false);
+}
+
+static struct Value builtin_string_lower(struct VM *vm, struct Value args[], size_t count) {
+	(void) count;
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct String string = string_of(&args[0], buffer);
+	char *result = heap_string(string.len);
+	if (!result) cease_mem(vm->point, "creating a string");
+	string_lower(result, string.chars, string.len);
+	return (struct Value){.type = VAL_STRING, .counted = true, .string = result};
+}
+
+/* The start is one-based, the count is optional and a negative one takes the rest of the string */
+static struct Value builtin_string_mid(struct VM *vm, struct Value args[], size_t count) {
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct String string = string_of(&args[0], buffer);
+	size_t start = clamp_count(&args[1], string.len + 1);
+	if (start == 0 || start > string.len) return new_string(vm, "", 0);
+	
+	size_t rest = string.len - (start - 1);
+	size_t taken = count < 3 || value_to_number(&args[2]) < 0 ? rest : clamp_count(&args[2], rest);
+	return new_string(vm, string.chars + start - 1, taken);
+}
+
+/*
+ * The flag picks the result: 0 tells whether the pattern matches, 1 gives the groups of the first
+ * match, 2 the match and its groups, 3 the groups of every match and 4 an array of the match and
+ * its groups for every match. A pattern without groups gives the match instead. The offset is
+ * where the search starts, from one. Zero if nothing matches.
+ */
+static struct Value builtin_string_reg_exp(struct VM *vm, struct Value args[], size_t count) {
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct String subject = string_of(&args[0], buffer);
+	struct Regex *regex = call_regex(vm, &args[1]);
+	int flag = count > 2 ? (int) value_to_number(&args[2]) : 0;
+	size_t start = count > 3 ? clamp_count(&args[3], subject.len + 1) : 1;
+	start = start ? start - 1 : 0;
+	if (flag < 1 || flag > 4) return value_from_integer(regex_match(regex, subject, start, NULL), false);
+	
+	size_t matches;
+	size_t *captures = find_matches(vm, regex, subject, start, flag < 3, &matches);
+	if (matches == 0) {
+		free(captures);
+		return value_from_integer(0, false);
+	}
+	
+	size_t groups = regex_groups(regex);
+	size_t first = flag == 2 || flag == 4 || groups == 0 ? 0 : 1;
+	size_t taken = groups + 1 - first;
+	size_t bounds[] = {flag == 4 ? matches : flag == 3 ? matches * taken : taken};
+	struct Array *array = heap_array(bounds, 1);
+	if (!array) {
+		free(captures);
+		cease_mem(vm->point, "matching a regular expression");
+	}
+	
+	for (size_t match = 0; match < matches; ++match) {
+		size_t *spans = &captures[2 * (groups + 1) * match];
+		struct Array *target = array;
+		size_t index = match * taken;
+		if (flag == 4) {
+			size_t inner_bounds[] = {taken};
+			if (!(target = heap_array(inner_bounds, 1))) {
+				free(captures);
+				cease_mem(vm->point, "matching a regular expression");
+			}
+			heap_assign(&array->elements[match], (struct Value){.type = VAL_ARRAY, .counted = true, .array = target});
+			index = 0;
+		}
+		for (size_t group = first; group <= groups; ++group) {
+			heap_assign(&target->elements[index++], captured(vm, subject, &spans[2 * group]));
+		}
+	}
+	free(captures);
+	return (struct Value){.type = VAL_ARRAY, .counted = true, .array = array};
+}
+
+/* Replaces every match unless the count says how many, see expand_replacement for the groups in the replacement */
+static struct Value builtin_string_reg_exp_replace(struct VM *vm, struct Value args[], size_t count) {
+	char buffers[2][VALUE_STRING_BUFFER_SIZE];
+	struct String subject = string_of(&args[0], buffers[0]);
+	struct Regex *regex = call_regex(vm, &args[1]);
+	struct String replacement = string_of(&args[2], buffers[1]);
+	size_t limit = count > 3 ? clamp_count(&args[3], SIZE_MAX) : 0;
+	
+	size_t matches;
+	size_t *captures = find_matches(vm, regex, subject, 0, limit, &matches);
+	size_t groups = regex_groups(regex), stride = 2 * (groups + 1);
+	size_t len = subject.len;
+	for (size_t match = 0; match < matches; ++match) {
+		size_t *spans = &captures[stride * match];
+		len -= spans[1] - spans[0];
+		if (__builtin_add_overflow(len, expand_replacement(replacement, subject, spans, groups, NULL), &len)) {
+			free(captures);
+			cease_mem(vm->point, "replacing in a string");
+		}
+	}
+	char *result = heap_string(len);
+	if (!result) {
+		free(captures);
+		cease_mem(vm->point, "replacing in a string");
+	}
+	
+	size_t from = 0, written = 0;
+	for (size_t match = 0; match < matches; ++match) {
+		size_t *spans = &captures[stride * match];
+		memcpy(result + written, subject.chars + from, spans[0] - from);
+		written += spans[0] - from;
+		written += expand_replacement(replacement, subject, spans, groups, result + written);
+		from = spans[1];
+	}
+	memcpy(result + written, subject.chars + from, subject.len - from);
+	free(captures);
+	return (struct Value){.type = VAL_STRING, .counted = true, .string = result};
+}
+
+/*
+ * Replaces every occurrence unless the occurrence says how many, a negative one counts from the end.
+ * The search is case-insensitive unless the case sense is 1. The occurrences don't overlap.
+ */
+static struct Value builtin_string_replace(struct VM *vm, struct Value args[], size_t count) {
+	char buffers[3][VALUE_STRING_BUFFER_SIZE];
+	struct String string = string_of(&args[0], buffers[0]);
+	struct String search = string_of(&args[1], buffers[1]);
+	struct String replacement = string_of(&args[2], buffers[2]);
+	double occurrence = count > 3 ? value_to_number(&args[3]) : 0;
+	bool case_sensitive = count > 4 && value_to_number(&args[4]) == 1;
+	if (search.len == 0) return new_string(vm, string.chars, string.len);
+	
+	// The occurrences are counted first, for the ones which are replaced and the length of the result
+	size_t total = 0;
+	for (size_t at = string_find(string, search, 0, case_sensitive); at != STRING_NOT_FOUND; at = string_find(string, search, at + search.len, case_sensitive)) ++total;
+	size_t first = 0, replaced = total;
+	if (occurrence >= 1 && occurrence < total) {
+		replaced = occurrence;
+	} else if (occurrence <= -1 && -occurrence < total) {
+		replaced = -occurrence;
+		first = total - replaced;
+	}
+	
+	size_t len;
+	if (__builtin_mul_overflow(replaced, replacement.len, &len) || __builtin_add_overflow(len, string.len - replaced * search.len, &len)) {
+		cease_mem(vm->point, "replacing in a string");
+	}
+	char *result = heap_string(len);
+	if (!result) cease_mem(vm->point, "replacing in a string");
+	
+	size_t from = 0, written = 0, index = 0;
+	for (size_t at = string_find(string, search, 0, case_sensitive); at != STRING_NOT_FOUND && index < first + replaced; at = string_find(string, search, at + search.len, case_sensitive), ++index) {
+		if (index < first) continue;
+		memcpy(result + written, string.chars + from, at - from);
+		written += at - from;
+		memcpy(result + written, replacement.chars, replacement.len);
+		written += replacement.len;
+		from = at + search.len;
+	}
+	memcpy(result + written, string.chars + from, string.len - from);
+	return (struct Value){.type = VAL_STRING, .counted = true, .string = result};
+}
+
+static struct Value builtin_string_right(struct VM *vm, struct Value args[], size_t count) {
+	(void) count;
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct String string = string_of(&args[0], buffer);
+	size_t taken = clamp_count(&args[1], string.len);
+	return new_string(vm, string.chars + string.len - taken, taken);
+}
+
+/*
+ * Each character of the delimiters splits the string, or the whole of them with the flag 1. Without
+ * delimiters every character is a piece. The count of the pieces comes first unless the flag has 2.
+ */
+static struct Value builtin_string_split(struct VM *vm, struct Value args[], size_t count) {
+	char buffers[2][VALUE_STRING_BUFFER_SIZE];
+	struct String string = string_of(&args[0], buffers[0]);
+	struct String delimiters = string_of(&args[1], buffers[1]);
+	int flag = count > 2 ? (int) value_to_number(&args[2]) : 0;
+	struct Splitter splitter = {.string = string, .delimiters = delimiters, .entire = flag & 1};
+	for (size_t i = 0; i < delimiters.len; ++i) splitter.is_delimiter[(unsigned char) delimiters.chars[i]] = true;
+	
+	size_t pieces = 1, len;
+	for (size_t at = next_delimiter(&splitter, 0, &len); at != STRING_NOT_FOUND; at = next_delimiter(&splitter, at + len, &len)) ++pieces;
+	
+	bool has_count = !(flag & 2);
+	size_t bounds[] = {pieces + has_count};
+	struct Array *array = heap_array(bounds, 1);
+	if (!array) cease_mem(vm->point, "splitting a string");
+	if (has_count) array->elements[0] = value_from_integer(pieces, false);
+	
+	size_t from = 0;
+	for (size_t i = has_count; i < bounds[0]; ++i) {
+		size_t at = next_delimiter(&splitter, from, &len);
+		if (at == STRING_NOT_FOUND) at = string.len;
+		heap_assign(&array->elements[i], new_string(vm, string.chars + from, at - from));
+		from = at + len;
+	}
+	return (struct Value){.type = VAL_ARRAY, .counted = true, .array = array};
+}
+
+static struct Value builtin_string_upper(struct VM *vm, struct Value args[], size_t count) {
+	(void) count;
+	char buffer[VALUE_STRING_BUFFER_SIZE];
+	struct String string = string_of(&args[0], buffer);
+	char *result = heap_string(string.len);
+	if (!result) cease_mem(vm->point, "creating a string");
+	string_upper(result, string.chars, string.len);
+	return (struct Value){.type = VAL_STRING, .counted = true, .string = result};
+}
+
+static struct Value builtin_u_bound(struct VM *vm, struct Value args[], size_t count) {
+	(void) vm;
+	// Dimension 0 is the number of dimensions, anything which isn't a dimension of an array is 0
+	if (args[0].type != VAL_ARRAY) return value_from_integer(0, false);
+	double dimension = count > 1 ? value_to_number(&args[1]) : 1;
+	if (!(dimension >= 0 && dimension <= args[0].array->dimensions)) return value_from_integer(0, false);
+	unsigned char index = dimension; // Fractions are truncated like subscripts
+	if (!index) return value_from_integer(args[0].array->dimensions, false);
+	size_t bound = array_bound(args[0].array, index - 1);
+	return value_from_integer(bound, bound > INT32_MAX);
+}
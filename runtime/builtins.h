@@ -0,0 +1,46 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_BUILTINS_H
+#define RUNTIME_BUILTINS_H
+
+#include <stdint.h>
+#include "runtime/bytecode.h"
+
+#ifndef BUILTIN_BUCKET_SIZE
+#define BUILTIN_BUCKET_SIZE 4 // Average number of names in a bucket of the perfect hash table
+#endif
+
+struct Builtin {
+	char *name;
+	NativeFunction *function;
+	uint32_t min_args;
+	uint32_t max_args;
+	uint32_t pattern; // Position of the argument which is a regular expression, from one, zero if there is none
+};
+
+/*
+ * Finds a built-in function by its name, which is case-insensitive. The names are looked up in
+ * a perfect hash table built on first use, so the compiler binds the call sites to the functions
+ * and the interpreter never has to look up a name. A regular expression which is a literal is
+ * compiled along with the call too. NULL if there is no such built-in function.
+ */
+const struct Builtin *builtin_find(char *name);
+
+#endif
@@ -0,0 +1,119 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "runtime/bytecode.h"
+#include "runtime/jit.h"
+#include "runtime/regex.h"
+#include "runtime/value.h"
+#include "utils.h"
+
+struct Chunk chunk_init(void) {
+	return (struct Chunk){
+		.code = NULL,
+		.constants = NULL,
+		.caches = NULL,
+		.calls = NULL,
+		.jit = NULL,
+	};
+}
+
+size_t chunk_emit(struct Chunk *chunk, enum Opcode op, uint32_t arg) {
+	struct Instruction *code = grow_array(chunk->code, &chunk->code_cap, chunk->code_len, sizeof *code);
+	if (!code) return CHUNK_ERROR;
+	chunk->code = code;
+	chunk->code[chunk->code_len] = (struct Instruction){.op = op, .arg = arg};
+	return chunk->code_len++;
+}
+
+size_t chunk_add_constant(struct Chunk *chunk, struct Value value) {
+	struct Value *constants = grow_array(chunk->constants, &chunk->constant_cap, chunk->constant_count, sizeof *constants);
+	if (!constants) return CHUNK_ERROR;
+	chunk->constants = constants;
+	chunk->constants[chunk->constant_count] = value;
+	return chunk->constant_count++;
+}
+
+size_t chunk_add_cache(struct Chunk *chunk, char *key) {
+	struct AccessCache *caches = grow_array(chunk->caches, &chunk->cache_cap, chunk->cache_count, sizeof *caches);
+	if (!caches) return CHUNK_ERROR;
+	chunk->caches = caches;
+	chunk->caches[chunk->cache_count] = (struct AccessCache){.key = key};
+	return chunk->cache_count++;
+}
+
+size_t chunk_add_call(struct Chunk *chunk, char *name, uint32_t argc, NativeFunction *function, struct Regex *regex) {
+	struct CallSite *calls = grow_array(chunk->calls, &chunk->call_cap, chunk->call_count, sizeof *calls);
+	if (!calls) return CHUNK_ERROR;
+	chunk->calls = calls;
+	chunk->calls[chunk->call_count] = (struct CallSite){.name = name, .argc = argc, .function = function, .regex = regex};
+	return chunk->call_count++;
+}
+
+/* Splits a superinstruction back into the pair it replaces, false for other instructions */
+bool chunk_unfuse(struct Instruction instruction, struct Instruction parts[2]) {
+	switch (instruction.op) {
+		case INS_LOAD_LOCAL_PAIR:
+		case INS_LOAD_GLOBAL_PAIR:;
+			enum Opcode load = instruction.op == INS_LOAD_LOCAL_PAIR ? INS_LOAD_LOCAL : INS_LOAD_GLOBAL;
+			parts[0] = (struct Instruction){.op = load, .arg = instruction.arg & UINT16_MAX};
+			parts[1] = (struct Instruction){.op = load, .arg = instruction.arg >> 16};
+			return true;
+		case INS_LOAD_LOCAL_INDEX:
+		case INS_LOAD_GLOBAL_INDEX:
+			load = instruction.op == INS_LOAD_LOCAL_INDEX ? INS_LOAD_LOCAL : INS_LOAD_GLOBAL;
+			parts[0] = (struct Instruction){.op = load, .arg = instruction.arg & ((UINT32_C(1) << INDEX_SLOT_BITS) - 1)};
+			parts[1] = (struct Instruction){.op = INS_INDEX, .arg = instruction.arg >> INDEX_SLOT_BITS};
+			return true;
+		case INS_STORE_LOCAL_POP:
+		case INS_STORE_GLOBAL_POP:
+			parts[0] = (struct Instruction){.op = instruction.op == INS_STORE_LOCAL_POP ? INS_STORE_LOCAL : INS_STORE_GLOBAL, .arg = instruction.arg};
+			parts[1] = (struct Instruction){.op = INS_POP, .arg = 0};
+			return true;
+		case INS_ADD_CONST:
+		case INS_SUB_CONST:
+			parts[0] = (struct Instruction){.op = INS_CONST, .arg = instruction.arg};
+			parts[1] = (struct Instruction){.op = instruction.op == INS_ADD_CONST ? INS_ADD : INS_SUB, .arg = 0};
+			return true;
+		default:
+			return false;
+	}
+}
+
+void chunk_cache_stats(struct Chunk *chunk, size_t *hits, size_t *misses) {
+	*hits = *misses = 0;
+	for (size_t i = 0; i < chunk->cache_count; ++i) {
+		*hits += chunk->caches[i].hits;
+		*misses += chunk->caches[i].misses;
+	}
+}
+
+void chunk_free(struct Chunk *chunk) {
+	free(chunk->code);
+	free(chunk->constants);
+	free(chunk->caches);
+	for (size_t i = 0; i < chunk->call_count; ++i) regex_free(chunk->calls[i].regex);
+	free(chunk->calls);
+	jit_free(chunk->jit);
+	*chunk = chunk_init();
+}
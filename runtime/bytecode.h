@@ -0,0 +1,143 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_BYTECODE_H
+#define RUNTIME_BYTECODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "runtime/value.h"
+
+#define ACCESS_CACHE_ENTRIES 4
+#define CHUNK_ERROR SIZE_MAX
+#define INDEX_SLOT_BITS 24 // The loads fused with an index keep the count of subscripts above the slot
+
+enum Opcode {
+	INS_NOP,
+	
+	/* Stack */
+	INS_CONST, INS_POP,
+	
+	/* Variables */
+	INS_LOAD_LOCAL, INS_LOAD_GLOBAL, INS_STORE_LOCAL, INS_STORE_GLOBAL,
+	
+	/* Arithmetic, Concatenation */
+	INS_INV, INS_ADD, INS_SUB, INS_MUL, INS_DIV, INS_EXP, INS_CAT,
+	
+	/* Logical, Comparison */
+	INS_NOT, INS_TRUTH,
+	INS_EQU, INS_SEQU, INS_NEQ, INS_LT, INS_LTE, INS_GT, INS_GTE,
+	
+	/* Control flow */
+	INS_JUMP, INS_JUMP_FALSE, INS_JUMP_FALSE_KEEP, INS_JUMP_TRUE_KEEP,
+	
+	/*
+	 * Counted loops (For...To...Step), the start, stop and step on the stack are the state
+	 * of the loop. Both are followed by the INS_STORE_LOCAL or INS_STORE_GLOBAL of the loop
+	 * variable, which they do themselves, so it is skipped. INS_FOR_PREP jumps to its arg
+	 * when the loop doesn't run at all, INS_FOR_NEXT to its arg when it runs again.
+	 */
+	INS_FOR_PREP, INS_FOR_NEXT,
+	
+	/*
+	 * Superinstructions, each does the work of the pair of instructions it replaces (see
+	 * compiler/peephole.c). The pairs of loads have the two slots in the low and high 16 bits
+	 * of the arg, the operations with a constant take the index of it. The loads of the last
+	 * subscript of an index have the slot in the low INDEX_SLOT_BITS and the count above it.
+	 */
+	INS_LOAD_LOCAL_PAIR, INS_LOAD_GLOBAL_PAIR,
+	INS_LOAD_LOCAL_INDEX, INS_LOAD_GLOBAL_INDEX,
+	INS_STORE_LOCAL_POP, INS_STORE_GLOBAL_POP,
+	INS_ADD_CONST, INS_SUB_CONST,
+	
+	/*
+	 * Access, the arg of the index instructions is the number of subscripts, which follow the
+	 * array on the stack. INS_MAP pushes a new empty map, INS_ARRAY pops the bounds and pushes
+	 * a new array, INS_REDIM pops an array and its new bounds.
+	 */
+	INS_INDEX, INS_SET_INDEX, INS_MEMBER, INS_SET_MEMBER, INS_MAP, INS_ARRAY, INS_REDIM,
+	
+	/* Call, Return */
+	INS_CALL, INS_RETURN,
+};
+
+struct Instruction {
+	uint8_t op;
+	uint32_t arg;
+};
+
+/* 
+ * Inline cache for member access at one site in the code,
+ * remembers the slot of the key for the last few shapes seen at that site.
+ */
+struct AccessCache {
+	char *key;
+	unsigned char count;
+	bool megamorphic;
+	struct {
+		uint32_t shape;
+		uint32_t slot;
+	} entries[ACCESS_CACHE_ENTRIES];
+	size_t hits;
+	size_t misses;
+};
+
+struct VM;
+struct JitCode;
+struct Regex;
+
+typedef struct Value NativeFunction(struct VM *vm, struct Value args[], size_t count);
+
+/* Bound when the call is compiled, see runtime/builtins.h */
+struct CallSite {
+	char *name;
+	uint32_t argc;
+	NativeFunction *function;
+	struct Regex *regex; // Compiled with the call when the pattern is a literal, see runtime/regex.h
+};
+
+struct Chunk {
+	struct Instruction *code;
+	size_t code_len;
+	size_t code_cap;
+	struct Value *constants;
+	size_t constant_count;
+	size_t constant_cap;
+	struct AccessCache *caches;
+	size_t cache_count;
+	size_t cache_cap;
+	struct CallSite *calls;
+	size_t call_count;
+	size_t call_cap;
+	size_t max_stack;
+	size_t heat; // Runs and backward jumps, see runtime/jit.h
+	struct JitCode *jit;
+};
+
+struct Chunk chunk_init(void);
+size_t chunk_emit(struct Chunk *chunk, enum Opcode op, uint32_t arg);
+size_t chunk_add_constant(struct Chunk *chunk, struct Value value);
+size_t chunk_add_cache(struct Chunk *chunk, char *key);
+size_t chunk_add_call(struct Chunk *chunk, char *name, uint32_t argc, NativeFunction *function, struct Regex *regex);
+bool chunk_unfuse(struct Instruction instruction, struct Instruction parts[2]);
+void chunk_cache_stats(struct Chunk *chunk, size_t *hits, size_t *misses);
+void chunk_free(struct Chunk *chunk);
+
+#endif
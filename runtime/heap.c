@@ -0,0 +1,410 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runtime/array.h"
+#include "runtime/heap.h"
+#include "runtime/map.h"
+#include "runtime/value.h"
+#include "utils.h"
+
+// Colors for the cycle collector
+enum HeapColor {
+	HEAP_BLACK, // In use
+	HEAP_GRAY, // Possibly garbage, the references from other gray objects are being subtracted
+	HEAP_WHITE, // Garbage, only referenced by other white objects
+};
+
+enum HeapFlag {
+	HEAP_PENDING = 1 << 0, // In the zero count table
+	HEAP_CANDIDATE = 1 << 1, // In the list of possible roots of garbage cycles
+	HEAP_ROOTED = 1 << 2, // On the stack during a collection
+	HEAP_DEAD = 1 << 3, // Freed while it was a candidate, only the object itself is left
+	HEAP_GARBAGE = 1 << 4, // Found by the cycle collector, freed at the end
+};
+
+struct HeapString {
+	struct HeapObject object;
+	size_t len;
+	char chars[];
+};
+
+struct ObjectList {
+	struct HeapObject **objects;
+	size_t len, cap;
+};
+
+static struct ObjectList decrements; // Logged by heap_release
+static struct ObjectList zero_counts; // Objects with no counted references, new ones included
+static struct ObjectList candidates;
+static struct ObjectList work, black_work, garbage; // Scratch lists for the cycle collector
+
+static size_t debt; // Work done since the last collection
+static bool out_of_memory;
+static struct HeapStats stats;
+
+static struct HeapObject *value_object(struct Value *value);
+static bool push(struct ObjectList *list, struct HeapObject *object);
+static void add_object(struct HeapObject *object, enum HeapKind kind);
+static void decrement(struct HeapObject *object);
+static void free_zero_counts(void);
+static void destroy(struct HeapObject *object);
+static void collect_cycles(void);
+static void mark_gray(struct HeapObject *object);
+static void scan(struct HeapObject *object);
+static void scan_black(struct HeapObject *object);
+static void collect_white(struct HeapObject *object);
+static size_t child_count(struct HeapObject *object);
+static struct HeapObject *child_at(struct HeapObject *object, size_t index);
+
+char *heap_string(size_t len) {
+	// The caller fills in the characters, the terminator is added here
+	struct HeapString *string = malloc(sizeof *string + len + 1);
+	if (!string) return NULL;
+	string->len = len;
+	string->chars[len] = '\0';
+	add_object(&string->object, HEAP_STRING);
+	return string->chars;
+}
+
+size_t heap_string_len(char *chars) {
+	return ((struct HeapString *) (chars - offsetof(struct HeapString, chars)))->len;
+}
+
+struct Array *heap_array(size_t bounds[], unsigned char dimensions) {
+	struct Array *array = array_new(bounds, dimensions);
+	if (array) add_object(&array->object, HEAP_ARRAY);
+	return array;
+}
+
+struct Map *heap_map(void) {
+	struct Map *map = map_new();
+	if (map) add_object(&map->object, HEAP_MAP);
+	return map;
+}
+
+void heap_retain(struct Value *value) {
+	if (value->counted) ++value_object(value)->refs;
+}
+
+void heap_release(struct Value *value) {
+	if (!value->counted) return;
+	
+	// Only logged, the object can't be freed before the stack has been looked at anyway
+	struct HeapObject *object = value_object(value);
+	++debt;
+	if (!push(&decrements, object)) {
+		// The log couldn't grow, so the count is brought down right away instead
+		out_of_memory = false;
+		decrement(object);
+	}
+}
+
+void heap_assign(struct Value *variable, struct Value value) {
+	// Retained first, the variable might already hold the same object
+	heap_retain(&value);
+	heap_release(variable);
+	*variable = value;
+}
+
+bool heap_collect_due(void) {
+	return debt >= HEAP_COLLECT_THRESHOLD;
+}
+
+bool heap_collect(struct Value *roots, size_t count, bool cycles) {
+	debt = 0;
+	++stats.collections;
+	
+	for (size_t i = 0; i < decrements.len; ++i) decrement(decrements.objects[i]);
+	decrements.len = 0;
+	
+	// Nothing on the stack can be freed, whether it is counted or not
+	for (size_t i = 0; i < count; ++i) if (roots[i].counted) value_object(&roots[i])->flags |= HEAP_ROOTED;
+	
+	free_zero_counts();
+	if (cycles || candidates.len >= HEAP_CYCLE_THRESHOLD) {
+		collect_cycles();
+		free_zero_counts();
+	}
+	
+	for (size_t i = 0; i < count; ++i) if (roots[i].counted) value_object(&roots[i])->flags &= ~HEAP_ROOTED;
+	
+	bool success = !out_of_memory;
+	out_of_memory = false;
+	return success;
+}
+
+struct HeapStats heap_stats(void) {
+	return stats;
+}
+
+static struct HeapObject *value_object(struct Value *value) {
+	switch (value->type) {
+		case VAL_STRING:
+			return (struct HeapObject *) (value->string - offsetof(struct HeapString, chars));
+		case VAL_ARRAY:
+			return &value->array->object;
+		case VAL_MAP:
+			return &value->map->object;
+		default:
+			return NULL;
+	}
+}
+
+static bool push(struct ObjectList *list, struct HeapObject *object) {
+	struct HeapObject **objects = grow_array(list->objects, &list->cap, list->len, sizeof *objects);
+	if (!objects) {
+		out_of_memory = true;
+		return false;
+	}
+	list->objects = objects;
+	list->objects[list->len++] = object;
+	return true;
+}
+
+static void add_object(struct HeapObject *object, enum HeapKind kind) {
+	// New objects aren't referenced by anything yet, so they start in the zero count table
+	*object = (struct HeapObject){.kind = kind, .color = HEAP_BLACK, .flags = HEAP_PENDING};
+	++stats.objects;
+	++debt;
+	if (!push(&zero_counts, object)) object->flags &= ~HEAP_PENDING;
+}
+
+static void decrement(struct HeapObject *object) {
+	if (--object->refs == 0) {
+		if (!(object->flags & HEAP_PENDING) && push(&zero_counts, object)) object->flags |= HEAP_PENDING;
+	} else if (object->kind != HEAP_STRING && !(object->flags & HEAP_CANDIDATE)) {
+		// Still referenced, but maybe only by a cycle
+		if (push(&candidates, object)) object->flags |= HEAP_CANDIDATE;
+	}
+}
+
+static void free_zero_counts(void) {
+	// The table grows while it is walked, freeing an object can bring the counts of its children down to zero
+	size_t kept = 0;
+	for (size_t i = 0; i < zero_counts.len; ++i) {
+		struct HeapObject *object = zero_counts.objects[i];
+		if (object->refs == 0 && !(object->flags & HEAP_ROOTED)) {
+			destroy(object);
+		} else if (object->refs == 0) {
+			// Only referenced from the stack, it is looked at again in the next collection
+			zero_counts.objects[kept++] = object;
+		} else {
+			object->flags &= ~HEAP_PENDING;
+			// The uncounted references from the stack are dropped without a decrement, which could have left a cycle behind
+			if (object->kind != HEAP_STRING && !(object->flags & HEAP_CANDIDATE) && push(&candidates, object)) object->flags |= HEAP_CANDIDATE;
+		}
+	}
+	zero_counts.len = kept;
+}
+
+static void destroy(struct HeapObject *object) {
+	for (size_t i = child_count(object); i-- > 0;) {
+		struct HeapObject *child = child_at(object, i);
+		if (child) decrement(child);
+	}
+	--stats.objects;
+	
+	// A candidate is still in the list of candidates, so only its contents are freed for now
+	bool keep = object->flags & HEAP_CANDIDATE;
+	if (keep) object->flags |= HEAP_DEAD;
+	switch (object->kind) {
+		case HEAP_STRING:
+			free(object);
+			break;
+		case HEAP_ARRAY: {
+			struct Array *array = (struct Array *) object;
+			if (!keep) {
+				array_free(array);
+				break;
+			}
+			free(array->elements);
+			free(array->dim);
+			*array = (struct Array){.object = array->object, .elements = NULL};
+			break;
+		}
+		case HEAP_MAP: {
+			struct Map *map = (struct Map *) object;
+			if (!keep) {
+				map_free(map);
+				break;
+			}
+			free(map->values);
+			*map = (struct Map){.object = map->object, .shape = NULL, .values = NULL};
+			break;
+		}
+	}
+}
+
+static void collect_cycles(void) {
+	size_t kept = 0;
+	for (size_t i = 0; i < candidates.len; ++i) {
+		struct HeapObject *object = candidates.objects[i];
+		if (object->flags & HEAP_DEAD) {
+			free(object);
+			continue;
+		}
+		object->flags &= ~HEAP_CANDIDATE;
+		// An object with no references left is in the zero count table, which takes care of it
+		if (object->refs == 0) continue;
+		candidates.objects[kept++] = object;
+	}
+	candidates.len = kept;
+	
+	// Subtract the references which the candidates and everything reachable from them have to each other
+	for (size_t i = 0; i < candidates.len; ++i) mark_gray(candidates.objects[i]);
+	
+	// Whatever still has references from outside is in use, and so is everything it references
+	for (size_t i = 0; i < candidates.len; ++i) scan(candidates.objects[i]);
+	
+	// The rest is garbage, it is only freed once all of it has been found
+	kept = 0;
+	for (size_t i = 0; i < candidates.len; ++i) {
+		struct HeapObject *object = candidates.objects[i];
+		collect_white(object);
+		// Leaving the stack isn't a decrement, so a candidate on it stays one until the next time
+		if (object->flags & HEAP_ROOTED) {
+			object->flags |= HEAP_CANDIDATE;
+			candidates.objects[kept++] = object;
+		}
+	}
+	candidates.len = kept;
+	for (size_t i = 0; i < garbage.len; ++i) {
+		struct HeapObject *object = garbage.objects[i];
+		// The references to the objects in use were subtracted already, they may have none left now
+		for (size_t j = child_count(object); j-- > 0;) {
+			struct HeapObject *child = child_at(object, j);
+			if (!child || child->flags & HEAP_GARBAGE || child->refs || child->flags & HEAP_PENDING) continue;
+			if (push(&zero_counts, child)) child->flags |= HEAP_PENDING;
+		}
+	}
+	for (size_t i = 0; i < garbage.len; ++i) {
+		struct HeapObject *object = garbage.objects[i];
+		switch (object->kind) {
+			case HEAP_STRING:
+				free(object);
+				break;
+			case HEAP_ARRAY:
+				array_free((struct Array *) object);
+				break;
+			case HEAP_MAP:
+				map_free((struct Map *) object);
+				break;
+		}
+	}
+	stats.objects -= garbage.len;
+	stats.cycles_freed += garbage.len;
+	garbage.len = 0;
+}
+
+static void mark_gray(struct HeapObject *object) {
+	if (object->color == HEAP_GRAY) return;
+	object->color = HEAP_GRAY;
+	work.len = 0;
+	push(&work, object);
+	while (work.len) {
+		object = work.objects[--work.len];
+		for (size_t i = child_count(object); i-- > 0;) {
+			struct HeapObject *child = child_at(object, i);
+			if (!child) continue;
+			--child->refs;
+			if (child->color == HEAP_GRAY) continue;
+			child->color = HEAP_GRAY;
+			push(&work, child);
+		}
+	}
+}
+
+static void scan(struct HeapObject *object) {
+	work.len = 0;
+	push(&work, object);
+	while (work.len) {
+		object = work.objects[--work.len];
+		if (object->color != HEAP_GRAY) continue;
+		if (object->refs || object->flags & HEAP_ROOTED) {
+			scan_black(object);
+			continue;
+		}
+		object->color = HEAP_WHITE;
+		for (size_t i = child_count(object); i-- > 0;) {
+			struct HeapObject *child = child_at(object, i);
+			if (child) push(&work, child);
+		}
+	}
+}
+
+static void scan_black(struct HeapObject *object) {
+	// Put back the references which mark_gray subtracted
+	object->color = HEAP_BLACK;
+	black_work.len = 0;
+	push(&black_work, object);
+	while (black_work.len) {
+		object = black_work.objects[--black_work.len];
+		for (size_t i = child_count(object); i-- > 0;) {
+			struct HeapObject *child = child_at(object, i);
+			if (!child) continue;
+			++child->refs;
+			if (child->color == HEAP_BLACK) continue;
+			child->color = HEAP_BLACK;
+			push(&black_work, child);
+		}
+	}
+}
+
+static void collect_white(struct HeapObject *object) {
+	if (object->color != HEAP_WHITE || object->flags & HEAP_GARBAGE) return;
+	object->flags |= HEAP_GARBAGE;
+	push(&garbage, object);
+	work.len = 0;
+	push(&work, object);
+	while (work.len) {
+		object = work.objects[--work.len];
+		for (size_t i = child_count(object); i-- > 0;) {
+			struct HeapObject *child = child_at(object, i);
+			if (!child || child->color != HEAP_WHITE || child->flags & HEAP_GARBAGE) continue;
+			child->flags |= HEAP_GARBAGE;
+			push(&garbage, child);
+			push(&work, child);
+		}
+	}
+}
+
+static size_t child_count(struct HeapObject *object) {
+	switch (object->kind) {
+		case HEAP_ARRAY:
+			return ((struct Array *) object)->size;
+		case HEAP_MAP: {
+			struct Map *map = (struct Map *) object;
+			return map->shape ? map->shape->count : 0;
+		}
+		default:
+			return 0;
+	}
+}
+
+static struct HeapObject *child_at(struct HeapObject *object, size_t index) {
+	// NULL when the child isn't on the heap
+	struct Value *value = object->kind == HEAP_ARRAY ? &((struct Array *) object)->elements[index] : &((struct Map *) object)->values[index];
+	return value->counted ? value_object(value) : NULL;
+}
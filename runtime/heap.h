@@ -0,0 +1,75 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_HEAP_H
+#define RUNTIME_HEAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "runtime/value.h"
+
+#ifndef HEAP_COLLECT_THRESHOLD
+#define HEAP_COLLECT_THRESHOLD 4096
+#endif
+
+#ifndef HEAP_CYCLE_THRESHOLD
+#define HEAP_CYCLE_THRESHOLD 1024
+#endif
+
+/*
+ * Runtime heap for strings, arrays and maps with deferred reference counting. Only the
+ * references from variables, array elements and map values are counted, the ones on the
+ * VM stack are not, so pushing and popping values costs nothing. Decrements are only
+ * logged when they happen and applied in batches by heap_collect, which is given the
+ * stack as its roots: an object with no counted references is freed unless it is on the
+ * stack. Arrays and maps whose count drops but stays above zero may be a part of a cycle,
+ * they are kept as candidates for a backup cycle collector (synchronous trial deletion).
+ */
+struct HeapObject {
+	uint32_t refs;
+	uint8_t kind;
+	uint8_t color;
+	uint8_t flags;
+};
+
+enum HeapKind {
+	HEAP_STRING,
+	HEAP_ARRAY,
+	HEAP_MAP,
+};
+
+struct HeapStats {
+	size_t objects; // Live objects, including ones waiting to be collected
+	size_t collections;
+	size_t cycles_freed; // Objects freed by the cycle collector
+};
+
+char *heap_string(size_t len);
+size_t heap_string_len(char *chars); // Only for the strings from heap_string
+struct Array *heap_array(size_t bounds[], unsigned char dimensions);
+struct Map *heap_map(void);
+void heap_retain(struct Value *value);
+void heap_release(struct Value *value);
+void heap_assign(struct Value *variable, struct Value value);
+bool heap_collect_due(void);
+bool heap_collect(struct Value *roots, size_t count, bool cycles);
+struct HeapStats heap_stats(void);
+
+#endif
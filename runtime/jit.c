@@ -0,0 +1,633 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runtime/bytecode.h"
+#include "runtime/jit.h"
+#include "runtime/value.h"
+
+#if defined(JIT) && defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+
+#define JIT_BAILOUT 0x80000000u // Set in the index returned by an exit when a guard failed
+#define TEMPLATE_HOLES 5
+#define TEMPLATE_MAX 136 // Bytes in the largest template, with the address of the operand in front
+
+/* The templates rely on this layout of values and the numbers of the types */
+_Static_assert(sizeof(struct Value) == 16 && offsetof(struct Value, counted) == 4 && offsetof(struct Value, integer) == 8, "Layout of values");
+_Static_assert(VAL_NUMBER == 1 && VAL_BOOLEAN == 3 && VAL_INT32 == 6 && VAL_INT64 == 7, "Numbers of value types");
+
+struct JitCode {
+	unsigned char *memory;
+	size_t size;
+	size_t *offsets; // Offset of the machine code for each instruction
+	size_t bailouts;
+};
+
+struct JitExit {
+	uint64_t index;
+	struct Value *sp;
+};
+
+typedef struct JitExit JitEntry(struct Value *sp, struct Value *locals, struct Value *globals, struct Value *constants, void *code);
+
+enum HoleKind {
+	HOLE_NONE,
+	HOLE_SLOT, // disp32, offset of the variable or constant
+	HOLE_INDEX, // imm32, index of the instruction
+	HOLE_TARGET, // rel32, jump to the target of the instruction
+	HOLE_EXIT, // rel32, jump to the exit which bails out of the instruction
+	HOLE_EPILOGUE, // rel32, jump to the epilogue
+	HOLE_NUMBERS, // rel32, call of code_numbers
+};
+
+struct Template {
+	const unsigned char *code;
+	size_t size;
+	struct {
+		unsigned char offset;
+		unsigned char kind;
+	} holes[TEMPLATE_HOLES];
+};
+
+/*
+ * Registers in the machine code: rbx is the stack pointer (next free entry), r12 points to
+ * the locals, r13 to the globals and r14 to the constants. rdx holds the address of the
+ * operand for the templates which need one. Nothing else lives across instructions, so
+ * the code can be entered at, and left from, any instruction.
+ */
+static const unsigned char code_entry[] = {
+	0x53, // push rbx
+	0x41, 0x54, // push r12
+	0x41, 0x55, // push r13
+	0x41, 0x56, // push r14
+	0x48, 0x89, 0xfb, // mov rbx, rdi
+	0x49, 0x89, 0xf4, // mov r12, rsi
+	0x49, 0x89, 0xd5, // mov r13, rdx
+	0x49, 0x89, 0xce, // mov r14, rcx
+	0x41, 0xff, 0xe0, // jmp r8
+};
+
+/* The index is already in eax */
+static const unsigned char code_epilogue[] = {
+	0x48, 0x89, 0xda, // mov rdx, rbx
+	0x41, 0x5e, // pop r14
+	0x41, 0x5d, // pop r13
+	0x41, 0x5c, // pop r12
+	0x5b, // pop rbx
+	0xc3, // ret
+};
+
+static const unsigned char code_exit[] = {
+	0xb8, 0x00, 0x00, 0x00, 0x00, // mov eax, INDEX
+	0xe9, 0x00, 0x00, 0x00, 0x00, // jmp EPILOGUE
+};
+
+/* Exit from the second half of a superinstruction, the first half pushed a value */
+static const unsigned char code_exit_pop[] = {
+	0x48, 0x83, 0xeb, 0x10, // sub rbx, 16
+	0xb8, 0x00, 0x00, 0x00, 0x00, // mov eax, INDEX
+	0xe9, 0x00, 0x00, 0x00, 0x00, // jmp EPILOGUE
+};
+
+static const unsigned char code_local[] = {
+	0x49, 0x8d, 0x94, 0x24, 0x00, 0x00, 0x00, 0x00, // lea rdx, [r12 + SLOT]
+};
+
+static const unsigned char code_global[] = {
+	0x49, 0x8d, 0x95, 0x00, 0x00, 0x00, 0x00, // lea rdx, [r13 + SLOT]
+};
+
+static const unsigned char code_constant[] = {
+	0x49, 0x8d, 0x96, 0x00, 0x00, 0x00, 0x00, // lea rdx, [r14 + SLOT]
+};
+
+static const unsigned char code_nop[] = {
+	0x90, // nop
+};
+
+static const unsigned char code_load[] = {
+	0xf3, 0x0f, 0x6f, 0x02, // movdqu xmm0, [rdx]
+	0xf3, 0x0f, 0x7f, 0x03, // movdqu [rbx], xmm0
+	0x48, 0x83, 0xc3, 0x10, // add rbx, 16
+};
+
+static const unsigned char code_pop[] = {
+	0x48, 0x83, 0xeb, 0x10, // sub rbx, 16
+};
+
+/* Counted values need the heap, the interpreter stores them */
+static const unsigned char code_store[] = {
+	0x80, 0x7a, 0x04, 0x00, // cmp byte [rdx + 4], 0
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+	0x80, 0x7b, 0xf4, 0x00, // cmp byte [rbx - 12], 0
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+	0xf3, 0x0f, 0x6f, 0x43, 0xf0, // movdqu xmm0, [rbx - 16]
+	0xf3, 0x0f, 0x7f, 0x02, // movdqu [rdx], xmm0
+};
+
+/*
+ * Called by the templates which need the operands as Doubles, they are loaded into xmm0 and xmm1.
+ * The types are in eax and ecx, ZF is cleared if an operand isn't a number.
+ */
+static const unsigned char code_numbers[] = {
+	0x83, 0xf8, 0x01, // cmp eax, VAL_NUMBER
+	0x75, 0x07, // jne .integer_a
+	0xf2, 0x0f, 0x10, 0x43, 0xe8, // movsd xmm0, [rbx - 24]
+	0xeb, 0x0e, // jmp .b
+	0x8d, 0x50, 0xfa, // .integer_a: lea edx, [rax - VAL_INT32]
+	0x83, 0xfa, 0x01, // cmp edx, 1
+	0x77, 0x23, // ja .done
+	0xf2, 0x48, 0x0f, 0x2a, 0x43, 0xe8, // cvtsi2sd xmm0, qword [rbx - 24]
+	0x83, 0xf9, 0x01, // .b: cmp ecx, VAL_NUMBER
+	0x75, 0x08, // jne .integer_b
+	0xf2, 0x0f, 0x10, 0x4b, 0xf8, // movsd xmm1, [rbx - 8]
+	0x31, 0xd2, // xor edx, edx
+	0xc3, // ret
+	0x8d, 0x51, 0xfa, // .integer_b: lea edx, [rcx - VAL_INT32]
+	0x83, 0xfa, 0x01, // cmp edx, 1
+	0x77, 0x08, // ja .done
+	0xf2, 0x48, 0x0f, 0x2a, 0x4b, 0xf8, // cvtsi2sd xmm1, qword [rbx - 8]
+	0x31, 0xd2, // xor edx, edx
+	0xc3, // .done: ret
+};
+
+/*
+ * Integers stay integers like in the interpreter: an Int64 operand makes an Int64, an Int32 result
+ * which doesn't fit is widened, and one which overflows an Int64 is left to the interpreter.
+ * Anything else with a Double is a Double.
+ */
+#define CODE_ARITHMETIC(integer_op, double_op) { \
+	0x8b, 0x43, 0xe0, /* mov eax, [rbx - 32] */ \
+	0x8b, 0x4b, 0xf0, /* mov ecx, [rbx - 16] */ \
+	0x8d, 0x50, 0xfa, /* lea edx, [rax - VAL_INT32] */ \
+	0x83, 0xfa, 0x01, /* cmp edx, 1 */ \
+	0x77, 0x33, /* ja .double */ \
+	0x8d, 0x51, 0xfa, /* lea edx, [rcx - VAL_INT32] */ \
+	0x83, 0xfa, 0x01, /* cmp edx, 1 */ \
+	0x77, 0x2b, /* ja .double */ \
+	0x48, 0x8b, 0x73, 0xe8, /* mov rsi, [rbx - 24] */ \
+	0x48, integer_op, 0x73, 0xf8, /* op rsi, [rbx - 8] */ \
+	0x0f, 0x80, 0x00, 0x00, 0x00, 0x00, /* jo EXIT */ \
+	0x09, 0xc8, /* or eax, ecx */ \
+	0x83, 0xf8, 0x07, /* cmp eax, VAL_INT64 */ \
+	0x74, 0x0d, /* je .integer */ \
+	0x48, 0x63, 0xd6, /* movsxd rdx, esi */ \
+	0x48, 0x39, 0xf2, /* cmp rdx, rsi */ \
+	0x74, 0x05, /* je .integer */ \
+	0xb8, 0x07, 0x00, 0x00, 0x00, /* mov eax, VAL_INT64 */ \
+	0x89, 0x43, 0xe0, /* .integer: mov [rbx - 32], eax */ \
+	0x48, 0x89, 0x73, 0xe8, /* mov [rbx - 24], rsi */ \
+	0xeb, 0x1b, /* jmp .done */ \
+	0xe8, 0x00, 0x00, 0x00, 0x00, /* .double: call NUMBERS */ \
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, /* jne EXIT */ \
+	0xf2, 0x0f, double_op, 0xc1, /* opsd xmm0, xmm1 */ \
+	0xf2, 0x0f, 0x11, 0x43, 0xe8, /* movsd [rbx - 24], xmm0 */ \
+	0xc7, 0x43, 0xe0, 0x01, 0x00, 0x00, 0x00, /* mov dword [rbx - 32], VAL_NUMBER */ \
+	0x48, 0x83, 0xeb, 0x10, /* .done: sub rbx, 16 */ \
+}
+
+static const unsigned char code_add[] = CODE_ARITHMETIC(0x03, 0x58);
+static const unsigned char code_sub[] = CODE_ARITHMETIC(0x2b, 0x5c);
+
+/* Same as the others, but imul has a two byte opcode */
+static const unsigned char code_mul[] = {
+	0x8b, 0x43, 0xe0, // mov eax, [rbx - 32]
+	0x8b, 0x4b, 0xf0, // mov ecx, [rbx - 16]
+	0x8d, 0x50, 0xfa, // lea edx, [rax - VAL_INT32]
+	0x83, 0xfa, 0x01, // cmp edx, 1
+	0x77, 0x34, // ja .double
+	0x8d, 0x51, 0xfa, // lea edx, [rcx - VAL_INT32]
+	0x83, 0xfa, 0x01, // cmp edx, 1
+	0x77, 0x2c, // ja .double
+	0x48, 0x8b, 0x73, 0xe8, // mov rsi, [rbx - 24]
+	0x48, 0x0f, 0xaf, 0x73, 0xf8, // imul rsi, [rbx - 8]
+	0x0f, 0x80, 0x00, 0x00, 0x00, 0x00, // jo EXIT
+	0x09, 0xc8, // or eax, ecx
+	0x83, 0xf8, 0x07, // cmp eax, VAL_INT64
+	0x74, 0x0d, // je .integer
+	0x48, 0x63, 0xd6, // movsxd rdx, esi
+	0x48, 0x39, 0xf2, // cmp rdx, rsi
+	0x74, 0x05, // je .integer
+	0xb8, 0x07, 0x00, 0x00, 0x00, // mov eax, VAL_INT64
+	0x89, 0x43, 0xe0, // .integer: mov [rbx - 32], eax
+	0x48, 0x89, 0x73, 0xe8, // mov [rbx - 24], rsi
+	0xeb, 0x1b, // jmp .done
+	0xe8, 0x00, 0x00, 0x00, 0x00, // .double: call NUMBERS
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+	0xf2, 0x0f, 0x59, 0xc1, // mulsd xmm0, xmm1
+	0xf2, 0x0f, 0x11, 0x43, 0xe8, // movsd [rbx - 24], xmm0
+	0xc7, 0x43, 0xe0, 0x01, 0x00, 0x00, 0x00, // mov dword [rbx - 32], VAL_NUMBER
+	0x48, 0x83, 0xeb, 0x10, // .done: sub rbx, 16
+};
+
+/* Division always results in a Double */
+static const unsigned char code_div[] = {
+	0x8b, 0x43, 0xe0, // mov eax, [rbx - 32]
+	0x8b, 0x4b, 0xf0, // mov ecx, [rbx - 16]
+	0xe8, 0x00, 0x00, 0x00, 0x00, // call NUMBERS
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+	0xf2, 0x0f, 0x5e, 0xc1, // divsd xmm0, xmm1
+	0xf2, 0x0f, 0x11, 0x43, 0xe8, // movsd [rbx - 24], xmm0
+	0xc7, 0x43, 0xe0, 0x01, 0x00, 0x00, 0x00, // mov dword [rbx - 32], VAL_NUMBER
+	0x48, 0x83, 0xeb, 0x10, // sub rbx, 16
+};
+
+static const unsigned char code_inv[] = {
+	0x8b, 0x43, 0xf0, // mov eax, [rbx - 16]
+	0x8d, 0x50, 0xfa, // lea edx, [rax - VAL_INT32]
+	0x83, 0xfa, 0x01, // cmp edx, 1
+	0x77, 0x28, // ja .double
+	0x48, 0x8b, 0x73, 0xf8, // mov rsi, [rbx - 8]
+	0x48, 0xf7, 0xde, // neg rsi
+	0x0f, 0x80, 0x00, 0x00, 0x00, 0x00, // jo EXIT
+	0x83, 0xf8, 0x07, // cmp eax, VAL_INT64
+	0x74, 0x0d, // je .integer
+	0x48, 0x63, 0xd6, // movsxd rdx, esi
+	0x48, 0x39, 0xf2, // cmp rdx, rsi
+	0x74, 0x05, // je .integer
+	0xb8, 0x07, 0x00, 0x00, 0x00, // mov eax, VAL_INT64
+	0x89, 0x43, 0xf0, // .integer: mov [rbx - 16], eax
+	0x48, 0x89, 0x73, 0xf8, // mov [rbx - 8], rsi
+	0xeb, 0x0f, // jmp .done
+	0x83, 0xf8, 0x01, // .double: cmp eax, VAL_NUMBER
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+	0x48, 0x0f, 0xba, 0x7b, 0xf8, 0x3f, // btc qword [rbx - 8], 63
+	// .done:
+};
+
+/*
+ * Integers are compared as integers, anything else with a Double as Doubles, the result is a Boolean.
+ * Unordered Doubles (NaN) set ZF and CF, so they compare as equal like in value_compare.
+ */
+#define CODE_COMPARISON(integer_setcc, double_operands, double_setcc) { \
+	0x8b, 0x43, 0xe0, /* mov eax, [rbx - 32] */ \
+	0x8b, 0x4b, 0xf0, /* mov ecx, [rbx - 16] */ \
+	0x8d, 0x50, 0xfa, /* lea edx, [rax - VAL_INT32] */ \
+	0x83, 0xfa, 0x01, /* cmp edx, 1 */ \
+	0x77, 0x15, /* ja .double */ \
+	0x8d, 0x51, 0xfa, /* lea edx, [rcx - VAL_INT32] */ \
+	0x83, 0xfa, 0x01, /* cmp edx, 1 */ \
+	0x77, 0x0d, /* ja .double */ \
+	0x48, 0x8b, 0x43, 0xe8, /* mov rax, [rbx - 24] */ \
+	0x48, 0x3b, 0x43, 0xf8, /* cmp rax, [rbx - 8] */ \
+	0x0f, integer_setcc, 0xc0, /* setcc al */ \
+	0xeb, 0x12, /* jmp .done */ \
+	0xe8, 0x00, 0x00, 0x00, 0x00, /* .double: call NUMBERS */ \
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, /* jne EXIT */ \
+	0x66, 0x0f, 0x2e, double_operands, /* ucomisd xmm0, xmm1 or ucomisd xmm1, xmm0 */ \
+	0x0f, double_setcc, 0xc0, /* setcc al */ \
+	0xc7, 0x43, 0xe0, 0x03, 0x00, 0x00, 0x00, /* .done: mov dword [rbx - 32], VAL_BOOLEAN */ \
+	0x88, 0x43, 0xe8, /* mov [rbx - 24], al */ \
+	0x48, 0x83, 0xeb, 0x10, /* sub rbx, 16 */ \
+}
+
+static const unsigned char code_equ[] = CODE_COMPARISON(0x94, 0xc1, 0x94); // sete, sete
+static const unsigned char code_neq[] = CODE_COMPARISON(0x95, 0xc1, 0x95); // setne, setne
+static const unsigned char code_lt[] = CODE_COMPARISON(0x9c, 0xc8, 0x97); // setl, seta with the operands swapped
+static const unsigned char code_lte[] = CODE_COMPARISON(0x9e, 0xc1, 0x96); // setle, setbe
+static const unsigned char code_gt[] = CODE_COMPARISON(0x9f, 0xc1, 0x97); // setg, seta
+static const unsigned char code_gte[] = CODE_COMPARISON(0x9d, 0xc8, 0x96); // setge, setbe with the operands swapped
+
+static const unsigned char code_not[] = {
+	0x83, 0x7b, 0xf0, 0x03, // cmp dword [rbx - 16], VAL_BOOLEAN
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+	0x80, 0x73, 0xf8, 0x01, // xor byte [rbx - 8], 1
+};
+
+static const unsigned char code_truth[] = {
+	0x83, 0x7b, 0xf0, 0x03, // cmp dword [rbx - 16], VAL_BOOLEAN
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+};
+
+static const unsigned char code_jump[] = {
+	0xe9, 0x00, 0x00, 0x00, 0x00, // jmp TARGET
+};
+
+static const unsigned char code_jump_false[] = {
+	0x83, 0x7b, 0xf0, 0x03, // cmp dword [rbx - 16], VAL_BOOLEAN
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+	0x48, 0x83, 0xeb, 0x10, // sub rbx, 16
+	0x80, 0x7b, 0x08, 0x00, // cmp byte [rbx + 8], 0
+	0x0f, 0x84, 0x00, 0x00, 0x00, 0x00, // je TARGET
+};
+
+#define CODE_JUMP_KEEP(jcc) { \
+	0x83, 0x7b, 0xf0, 0x03, /* cmp dword [rbx - 16], VAL_BOOLEAN */ \
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, /* jne EXIT */ \
+	0x80, 0x7b, 0xf8, 0x00, /* cmp byte [rbx - 8], 0 */ \
+	0x0f, jcc, 0x00, 0x00, 0x00, 0x00, /* jcc TARGET */ \
+	0x48, 0x83, 0xeb, 0x10, /* sub rbx, 16 */ \
+}
+
+static const unsigned char code_jump_false_keep[] = CODE_JUMP_KEEP(0x84);
+static const unsigned char code_jump_true_keep[] = CODE_JUMP_KEEP(0x85);
+
+/* Same as the interpreter, the state of the loop is the counter, the step and the remaining count or the stop */
+static const unsigned char code_for_next[] = {
+	0x80, 0x7a, 0x04, 0x00, // cmp byte [rdx + 4], 0
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+	0x8b, 0x4b, 0xd0, // mov ecx, [rbx - 48]
+	0x83, 0xf9, 0x01, // cmp ecx, VAL_NUMBER
+	0x74, 0x35, // je .double
+	0x48, 0x8b, 0x43, 0xd8, // mov rax, [rbx - 40]
+	0x48, 0x03, 0x43, 0xe8, // add rax, [rbx - 24]
+	0x0f, 0x80, 0x00, 0x00, 0x00, 0x00, // jo EXIT, the interpreter turns the counter into a Double
+	0x83, 0xf9, 0x07, // cmp ecx, VAL_INT64
+	0x74, 0x0c, // je .integer
+	0x48, 0x63, 0xf0, // movsxd rsi, eax
+	0x48, 0x39, 0xc6, // cmp rsi, rax
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne EXIT
+	0x48, 0x89, 0x43, 0xd8, // .integer: mov [rbx - 40], rax
+	0x89, 0x0a, // mov [rdx], ecx
+	0x48, 0x89, 0x42, 0x08, // mov [rdx + 8], rax
+	0x48, 0xff, 0x4b, 0xf8, // dec qword [rbx - 8]
+	0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, // jne TARGET
+	0xeb, 0x32, // jmp .done
+	0xf2, 0x0f, 0x10, 0x43, 0xd8, // .double: movsd xmm0, [rbx - 40]
+	0xf2, 0x0f, 0x58, 0x43, 0xe8, // addsd xmm0, [rbx - 24]
+	0xf2, 0x0f, 0x11, 0x43, 0xd8, // movsd [rbx - 40], xmm0
+	0x89, 0x0a, // mov [rdx], ecx
+	0xf2, 0x0f, 0x11, 0x42, 0x08, // movsd [rdx + 8], xmm0
+	0xf2, 0x0f, 0x10, 0x4b, 0xf8, // movsd xmm1, [rbx - 8]
+	0xf2, 0x0f, 0x5c, 0xc8, // subsd xmm1, xmm0
+	0xf2, 0x0f, 0x59, 0x4b, 0xe8, // mulsd xmm1, [rbx - 24]
+	0x66, 0x0f, 0x57, 0xd2, // xorpd xmm2, xmm2
+	0x66, 0x0f, 0x2e, 0xca, // ucomisd xmm1, xmm2
+	0x0f, 0x83, 0x00, 0x00, 0x00, 0x00, // jae TARGET
+	// .done:
+};
+
+#define TEMPLATE(code, ...) {code, sizeof code, {__VA_ARGS__}}
+#define ARITHMETIC_HOLES {32, HOLE_EXIT}, {66, HOLE_NUMBERS}, {72, HOLE_EXIT}
+#define COMPARISON_HOLES {36, HOLE_NUMBERS}, {42, HOLE_EXIT}
+
+static const struct Template template_exit = TEMPLATE(code_exit, {1, HOLE_INDEX}, {6, HOLE_EPILOGUE});
+static const struct Template template_exit_pop = TEMPLATE(code_exit_pop, {5, HOLE_INDEX}, {10, HOLE_EPILOGUE});
+static const struct Template template_local = TEMPLATE(code_local, {4, HOLE_SLOT});
+static const struct Template template_global = TEMPLATE(code_global, {3, HOLE_SLOT});
+static const struct Template template_constant = TEMPLATE(code_constant, {3, HOLE_SLOT});
+
+/* Instructions without a template leave the machine code */
+static const struct Template templates[] = {
+	[INS_NOP] = TEMPLATE(code_nop, {0, HOLE_NONE}),
+	[INS_CONST] = TEMPLATE(code_load, {0, HOLE_NONE}),
+	[INS_POP] = TEMPLATE(code_pop, {0, HOLE_NONE}),
+	[INS_LOAD_LOCAL] = TEMPLATE(code_load, {0, HOLE_NONE}),
+	[INS_LOAD_GLOBAL] = TEMPLATE(code_load, {0, HOLE_NONE}),
+	[INS_STORE_LOCAL] = TEMPLATE(code_store, {6, HOLE_EXIT}, {16, HOLE_EXIT}),
+	[INS_STORE_GLOBAL] = TEMPLATE(code_store, {6, HOLE_EXIT}, {16, HOLE_EXIT}),
+	[INS_INV] = TEMPLATE(code_inv, {20, HOLE_EXIT}, {56, HOLE_EXIT}),
+	[INS_ADD] = TEMPLATE(code_add, ARITHMETIC_HOLES),
+	[INS_SUB] = TEMPLATE(code_sub, ARITHMETIC_HOLES),
+	[INS_MUL] = TEMPLATE(code_mul, {33, HOLE_EXIT}, {67, HOLE_NUMBERS}, {73, HOLE_EXIT}),
+	[INS_DIV] = TEMPLATE(code_div, {7, HOLE_NUMBERS}, {13, HOLE_EXIT}),
+	[INS_NOT] = TEMPLATE(code_not, {6, HOLE_EXIT}),
+	[INS_TRUTH] = TEMPLATE(code_truth, {6, HOLE_EXIT}),
+	[INS_EQU] = TEMPLATE(code_equ, COMPARISON_HOLES),
+	[INS_SEQU] = TEMPLATE(code_equ, COMPARISON_HOLES),
+	[INS_NEQ] = TEMPLATE(code_neq, COMPARISON_HOLES),
+	[INS_LT] = TEMPLATE(code_lt, COMPARISON_HOLES),
+	[INS_LTE] = TEMPLATE(code_lte, COMPARISON_HOLES),
+	[INS_GT] = TEMPLATE(code_gt, COMPARISON_HOLES),
+	[INS_GTE] = TEMPLATE(code_gte, COMPARISON_HOLES),
+	[INS_JUMP] = TEMPLATE(code_jump, {1, HOLE_TARGET}),
+	[INS_JUMP_FALSE] = TEMPLATE(code_jump_false, {6, HOLE_EXIT}, {20, HOLE_TARGET}),
+	[INS_JUMP_FALSE_KEEP] = TEMPLATE(code_jump_false_keep, {6, HOLE_EXIT}, {16, HOLE_TARGET}),
+	[INS_JUMP_TRUE_KEEP] = TEMPLATE(code_jump_true_keep, {6, HOLE_EXIT}, {16, HOLE_TARGET}),
+	[INS_FOR_NEXT] = TEMPLATE(code_for_next, {6, HOLE_EXIT}, {28, HOLE_EXIT}, {45, HOLE_EXIT}, {65, HOLE_TARGET}, {117, HOLE_TARGET}),
+};
+
+struct Patch {
+	size_t at; // Offset of the rel32
+	uint32_t index;
+	bool is_exit; // Jumps to the exit of the instruction instead of its code
+	bool undo; // The exit pops the value pushed by the first half of a superinstruction
+};
+
+static const struct Template *select_template(struct Instruction instruction, struct Instruction operand, const struct Template **address);
+static bool has_exits(const struct Template *template);
+static size_t emit(unsigned char *buffer, size_t size, const struct Template *template, uint32_t index, uint32_t arg, struct Patch patches[], size_t *patch_count);
+static void patch_rel32(unsigned char *buffer, size_t at, size_t to);
+
+struct JitCode *jit_compile(struct Chunk *chunk) {
+	if (chunk->code_len == 0 || chunk->code_len >= JIT_BAILOUT || chunk->code[chunk->code_len - 1].op != INS_RETURN) return NULL;
+	
+	size_t capacity = sizeof code_entry + sizeof code_epilogue + sizeof code_numbers + chunk->code_len * (2 * TEMPLATE_MAX + 2 * sizeof code_exit_pop);
+	unsigned char *buffer = malloc(capacity);
+	size_t *offsets = malloc(sizeof *offsets * chunk->code_len);
+	size_t (*exits)[2] = calloc(chunk->code_len, sizeof *exits); // Without and with the undo
+	struct Patch *patches = malloc(sizeof *patches * chunk->code_len * TEMPLATE_HOLES);
+	struct JitCode *code = malloc(sizeof *code);
+	if (!buffer || !offsets || !exits || !patches || !code) goto fail;
+	
+	memcpy(buffer, code_entry, sizeof code_entry);
+	memcpy(buffer + sizeof code_entry, code_epilogue, sizeof code_epilogue);
+	memcpy(buffer + sizeof code_entry + sizeof code_epilogue, code_numbers, sizeof code_numbers);
+	size_t size = sizeof code_entry + sizeof code_epilogue + sizeof code_numbers;
+	size_t patch_count = 0;
+	
+	for (uint32_t i = 0; i < chunk->code_len; ++i) {
+		struct Instruction *instruction = &chunk->code[i];
+		offsets[i] = size;
+		
+		// Superinstructions are compiled as the pair they replace, exits in the second one drop what the first pushed
+		struct Instruction parts[2];
+		if (chunk_unfuse(*instruction, parts)) {
+			const struct Template *first_address, *second_address;
+			const struct Template *first = select_template(parts[0], parts[0], &first_address);
+			const struct Template *second = select_template(parts[1], parts[1], &second_address);
+			if (first == &template_exit || second == &template_exit || (first->code != code_load && has_exits(second))) {
+				size = emit(buffer, size, &template_exit, i, 0, patches, &patch_count);
+				continue;
+			}
+			if (first_address) size = emit(buffer, size, first_address, i, parts[0].arg, patches, &patch_count);
+			size = emit(buffer, size, first, i, parts[0].arg, patches, &patch_count);
+			size_t undone = patch_count;
+			if (second_address) size = emit(buffer, size, second_address, i, parts[1].arg, patches, &patch_count);
+			size = emit(buffer, size, second, i, parts[1].arg, patches, &patch_count);
+			while (undone < patch_count) patches[undone++].undo = true;
+			continue;
+		}
+		
+		// Loops store the variable in the next instruction themselves
+		bool is_loop = instruction->op == INS_FOR_PREP || instruction->op == INS_FOR_NEXT;
+		if (is_loop && i + 1 >= chunk->code_len) goto fail;
+		
+		const struct Template *address;
+		const struct Template *template = select_template(*instruction, is_loop ? chunk->code[i + 1] : *instruction, &address);
+		if (address) size = emit(buffer, size, address, i, (is_loop ? chunk->code[i + 1] : *instruction).arg, patches, &patch_count);
+		size = emit(buffer, size, template, i, instruction->arg, patches, &patch_count);
+		
+		if (is_loop) offsets[++i] = size;
+	}
+	
+	// Exits are put after all of the code, so that guards which pass fall through
+	for (size_t i = 0; i < patch_count; ++i) {
+		struct Patch *patch = &patches[i];
+		if (!patch->is_exit) {
+			if (patch->index >= chunk->code_len) goto fail;
+			patch_rel32(buffer, patch->at, offsets[patch->index]);
+			continue;
+		}
+		size_t *exit = &exits[patch->index][patch->undo];
+		if (!*exit) {
+			*exit = size;
+			size = emit(buffer, size, patch->undo ? &template_exit_pop : &template_exit, patch->index | JIT_BAILOUT, 0, NULL, NULL);
+		}
+		patch_rel32(buffer, patch->at, *exit);
+	}
+	
+	unsigned char *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) goto fail;
+	memcpy(memory, buffer, size);
+	if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+		munmap(memory, size);
+		goto fail;
+	}
+	
+	free(buffer);
+	free(exits);
+	free(patches);
+	*code = (struct JitCode){.memory = memory, .size = size, .offsets = offsets, .bailouts = 0};
+	return code;
+	
+	fail:
+	free(buffer);
+	free(offsets);
+	free(exits);
+	free(patches);
+	free(code);
+	return NULL;
+}
+
+struct JitResume jit_run(struct Chunk *chunk, struct Value *sp, struct Value *locals, struct Value *globals, uint32_t index) {
+	struct JitCode *code = chunk->jit;
+	
+	// ISO C has no conversion from an object pointer to a function pointer
+	JitEntry *entry;
+	void *memory = code->memory;
+	memcpy(&entry, &memory, sizeof entry);
+	struct JitExit result = entry(sp, locals, globals, chunk->constants, code->memory + code->offsets[index]);
+	
+	if (result.index & JIT_BAILOUT && ++code->bailouts >= JIT_MAX_BAILOUTS) {
+		// The types don't settle, the interpreter is better off without the machine code
+		jit_free(code);
+		chunk->jit = NULL;
+	}
+	return (struct JitResume){.index = result.index & ~JIT_BAILOUT, .sp = result.sp};
+}
+
+void jit_free(struct JitCode *code) {
+	if (!code) return;
+	munmap(code->memory, code->size);
+	free(code->offsets);
+	free(code);
+}
+
+/* The operand is the instruction with the slot, the address template for it is returned along with the template */
+static const struct Template *select_template(struct Instruction instruction, struct Instruction operand, const struct Template **address) {
+	*address = NULL;
+	const struct Template *template = instruction.op < sizeof templates / sizeof *templates ? &templates[instruction.op] : NULL;
+	if (!template || !template->code) return &template_exit;
+	
+	switch (operand.op) {
+		case INS_CONST:
+			*address = &template_constant;
+			break;
+		case INS_LOAD_LOCAL:
+		case INS_STORE_LOCAL:
+			*address = &template_local;
+			break;
+		case INS_LOAD_GLOBAL:
+		case INS_STORE_GLOBAL:
+			*address = &template_global;
+			break;
+	}
+	if (*address && operand.arg > INT32_MAX / sizeof(struct Value)) {
+		*address = NULL;
+		return &template_exit;
+	}
+	return template;
+}
+
+static bool has_exits(const struct Template *template) {
+	for (int i = 0; i < TEMPLATE_HOLES && template->holes[i].kind != HOLE_NONE; ++i) {
+		if (template->holes[i].kind == HOLE_EXIT) return true;
+	}
+	return false;
+}
+
+/* The arg is the slot of the operand for the address templates, the target for jumps */
+static size_t emit(unsigned char *buffer, size_t size, const struct Template *template, uint32_t index, uint32_t arg, struct Patch patches[], size_t *patch_count) {
+	memcpy(buffer + size, template->code, template->size);
+	for (int i = 0; i < TEMPLATE_HOLES && template->holes[i].kind != HOLE_NONE; ++i) {
+		size_t at = size + template->holes[i].offset;
+		switch (template->holes[i].kind) {
+			case HOLE_SLOT:;
+				uint32_t slot = arg * sizeof(struct Value);
+				memcpy(buffer + at, &slot, sizeof slot);
+				break;
+			case HOLE_INDEX:
+				memcpy(buffer + at, &index, sizeof index);
+				break;
+			case HOLE_TARGET:
+				patches[(*patch_count)++] = (struct Patch){.at = at, .index = arg, .is_exit = false, .undo = false};
+				break;
+			case HOLE_EXIT:
+				patches[(*patch_count)++] = (struct Patch){.at = at, .index = index, .is_exit = true, .undo = false};
+				break;
+			case HOLE_EPILOGUE:
+				patch_rel32(buffer, at, sizeof code_entry);
+				break;
+			case HOLE_NUMBERS:
+				patch_rel32(buffer, at, sizeof code_entry + sizeof code_epilogue);
+				break;
+		}
+	}
+	return size + template->size;
+}
+
+static void patch_rel32(unsigned char *buffer, size_t at, size_t to) {
+	int32_t rel = (int64_t) to - (int64_t) (at + 4);
+	memcpy(buffer + at, &rel, sizeof rel);
+}
+
+#else
+
+struct JitCode *jit_compile(struct Chunk *chunk) {
+	(void) chunk;
+	return NULL;
+}
+
+struct JitResume jit_run(struct Chunk *chunk, struct Value *sp, struct Value *locals, struct Value *globals, uint32_t index) {
+	(void) chunk; (void) locals; (void) globals;
+	return (struct JitResume){.index = index, .sp = sp};
+}
+
+void jit_free(struct JitCode *code) {
+	(void) code;
+}
+
+#endif
@@ -0,0 +1,60 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_JIT_H
+#define RUNTIME_JIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "runtime/bytecode.h"
+#include "runtime/value.h"
+
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD 1000
+#endif
+
+#ifndef JIT_MAX_BAILOUTS
+#define JIT_MAX_BAILOUTS 100
+#endif
+
+/*
+ * Baseline JIT for x86-64 Linux, the code of a chunk is translated by copying a template
+ * of machine code for each instruction and patching the holes in it (slots, jumps). A chunk
+ * is compiled once it gets hot: runs of the chunk and backward jumps in it both count. The
+ * templates only handle the common types inline: numbers in arithmetic and comparisons,
+ * Booleans in conditions and uncounted values in stores. A guard on the types bails out to
+ * the interpreter otherwise. Instructions without a template always leave the machine code,
+ * the interpreter enters it again at the next backward jump. Superinstructions are compiled as
+ * the pair of instructions they replace. Chunks which bail out too often
+ * are dropped back to the interpreter for good.
+ *
+ * Without the JIT definition, or on other platforms, nothing is ever compiled.
+ */
+struct JitCode;
+
+struct JitResume {
+	uint32_t index; // Instruction at which the interpreter takes over
+	struct Value *sp;
+};
+
+struct JitCode *jit_compile(struct Chunk *chunk);
+struct JitResume jit_run(struct Chunk *chunk, struct Value *sp, struct Value *locals, struct Value *globals, uint32_t index);
+void jit_free(struct JitCode *code);
+
+#endif
@@ -0,0 +1,181 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runtime/heap.h"
+#include "runtime/map.h"
+#include "runtime/value.h"
+
+// Shapes with fewer keys than this are searched by walking the parents
+#define SHAPE_TABLE_THRESHOLD 8
+#define MAP_MIN_CAPACITY 4
+
+static struct Shape root_shape = {.id = 0};
+static uint32_t last_shape_id = 0;
+
+static struct Shape *shape_transition(struct Shape *shape, char *key);
+static size_t shape_lookup(struct Shape *shape, char *key);
+static bool shape_build_table(struct Shape *shape);
+static uint32_t key_hash(char *key);
+
+struct Map *map_new(void) {
+	struct Map *map = malloc(sizeof *map);
+	if (!map) return NULL;
+	*map = (struct Map){.shape = &root_shape, .values = NULL, .capacity = 0};
+	return map;
+}
+
+size_t map_slot(struct Map *map, char *key) {
+	return shape_lookup(map->shape, key);
+}
+
+struct Value *map_get(struct Map *map, char *key) {
+	size_t slot = shape_lookup(map->shape, key);
+	return slot == MAP_NO_SLOT ? NULL : &map->values[slot];
+}
+
+bool map_set(struct Map *map, char *key, struct Value value) {
+	size_t slot = shape_lookup(map->shape, key);
+	if (slot != MAP_NO_SLOT) {
+		heap_assign(&map->values[slot], value);
+		return true;
+	}
+	
+	// Add a new key
+	struct Shape *shape = shape_transition(map->shape, key);
+	if (!shape) return false;
+	if (shape->count > map->capacity) {
+		size_t capacity = map->capacity ? map->capacity * 2 : MAP_MIN_CAPACITY;
+		struct Value *values = realloc(map->values, sizeof *values * capacity);
+		if (!values) return false;
+		map->values = values;
+		map->capacity = capacity;
+	}
+	map->shape = shape;
+	map->values[shape->count - 1] = value;
+	heap_retain(&value);
+	return true;
+}
+
+bool map_delete(struct Map *map, char *key) {
+	size_t slot = shape_lookup(map->shape, key);
+	if (slot == MAP_NO_SLOT) return true;
+	
+	// Collect the remaining keys in insertion order
+	size_t count = map->shape->count;
+	char **keys = malloc(sizeof *keys * count);
+	if (!keys) return false;
+	struct Shape *shape = map->shape;
+	for (size_t i = count; i-- > 0; shape = shape->parent) keys[i] = shape->key;
+	
+	// Rebuild the shape from the root without the deleted key, the slots after it move down by one
+	shape = &root_shape;
+	for (size_t i = 0; i < count; ++i) {
+		if (i == slot) continue;
+		shape = shape_transition(shape, keys[i]);
+		if (!shape) {
+			free(keys);
+			return false;
+		}
+	}
+	free(keys);
+	
+	heap_release(&map->values[slot]);
+	memmove(map->values + slot, map->values + slot + 1, sizeof *map->values * (count - slot - 1));
+	map->shape = shape;
+	return true;
+}
+
+void map_free(struct Map *map) {
+	// The values aren't released, the heap takes care of that when it frees a map
+	if (!map) return;
+	free(map->values);
+	free(map);
+}
+
+static struct Shape *shape_transition(struct Shape *shape, char *key) {
+	for (struct Shape *child = shape->children; child; child = child->sibling) {
+		if (strcmp(child->key, key) == 0) return child;
+	}
+	
+	// Shapes are shared by all maps and are never freed
+	struct Shape *child = malloc(sizeof *child);
+	if (!child) return NULL;
+	*child = (struct Shape){
+		.id = ++last_shape_id,
+		.count = shape->count + 1,
+		.key = strdup(key),
+		.parent = shape,
+		.children = NULL,
+		.sibling = shape->children,
+		.table = NULL,
+	};
+	if (!child->key) {
+		free(child);
+		return NULL;
+	}
+	shape->children = child;
+	return child;
+}
+
+static size_t shape_lookup(struct Shape *shape, char *key) {
+	if (shape->count >= SHAPE_TABLE_THRESHOLD && (shape->table || shape_build_table(shape))) {
+		size_t mask = shape->table_capacity - 1;
+		for (size_t i = key_hash(key) & mask; shape->table[i].key; i = (i + 1) & mask) {
+			if (strcmp(shape->table[i].key, key) == 0) return shape->table[i].slot;
+		}
+		return MAP_NO_SLOT;
+	}
+	
+	for (; shape->key; shape = shape->parent) {
+		if (strcmp(shape->key, key) == 0) return shape->count - 1;
+	}
+	return MAP_NO_SLOT;
+}
+
+static bool shape_build_table(struct Shape *shape) {
+	size_t capacity = 1;
+	while (capacity < shape->count * 2) capacity *= 2;
+	struct ShapeEntry *table = calloc(capacity, sizeof *table);
+	if (!table) return false;
+	
+	for (struct Shape *curr = shape; curr->key; curr = curr->parent) {
+		size_t i = key_hash(curr->key) & (capacity - 1);
+		while (table[i].key) i = (i + 1) & (capacity - 1);
+		table[i] = (struct ShapeEntry){.key = curr->key, .slot = curr->count - 1};
+	}
+	
+	shape->table = table;
+	shape->table_capacity = capacity;
+	return true;
+}
+
+static uint32_t key_hash(char *key) {
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (; *key; ++key) {
+		hash ^= (unsigned char) *key;
+		hash *= 16777619u;
+	}
+	return hash;
+}
@@ -0,0 +1,67 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_MAP_H
+#define RUNTIME_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "runtime/heap.h"
+#include "runtime/value.h"
+
+#define MAP_NO_SLOT SIZE_MAX
+
+struct ShapeEntry {
+	char *key;
+	size_t slot;
+};
+
+/* 
+ * A shape describes the layout of a map, i.e. which key is stored in which slot.
+ * Maps which had the same keys added in the same order share the same shape,
+ * so the slot of a key can be cached against the shape's ID.
+ */
+struct Shape {
+	uint32_t id;
+	size_t count;
+	char *key; // The key added by this shape, NULL for the root shape
+	struct Shape *parent;
+	struct Shape *children;
+	struct Shape *sibling;
+	// Built on demand for looking up keys without walking the parents
+	struct ShapeEntry *table;
+	size_t table_capacity;
+};
+
+struct Map {
+	struct HeapObject object;
+	struct Shape *shape;
+	struct Value *values;
+	size_t capacity;
+};
+
+struct Map *map_new(void);
+size_t map_slot(struct Map *map, char *key);
+struct Value *map_get(struct Map *map, char *key);
+bool map_set(struct Map *map, char *key, struct Value value);
+bool map_delete(struct Map *map, char *key);
+void map_free(struct Map *map);
+
+#endif
@@ -0,0 +1,1332 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runtime/regex.h"
+#include "runtime/string.h"
+#include "utils.h"
+
+#define NO_NODE UINT32_MAX
+#define NO_GROUP UINT32_MAX
+#define NO_SLOT UINT32_MAX
+#define REPEAT_INFINITE UINT32_MAX
+#define REPEAT_MAX 1000 // Largest count in a repetition
+#define NESTING_MAX 256 // Deepest nesting of groups
+#define DFA_BUCKETS 256
+#define DFA_UNKNOWN 0
+#define DFA_DEAD 0xFFFE
+#define DFA_MATCH 0xFFFF
+
+enum RegexOp {
+	RE_CHAR,
+	RE_CHAR_FOLD, // The argument is a lowercase letter
+	RE_SET,
+	RE_ANY, // Any character but a newline
+	RE_ANY_NL,
+	RE_SPLIT, // Threads at the argument and at the alternative, the first one is preferred
+	RE_JUMP,
+	RE_SAVE,
+	RE_PROGRESS, // Leaves a loop at the alternative if the iteration which started at the slot took no characters
+	RE_ASSERT,
+	RE_MATCH,
+};
+
+enum RegexAssertion {
+	RE_SUBJECT_START, // \A, ^
+	RE_SUBJECT_END, // \z
+	RE_FINAL_END, // \Z, $ - The end or before a newline at the end
+	RE_LINE_START, // ^ with the m option
+	RE_LINE_END, // $ with the m option
+	RE_WORD_BOUNDARY,
+	RE_NOT_WORD_BOUNDARY,
+};
+
+struct RegexInstruction {
+	uint8_t op;
+	uint32_t arg;
+	uint32_t alt;
+	uint32_t loop; // Slot of the innermost loop with a progress check around the instruction
+};
+
+struct RegexSet {
+	uint64_t bits[4];
+};
+
+enum NodeType {
+	NODE_EMPTY,
+	NODE_CHAR,
+	NODE_SET,
+	NODE_ANY,
+	NODE_ASSERT,
+	NODE_GROUP,
+	NODE_CONCAT,
+	NODE_ALTERNATE,
+	NODE_REPEAT,
+};
+
+/* Syntax tree of a pattern, the nodes refer to each other by index */
+struct Node {
+	uint8_t type;
+	bool flag; // Folded character, dot which matches newlines or lazy repetition
+	uint32_t arg; // Character, set, assertion, group or slot of a loop
+	uint32_t min, max;
+	uint32_t child; // First one of a group, concatenation, alternation or repetition
+	uint32_t next; // Sibling in a concatenation or alternation
+};
+
+struct Parser {
+	struct String pattern;
+	size_t pos;
+	struct Node *nodes;
+	size_t node_count;
+	size_t node_cap;
+	struct RegexSet *sets;
+	size_t set_count;
+	size_t set_cap;
+	size_t groups;
+	unsigned depth;
+	bool fold, multiline, dotall; // Options
+	struct RegexError *error;
+};
+
+enum Context {
+	CONTEXT_START,
+	CONTEXT_NEWLINE,
+	CONTEXT_WORD,
+	CONTEXT_OTHER,
+};
+
+enum DfaResult {
+	DFA_NONE,
+	DFA_FOUND,
+	DFA_GAVE_UP,
+};
+
+/* Threads of the Pike VM at a position, without their captures */
+struct DfaState {
+	struct DfaState *chain;
+	uint32_t hash;
+	uint16_t index;
+	uint8_t context; // Kind of the character before the position
+	bool starts; // A thread starts at the position
+	uint16_t *next; // Index plus one of the state after each class of characters and after the end, DFA_DEAD or DFA_MATCH
+	uint32_t count;
+	uint32_t pcs[]; // Where the threads go on after the character before
+};
+
+struct Threads {
+	uint32_t *pcs;
+	size_t *caps; // The slots of each thread
+	size_t count;
+};
+
+/* A thread to follow, or a slot to restore once the threads after a save are followed */
+struct Frame {
+	uint32_t pc;
+	uint32_t slot;
+	size_t old;
+};
+
+struct Regex {
+	struct RegexInstruction *code;
+	size_t len;
+	size_t code_cap;
+	struct RegexSet *sets;
+	size_t groups;
+	size_t loops; // Slots for the start of the current iteration of some loops, they come before the captures
+	uint32_t loop; // Innermost one of them while the program is emitted
+	size_t slots;
+	bool anchored; // A match can only start at the start
+	bool skip; // A match can't be empty, the subject can be skipped until one can start
+	struct String prefix; // Every match starts with it
+	bool prefix_fold;
+	struct RegexSet first; // Characters a match can start with
+	// Kept for the matches, they are as big as the program can need
+	struct Threads lists[2];
+	uint32_t *marks; // Generation in which an instruction was last added to a list
+	uint32_t generation;
+	struct Frame *stack;
+	size_t *work;
+	bool too_large;
+	// Lazy DFA which finds out if there is a match and where it can start, see dfa_search
+	unsigned char classes[UCHAR_MAX + 1]; // Characters which no instruction tells apart share a class
+	unsigned char class_bytes[UCHAR_MAX + 1]; // A character of each class
+	size_t class_count;
+	bool context; // Some assertions look at the character before the position
+	bool final_end; // Some assertions have to know whether a newline is the last character
+	bool dfa_off; // There are too many states
+	struct DfaState **states;
+	size_t state_count;
+	size_t state_cap;
+	struct DfaState *state_buckets[DFA_BUCKETS];
+	uint16_t idle[4]; // Index plus one of the state without threads after each kind of character
+};
+
+struct CacheEntry {
+	char *pattern;
+	size_t len;
+	uint32_t hash;
+	struct Regex *regex;
+	struct CacheEntry *chain; // Next in the bucket
+	struct CacheEntry *newer, *older;
+};
+
+static struct CacheEntry cache[REGEX_CACHE_SIZE];
+static struct CacheEntry *buckets[REGEX_CACHE_SIZE * 2];
+static size_t cache_used;
+static struct CacheEntry *newest, *oldest;
+
+static uint32_t fail(struct Parser *parser, char *msg);
+static uint32_t add_node(struct Parser *parser, struct Node node);
+static uint32_t add_set(struct Parser *parser, struct RegexSet *set);
+static uint32_t parse_alternation(struct Parser *parser);
+static uint32_t parse_sequence(struct Parser *parser);
+static uint32_t parse_atom(struct Parser *parser);
+static uint32_t parse_group(struct Parser *parser);
+static uint32_t parse_class(struct Parser *parser);
+static int parse_escape(struct Parser *parser, struct RegexSet *set, bool in_class);
+static bool parse_options(struct Parser *parser);
+static uint32_t parse_quantifier(struct Parser *parser, uint32_t atom);
+static bool parse_count(struct Parser *parser, uint32_t *count);
+static uint32_t char_node(struct Parser *parser, unsigned char chr);
+static void set_add(struct RegexSet *set, unsigned char chr, bool fold);
+static void set_add_range(struct RegexSet *set, unsigned char from, unsigned char to, bool fold);
+static void set_union(struct RegexSet *set, struct RegexSet *other);
+static void set_invert(struct RegexSet *set);
+static bool set_has(struct RegexSet *set, unsigned char chr);
+static bool escape_set(char chr, struct RegexSet *set);
+static bool build(struct Regex *regex, struct Parser *parser, uint32_t root);
+static uint32_t emit(struct Regex *regex, enum RegexOp op, uint32_t arg, uint32_t alt);
+static bool emit_node(struct Regex *regex, struct Node nodes[], uint32_t index);
+static bool first_set(struct Node nodes[], struct RegexSet sets[], uint32_t index, struct RegexSet *first);
+static void find_prefix(struct Regex *regex, struct Node nodes[], uint32_t root);
+static uint32_t leading_child(struct Node nodes[], uint32_t root);
+static void find_classes(struct Regex *regex);
+static void refine_classes(struct RegexSet classes[], size_t *count, struct RegexSet *set);
+static enum DfaResult dfa_search(struct Regex *regex, struct String subject, size_t start, size_t *from);
+static uint16_t dfa_step(struct Regex *regex, struct DfaState *state, size_t symbol);
+static uint16_t dfa_idle(struct Regex *regex, enum Context context);
+static uint16_t dfa_state(struct Regex *regex, uint32_t pcs[], size_t count, enum Context context, bool starts);
+static enum Context context_of(struct Regex *regex, char chars[], size_t pos);
+static bool run_nfa(struct Regex *regex, struct String subject, size_t start, size_t captures[]);
+static bool accepts(struct Regex *regex, struct RegexInstruction *instruction, int chr);
+static size_t skip(struct Regex *regex, struct String subject, size_t pos);
+static void add_thread(struct Regex *regex, struct Threads *list, uint32_t pc, struct String subject, size_t pos, size_t slots);
+static bool asserts(enum RegexAssertion assertion, struct String subject, size_t pos);
+static void copy_slots(size_t *dest, size_t *src, size_t slots);
+static bool is_word(unsigned char chr);
+static void next_generation(struct Regex *regex);
+static uint32_t pattern_hash(struct String pattern);
+static void cache_unlink(struct CacheEntry *entry);
+
+struct Regex *regex_compile(struct String pattern, struct RegexError *error) {
+	*error = (struct RegexError){.msg = NULL};
+	struct Parser parser = {.pattern = pattern, .error = error};
+	uint32_t root = parse_alternation(&parser);
+	if (root != NO_NODE && parser.pos < pattern.len) root = fail(&parser, "Unmatched closing parenthesis");
+	
+	struct Regex *regex = root == NO_NODE ? NULL : calloc(1, sizeof *regex);
+	if (regex) {
+		regex->sets = parser.sets;
+		parser.sets = NULL;
+		regex->groups = parser.groups;
+		if (!build(regex, &parser, root)) {
+			if (regex->too_large) *error = (struct RegexError){.msg = "Pattern is too large", .offset = pattern.len};
+			regex_free(regex);
+			regex = NULL;
+		}
+	}
+	free(parser.nodes);
+	free(parser.sets);
+	return regex;
+}
+
+struct Regex *regex_cached(struct String pattern, struct RegexError *error) {
+	uint32_t hash = pattern_hash(pattern);
+	struct CacheEntry **bucket = &buckets[hash % lenof(buckets)];
+	for (struct CacheEntry *entry = *bucket; entry; entry = entry->chain) {
+		if (entry->hash != hash || entry->len != pattern.len || memcmp(entry->pattern, pattern.chars, pattern.len) != 0) continue;
+		if (entry != newest) {
+			cache_unlink(entry);
+			entry->older = newest;
+			newest->newer = entry;
+			newest = entry;
+		}
+		return entry->regex;
+	}
+	
+	struct Regex *regex = regex_compile(pattern, error);
+	if (!regex) return NULL;
+	char *copy = malloc(pattern.len + 1);
+	if (!copy) {
+		regex_free(regex);
+		return NULL;
+	}
+	memcpy(copy, pattern.chars, pattern.len);
+	
+	// The least recently used pattern makes way once the cache is full
+	struct CacheEntry *entry;
+	if (cache_used < REGEX_CACHE_SIZE) {
+		entry = &cache[cache_used++];
+	} else {
+		entry = oldest;
+		cache_unlink(entry);
+		struct CacheEntry **link = &buckets[entry->hash % lenof(buckets)];
+		while (*link != entry) link = &(*link)->chain;
+		*link = entry->chain;
+		regex_free(entry->regex);
+		free(entry->pattern);
+	}
+	
+	*entry = (struct CacheEntry){.pattern = copy, .len = pattern.len, .hash = hash, .regex = regex, .chain = *bucket, .older = newest};
+	*bucket = entry;
+	if (newest) newest->newer = entry;
+	newest = entry;
+	if (!oldest) oldest = entry;
+	return regex;
+}
+
+size_t regex_groups(struct Regex *regex) {
+	return regex->groups;
+}
+
+bool regex_match(struct Regex *regex, struct String subject, size_t start, size_t captures[]) {
+	if (start > subject.len) return false;
+	
+	// The DFA can't tell a newline at the end from the others
+	if (!regex->dfa_off && !(regex->final_end && subject.len && subject.chars[subject.len - 1] == '\n')) {
+		size_t from;
+		switch (dfa_search(regex, subject, start, &from)) {
+			case DFA_NONE:
+				return false;
+			case DFA_FOUND:
+				if (!captures) return true;
+				start = from;
+				break;
+			case DFA_GAVE_UP:
+				break;
+		}
+	}
+	return run_nfa(regex, subject, start, captures);
+}
+
+void regex_free(struct Regex *regex) {
+	if (!regex) return;
+	free(regex->code);
+	free(regex->sets);
+	free(regex->prefix.chars);
+	for (size_t i = 0; i < 2; ++i) {
+		free(regex->lists[i].pcs);
+		free(regex->lists[i].caps);
+	}
+	free(regex->marks);
+	free(regex->stack);
+	free(regex->work);
+	for (size_t i = 0; i < regex->state_count; ++i) free(regex->states[i]);
+	free(regex->states);
+	free(regex);
+}
+
+/* Runs the threads of the NFA in step from the start, the Pike VM */
+static bool run_nfa(struct Regex *regex, struct String subject, size_t start, size_t captures[]) {
+	size_t slots = captures ? regex->slots : regex->loops; // Without captures only the loops need slots
+	struct Threads *current = &regex->lists[0], *next = &regex->lists[1];
+	current->count = 0;
+	bool matched = false;
+	
+	next_generation(regex);
+	for (size_t pos = start;; ++pos) {
+		// A new thread starts at every position until there is a match, with the lowest priority
+		if (!matched && (pos == start || !regex->anchored)) {
+			if (current->count == 0 && regex->skip) {
+				size_t found = skip(regex, subject, pos);
+				if (found == STRING_NOT_FOUND) break;
+				if (found != pos) next_generation(regex);
+				pos = found;
+			}
+			for (size_t i = 0; i < slots; ++i) regex->work[i] = REGEX_UNSET;
+			add_thread(regex, current, 0, subject, pos, slots);
+		}
+		if (current->count == 0) {
+			if (matched || regex->anchored || pos >= subject.len) break;
+			next_generation(regex);
+			continue;
+		}
+		
+		int chr = pos < subject.len ? (unsigned char) subject.chars[pos] : -1;
+		next_generation(regex);
+		next->count = 0;
+		for (size_t i = 0; i < current->count; ++i) {
+			struct RegexInstruction *instruction = &regex->code[current->pcs[i]];
+			size_t *caps = &current->caps[i * slots];
+			if (instruction->op == RE_MATCH) {
+				matched = true;
+				if (captures) memcpy(captures, caps + regex->loops, (slots - regex->loops) * sizeof *caps);
+				break; // The threads after this one have a lower priority
+			}
+			if (!accepts(regex, instruction, chr)) continue;
+			
+			// Mostly the next instruction waits for a character too, the thread moves on to it directly
+			uint32_t pc = current->pcs[i] + 1;
+			struct RegexInstruction *following = &regex->code[pc];
+			if (following->op <= RE_ANY_NL || following->op == RE_MATCH) {
+				size_t mark = 2 * pc + (following->loop != NO_SLOT && caps[following->loop] == pos + 1);
+				if (regex->marks[mark] == regex->generation) continue;
+				regex->marks[mark] = regex->generation;
+				next->pcs[next->count] = pc;
+				copy_slots(&next->caps[next->count++ * slots], caps, slots);
+				continue;
+			}
+			copy_slots(regex->work, caps, slots);
+			add_thread(regex, next, pc, subject, pos + 1, slots);
+		}
+		
+		struct Threads *swap = current;
+		current = next;
+		next = swap;
+		if (pos >= subject.len) break;
+	}
+	return matched;
+}
+
+static bool accepts(struct Regex *regex, struct RegexInstruction *instruction, int chr) {
+	switch (instruction->op) {
+		case RE_CHAR:
+			return chr == (int) instruction->arg;
+		case RE_CHAR_FOLD:
+			return chr >= 0 && (uint32_t) (chr | 0x20) == instruction->arg;
+		case RE_SET:
+			return chr >= 0 && set_has(&regex->sets[instruction->arg], chr);
+		case RE_ANY:
+			return chr >= 0 && chr != '\n';
+		case RE_ANY_NL:
+			return chr >= 0;
+	}
+	return false;
+}
+
+static uint32_t fail(struct Parser *parser, char *msg) {
+	*parser->error = (struct RegexError){.msg = msg, .offset = parser->pos};
+	return NO_NODE;
+}
+
+static uint32_t add_node(struct Parser *parser, struct Node node) {
+	struct Node *nodes = grow_array(parser->nodes, &parser->node_cap, parser->node_count, sizeof *nodes);
+	if (!nodes) return NO_NODE;
+	parser->nodes = nodes;
+	node.next = NO_NODE;
+	parser->nodes[parser->node_count] = node;
+	return parser->node_count++;
+}
+
+static uint32_t add_set(struct Parser *parser, struct RegexSet *set) {
+	struct RegexSet *sets = grow_array(parser->sets, &parser->set_cap, parser->set_count, sizeof *sets);
+	if (!sets) return NO_NODE;
+	parser->sets = sets;
+	parser->sets[parser->set_count] = *set;
+	return add_node(parser, (struct Node){.type = NODE_SET, .arg = parser->set_count++});
+}
+
+static uint32_t parse_alternation(struct Parser *parser) {
+	uint32_t first = parse_sequence(parser);
+	if (first == NO_NODE || parser->pos >= parser->pattern.len || parser->pattern.chars[parser->pos] != '|') return first;
+	
+	uint32_t alternation = add_node(parser, (struct Node){.type = NODE_ALTERNATE, .child = first});
+	uint32_t last = first;
+	while (alternation != NO_NODE && parser->pos < parser->pattern.len && parser->pattern.chars[parser->pos] == '|') {
+		++parser->pos;
+		uint32_t sequence = parse_sequence(parser);
+		if (sequence == NO_NODE) return NO_NODE;
+		parser->nodes[last].next = sequence;
+		last = sequence;
+	}
+	return alternation;
+}
+
+static uint32_t parse_sequence(struct Parser *parser) {
+	uint32_t sequence = add_node(parser, (struct Node){.type = NODE_CONCAT, .child = NO_NODE});
+	uint32_t last = NO_NODE;
+	while (sequence != NO_NODE && parser->pos < parser->pattern.len) {
+		char chr = parser->pattern.chars[parser->pos];
+		if (chr == '|' || chr == ')') break;
+		
+		uint32_t atom = parse_atom(parser);
+		if (atom != NO_NODE) atom = parse_quantifier(parser, atom);
+		if (atom == NO_NODE) return NO_NODE;
+		if (last == NO_NODE) {
+			parser->nodes[sequence].child = atom;
+		} else {
+			parser->nodes[last].next = atom;
+		}
+		last = atom;
+	}
+	return sequence;
+}
+
+static uint32_t parse_atom(struct Parser *parser) {
+	struct RegexSet set = {{0}};
+	unsigned char chr = parser->pattern.chars[parser->pos++];
+	switch (chr) {
+		case '(':
+			return parse_group(parser);
+		case '[':
+			return parse_class(parser);
+		case '.':
+			return add_node(parser, (struct Node){.type = NODE_ANY, .flag = parser->dotall});
+		case '^':
+			return add_node(parser, (struct Node){.type = NODE_ASSERT, .arg = parser->multiline ? RE_LINE_START : RE_SUBJECT_START});
+		case '$':
+			return add_node(parser, (struct Node){.type = NODE_ASSERT, .arg = parser->multiline ? RE_LINE_END : RE_FINAL_END});
+		case '*':
+		case '+':
+		case '?':
+			--parser->pos;
+			return fail(parser, "Nothing to repeat");
+		case '\\':;
+			int escape = parse_escape(parser, &set, false);
+			if (escape == -1) return NO_NODE;
+			if (escape == -2) return add_set(parser, &set);
+			if (escape < -2) return add_node(parser, (struct Node){.type = NODE_ASSERT, .arg = -3 - escape});
+			return char_node(parser, escape);
+		default:
+			return char_node(parser, chr);
+	}
+}
+
+/* The opening parenthesis is already taken */
+static uint32_t parse_group(struct Parser *parser) {
+	struct String pattern = parser->pattern;
+	if (++parser->depth > NESTING_MAX) return fail(parser, "Groups are nested too deeply");
+	bool fold = parser->fold, multiline = parser->multiline, dotall = parser->dotall;
+	
+	uint32_t group = NO_GROUP;
+	if (parser->pos < pattern.len && pattern.chars[parser->pos] == '?') {
+		++parser->pos;
+		char kind = parser->pos < pattern.len ? pattern.chars[parser->pos] : '\0';
+		if (kind == 'P' && parser->pos + 1 < pattern.len && pattern.chars[parser->pos + 1] == '<') kind = pattern.chars[++parser->pos];
+		if (kind == '=' || kind == '!' || (kind == '<' && parser->pos + 1 < pattern.len && strchr("=!", pattern.chars[parser->pos + 1]))) {
+			return fail(parser, "Lookaround is not supported");
+		}
+		if (kind == '<' || kind == '\'') {
+			// Named groups are numbered like the others, the names aren't kept
+			char end = kind == '<' ? '>' : '\'';
+			size_t name = ++parser->pos;
+			while (parser->pos < pattern.len && is_word(pattern.chars[parser->pos])) ++parser->pos;
+			if (parser->pos == name || parser->pos >= pattern.len || pattern.chars[parser->pos] != end) return fail(parser, "Invalid group name");
+			++parser->pos;
+			group = parser->groups++;
+		} else if (kind == ':') {
+			++parser->pos;
+		} else {
+			if (!parse_options(parser)) return NO_NODE;
+			if (parser->pos < pattern.len && pattern.chars[parser->pos] == ')') {
+				// The options last until the end of the enclosing group
+				++parser->pos;
+				--parser->depth;
+				return add_node(parser, (struct Node){.type = NODE_EMPTY});
+			}
+			if (parser->pos >= pattern.len || pattern.chars[parser->pos] != ':') return fail(parser, "Unknown kind of group");
+			++parser->pos;
+		}
+	} else {
+		group = parser->groups++;
+	}
+	if (group != NO_GROUP && group >= REGEX_MAX_GROUPS) return fail(parser, "Too many groups");
+	
+	uint32_t body = parse_alternation(parser);
+	if (body == NO_NODE) return NO_NODE;
+	if (parser->pos >= pattern.len) return fail(parser, "Missing closing parenthesis");
+	++parser->pos;
+	--parser->depth;
+	parser->fold = fold;
+	parser->multiline = multiline;
+	parser->dotall = dotall;
+	return add_node(parser, (struct Node){.type = NODE_GROUP, .arg = group, .child = body});
+}
+
+/* The opening bracket is already taken */
+static uint32_t parse_class(struct Parser *parser) {
+	struct String pattern = parser->pattern;
+	struct RegexSet set = {{0}};
+	bool negated = parser->pos < pattern.len && pattern.chars[parser->pos] == '^';
+	if (negated) ++parser->pos;
+	
+	static const struct {char *name; char escape; char *chars;} classes[] = {
+		{"alnum", '\0', "0-9A-Za-z"},
+		{"alpha", '\0', "A-Za-z"},
+		{"digit", 'd', NULL},
+		{"lower", '\0', "a-z"},
+		{"space", 's', NULL},
+		{"upper", '\0', "A-Z"},
+		{"word", 'w', NULL},
+		{"xdigit", '\0', "0-9A-Fa-f"},
+	};
+	
+	size_t start = parser->pos;
+	while (true) {
+		if (parser->pos >= pattern.len) return fail(parser, "Missing closing bracket");
+		unsigned char chr = pattern.chars[parser->pos++];
+		if (chr == ']' && parser->pos - 1 > start) break; // A bracket right at the start is a member
+		
+		if (chr == '[' && parser->pos < pattern.len && pattern.chars[parser->pos] == ':') {
+			char *name = pattern.chars + parser->pos + 1;
+			char *end = memchr(name, ':', pattern.chars + pattern.len - name);
+			size_t i = lenof(classes);
+			if (end && end + 1 < pattern.chars + pattern.len && end[1] == ']') {
+				for (i = 0; i < lenof(classes); ++i) {
+					if (strlen(classes[i].name) == (size_t) (end - name) && memcmp(classes[i].name, name, end - name) == 0) break;
+				}
+			}
+			if (i == lenof(classes)) return fail(parser, "Unknown class name");
+			if (classes[i].escape) {
+				struct RegexSet named = {{0}};
+				escape_set(classes[i].escape, &named);
+				set_union(&set, &named);
+			} else {
+				for (char *range = classes[i].chars; *range; range += 3) set_add_range(&set, range[0], range[2], parser->fold);
+			}
+			parser->pos = end + 2 - pattern.chars;
+			continue;
+		}
+		
+		int from = chr;
+		if (chr == '\\') {
+			struct RegexSet escaped = {{0}};
+			from = parse_escape(parser, &escaped, true);
+			if (from == -1) return NO_NODE;
+			if (from == -2) {
+				set_union(&set, &escaped);
+				continue;
+			}
+		}
+		
+		int to = from;
+		if (parser->pos + 1 < pattern.len && pattern.chars[parser->pos] == '-' && pattern.chars[parser->pos + 1] != ']') {
+			to = (unsigned char) pattern.chars[++parser->pos];
+			++parser->pos;
+			if (to == '\\') {
+				struct RegexSet escaped;
+				to = parse_escape(parser, &escaped, true);
+				if (to == -1) return NO_NODE;
+				if (to == -2) return fail(parser, "Invalid range in class");
+			}
+			if (to < from) return fail(parser, "Invalid range in class");
+		}
+		set_add_range(&set, from, to, parser->fold);
+	}
+	
+	if (negated) set_invert(&set);
+	return add_set(parser, &set);
+}
+
+/*
+ * The backslash is already taken. Gives the character which is escaped, -2 for a set of
+ * characters, -3 minus the assertion for an assertion and -1 for an error.
+ */
+static int parse_escape(struct Parser *parser, struct RegexSet *set, bool in_class) {
+	struct String pattern = parser->pattern;
+	if (parser->pos >= pattern.len) {
+		fail(parser, "Pattern ends with a backslash");
+		return -1;
+	}
+	unsigned char chr = pattern.chars[parser->pos++];
+	if (escape_set(chr, set)) return -2;
+	
+	switch (chr) {
+		case 'a': return '\a';
+		case 'e': return 27;
+		case 'f': return '\f';
+		case 'n': return '\n';
+		case 'r': return '\r';
+		case 't': return '\t';
+		case 'v': return '\v';
+		case 'b': return in_class ? '\b' : -3 - RE_WORD_BOUNDARY;
+		case '0':;
+			int octal = 0;
+			for (int digits = 0; digits < 2 && parser->pos < pattern.len && pattern.chars[parser->pos] >= '0' && pattern.chars[parser->pos] <= '7'; ++digits) {
+				octal = octal * 8 + pattern.chars[parser->pos++] - '0';
+			}
+			return octal;
+		case 'x':;
+			bool braced = parser->pos < pattern.len && pattern.chars[parser->pos] == '{';
+			if (braced) ++parser->pos;
+			int value = 0, digits = 0;
+			for (; parser->pos < pattern.len && (braced || digits < 2); ++digits, ++parser->pos) {
+				char digit = pattern.chars[parser->pos];
+				int nibble = digit >= '0' && digit <= '9' ? digit - '0' : (digit | 0x20) >= 'a' && (digit | 0x20) <= 'f' ? (digit | 0x20) - 'a' + 10 : -1;
+				if (nibble < 0) break;
+				value = value * 16 + nibble;
+				if (value > UCHAR_MAX) {
+					fail(parser, "Character code is too large");
+					return -1;
+				}
+			}
+			if (braced) {
+				if (digits == 0 || parser->pos >= pattern.len || pattern.chars[parser->pos] != '}') {
+					fail(parser, "Invalid character code");
+					return -1;
+				}
+				++parser->pos;
+			}
+			return value;
+	}
+	if (!in_class) {
+		switch (chr) {
+			case 'B': return -3 - RE_NOT_WORD_BOUNDARY;
+			case 'A': return -3 - RE_SUBJECT_START;
+			case 'z': return -3 - RE_SUBJECT_END;
+			case 'Z': return -3 - RE_FINAL_END;
+		}
+	}
+	
+	--parser->pos;
+	if (chr >= '1' && chr <= '9') {
+		fail(parser, "Backreferences are not supported");
+		return -1;
+	}
+	if (is_word(chr)) {
+		fail(parser, "Unknown escape");
+		return -1;
+	}
+	++parser->pos;
+	return chr;
+}
+
+/* Letters of the options after the question mark, a hyphen turns the ones after it off */
+static bool parse_options(struct Parser *parser) {
+	bool on = true;
+	for (; parser->pos < parser->pattern.len; ++parser->pos) {
+		switch (parser->pattern.chars[parser->pos]) {
+			case '-':
+				if (!on) {
+					fail(parser, "Unknown kind of group");
+					return false;
+				}
+				on = false;
+				break;
+			case 'i':
+				parser->fold = on;
+				break;
+			case 'm':
+				parser->multiline = on;
+				break;
+			case 's':
+				parser->dotall = on;
+				break;
+			case ')':
+			case ':':
+				return true;
+			default:
+				fail(parser, "Unknown kind of group");
+				return false;
+		}
+	}
+	return true;
+}
+
+static uint32_t parse_quantifier(struct Parser *parser, uint32_t atom) {
+	struct String pattern = parser->pattern;
+	if (parser->pos >= pattern.len) return atom;
+	uint32_t min, max;
+	switch (pattern.chars[parser->pos]) {
+		case '*':
+			min = 0, max = REPEAT_INFINITE;
+			break;
+		case '+':
+			min = 1, max = REPEAT_INFINITE;
+			break;
+		case '?':
+			min = 0, max = 1;
+			break;
+		case '{':;
+			// Braces which aren't a count are taken literally, like in PCRE
+			size_t start = parser->pos++;
+			if (!parse_count(parser, &min)) {
+				parser->pos = start;
+				return atom;
+			}
+			max = min;
+			if (parser->pos < pattern.len && pattern.chars[parser->pos] == ',') {
+				++parser->pos;
+				max = REPEAT_INFINITE;
+				if (parser->pos < pattern.len && pattern.chars[parser->pos] != '}' && !parse_count(parser, &max)) {
+					parser->pos = start;
+					return atom;
+				}
+			}
+			if (parser->pos >= pattern.len || pattern.chars[parser->pos] != '}') {
+				parser->pos = start;
+				return atom;
+			}
+			if (min > REPEAT_MAX || (max != REPEAT_INFINITE && max > REPEAT_MAX)) return fail(parser, "Count of repetition is too large");
+			if (max < min) return fail(parser, "Counts of repetition are out of order");
+			break;
+		default:
+			return atom;
+	}
+	++parser->pos;
+	
+	bool lazy = parser->pos < pattern.len && pattern.chars[parser->pos] == '?';
+	if (lazy) ++parser->pos;
+	if (parser->pos < pattern.len && pattern.chars[parser->pos] == '+') return fail(parser, "Possessive quantifiers are not supported");
+	return add_node(parser, (struct Node){.type = NODE_REPEAT, .flag = lazy, .min = min, .max = max, .child = atom});
+}
+
+static bool parse_count(struct Parser *parser, uint32_t *count) {
+	size_t start = parser->pos;
+	*count = 0;
+	for (; parser->pos < parser->pattern.len && parser->pattern.chars[parser->pos] >= '0' && parser->pattern.chars[parser->pos] <= '9'; ++parser->pos) {
+		if (*count <= REPEAT_MAX) *count = *count * 10 + parser->pattern.chars[parser->pos] - '0';
+	}
+	return parser->pos > start;
+}
+
+static uint32_t char_node(struct Parser *parser, unsigned char chr) {
+	bool fold = parser->fold && (chr | 0x20) >= 'a' && (chr | 0x20) <= 'z';
+	return add_node(parser, (struct Node){.type = NODE_CHAR, .flag = fold, .arg = fold ? chr | 0x20 : chr});
+}
+
+static void set_add(struct RegexSet *set, unsigned char chr, bool fold) {
+	set->bits[chr >> 6] |= UINT64_C(1) << (chr & 63);
+	if (fold && (chr | 0x20) >= 'a' && (chr | 0x20) <= 'z') set_add(set, chr ^ 0x20, false);
+}
+
+static void set_add_range(struct RegexSet *set, unsigned char from, unsigned char to, bool fold) {
+	for (unsigned chr = from; chr <= to; ++chr) set_add(set, chr, fold);
+}
+
+static void set_union(struct RegexSet *set, struct RegexSet *other) {
+	for (size_t i = 0; i < lenof(set->bits); ++i) set->bits[i] |= other->bits[i];
+}
+
+static void set_invert(struct RegexSet *set) {
+	for (size_t i = 0; i < lenof(set->bits); ++i) set->bits[i] = ~set->bits[i];
+}
+
+static bool set_has(struct RegexSet *set, unsigned char chr) {
+	return set->bits[chr >> 6] >> (chr & 63) & 1;
+}
+
+/* Sets of the escapes like \d, false for other characters */
+static bool escape_set(char chr, struct RegexSet *set) {
+	switch (chr | 0x20) {
+		case 'd':
+			set_add_range(set, '0', '9', false);
+			break;
+		case 's':
+			set_add_range(set, '\t', '\r', false);
+			set_add(set, ' ', false);
+			break;
+		case 'w':
+			set_add_range(set, '0', '9', false);
+			set_add_range(set, 'A', 'Z', true);
+			set_add(set, '_', false);
+			break;
+		default:
+			return false;
+	}
+	if (chr >= 'A' && chr <= 'Z') set_invert(set);
+	return true;
+}
+
+static bool build(struct Regex *regex, struct Parser *parser, uint32_t root) {
+	// Loops which can have empty iterations get a slot each, see RE_PROGRESS
+	for (size_t i = 0; i < parser->node_count; ++i) {
+		struct Node *node = &parser->nodes[i];
+		if (node->type != NODE_REPEAT) continue;
+		struct RegexSet unused = {{0}};
+		node->arg = node->max == REPEAT_INFINITE && first_set(parser->nodes, regex->sets, node->child, &unused) ? regex->loops++ : NO_SLOT;
+	}
+	
+	// The whole match is the first pair of captures
+	regex->loop = NO_SLOT;
+	regex->slots = regex->loops + 2 * (regex->groups + 1);
+	if (emit(regex, RE_SAVE, regex->loops, 0) == NO_NODE) return false;
+	if (!emit_node(regex, parser->nodes, root)) return false;
+	if (emit(regex, RE_SAVE, regex->loops + 1, 0) == NO_NODE || emit(regex, RE_MATCH, 0, 0) == NO_NODE) return false;
+	
+	uint32_t child = leading_child(parser->nodes, root);
+	struct Node *first = child == NO_NODE ? NULL : &parser->nodes[child];
+	regex->anchored = first && first->type == NODE_ASSERT && first->arg == RE_SUBJECT_START;
+	regex->skip = !regex->anchored && !first_set(parser->nodes, regex->sets, root, &regex->first);
+	if (regex->skip) find_prefix(regex, parser->nodes, root);
+	if (regex->skip && !regex->prefix.chars && regex->prefix.len) return false;
+	
+	// The threads in a list wait for a character, at most two for each instruction (see add_thread)
+	size_t threads = 0;
+	for (size_t i = 0; i < regex->len; ++i) {
+		enum RegexOp op = regex->code[i].op;
+		if (op != RE_SPLIT && op != RE_JUMP && op != RE_SAVE && op != RE_PROGRESS && op != RE_ASSERT) threads += regex->code[i].loop == NO_SLOT ? 1 : 2;
+	}
+	for (size_t i = 0; i < 2; ++i) {
+		regex->lists[i].pcs = malloc(threads * sizeof *regex->lists[i].pcs);
+		regex->lists[i].caps = malloc(threads * regex->slots * sizeof *regex->lists[i].caps);
+		if (!regex->lists[i].pcs || !regex->lists[i].caps) return false;
+	}
+	regex->marks = calloc(2 * regex->len, sizeof *regex->marks);
+	regex->stack = malloc((4 * regex->len + 1) * sizeof *regex->stack);
+	regex->work = malloc(regex->slots * sizeof *regex->work);
+	find_classes(regex);
+	return regex->marks && regex->stack && regex->work;
+}
+
+/* Index of the instruction, NO_NODE if it doesn't fit */
+static uint32_t emit(struct Regex *regex, enum RegexOp op, uint32_t arg, uint32_t alt) {
+	if (regex->len >= REGEX_MAX_PROGRAM) {
+		regex->too_large = true;
+		return NO_NODE;
+	}
+	struct RegexInstruction *code = grow_array(regex->code, &regex->code_cap, regex->len, sizeof *code);
+	if (!code) return NO_NODE;
+	regex->code = code;
+	regex->code[regex->len] = (struct RegexInstruction){.op = op, .arg = arg, .alt = alt, .loop = regex->loop};
+	return regex->len++;
+}
+
+static bool emit_node(struct Regex *regex, struct Node nodes[], uint32_t index) {
+	struct Node *node = &nodes[index];
+	uint32_t split, jumps = NO_NODE;
+	switch (node->type) {
+		case NODE_EMPTY:
+			return true;
+		case NODE_CHAR:
+			return emit(regex, node->flag ? RE_CHAR_FOLD : RE_CHAR, node->arg, 0) != NO_NODE;
+		case NODE_SET:
+			return emit(regex, RE_SET, node->arg, 0) != NO_NODE;
+		case NODE_ANY:
+			return emit(regex, node->flag ? RE_ANY_NL : RE_ANY, 0, 0) != NO_NODE;
+		case NODE_ASSERT:
+			return emit(regex, RE_ASSERT, node->arg, 0) != NO_NODE;
+		case NODE_GROUP:
+			if (node->arg != NO_GROUP && emit(regex, RE_SAVE, regex->loops + 2 * node->arg + 2, 0) == NO_NODE) return false;
+			if (!emit_node(regex, nodes, node->child)) return false;
+			return node->arg == NO_GROUP || emit(regex, RE_SAVE, regex->loops + 2 * node->arg + 3, 0) != NO_NODE;
+		case NODE_CONCAT:
+			for (uint32_t child = node->child; child != NO_NODE; child = nodes[child].next) {
+				if (!emit_node(regex, nodes, child)) return false;
+			}
+			return true;
+		case NODE_ALTERNATE:
+			// Each alternative but the last is tried first and jumps to the end, the jumps are chained through their arguments
+			for (uint32_t child = node->child; child != NO_NODE; child = nodes[child].next) {
+				if (nodes[child].next == NO_NODE) {
+					if (!emit_node(regex, nodes, child)) return false;
+					break;
+				}
+				if ((split = emit(regex, RE_SPLIT, regex->len + 1, 0)) == NO_NODE || !emit_node(regex, nodes, child)) return false;
+				if ((jumps = emit(regex, RE_JUMP, jumps, 0)) == NO_NODE) return false;
+				regex->code[split].alt = regex->len;
+			}
+			while (jumps != NO_NODE) {
+				uint32_t previous = regex->code[jumps].arg;
+				regex->code[jumps].arg = regex->len;
+				jumps = previous;
+			}
+			return true;
+		case NODE_REPEAT:;
+			// The required copies come first, then a loop or the optional copies which can all skip to the end
+			uint32_t required = node->max == REPEAT_INFINITE && node->min > 0 ? node->min - 1 : node->min;
+			for (uint32_t i = 0; i < required; ++i) {
+				if (!emit_node(regex, nodes, node->child)) return false;
+			}
+			if (node->max == REPEAT_INFINITE) {
+				// Like in PCRE an empty iteration is the last one, the threads of the next would be cut at the loop
+				uint32_t loop = regex->len, progress = NO_NODE;
+				if (node->min == 0 && emit(regex, RE_SPLIT, 0, 0) == NO_NODE) return false;
+				if (node->arg != NO_SLOT && emit(regex, RE_SAVE, node->arg, 0) == NO_NODE) return false;
+				uint32_t outer = regex->loop;
+				if (node->arg != NO_SLOT) regex->loop = node->arg;
+				if (!emit_node(regex, nodes, node->child)) return false;
+				if (node->arg != NO_SLOT && (progress = emit(regex, RE_PROGRESS, node->arg, 0)) == NO_NODE) return false;
+				regex->loop = outer;
+				if (node->min == 0) {
+					if (emit(regex, RE_JUMP, loop, 0) == NO_NODE) return false;
+					regex->code[loop] = (struct RegexInstruction){.op = RE_SPLIT, .arg = loop + 1, .alt = regex->len};
+				} else if (emit(regex, RE_SPLIT, loop, regex->len + 1) == NO_NODE) {
+					return false;
+				}
+				if (progress != NO_NODE) regex->code[progress].alt = regex->len;
+				split = node->min == 0 ? loop : regex->len - 1;
+				if (node->flag) {
+					uint32_t preferred = regex->code[split].arg;
+					regex->code[split].arg = regex->code[split].alt;
+					regex->code[split].alt = preferred;
+				}
+				return true;
+			}
+			for (uint32_t i = node->min; i < node->max; ++i) {
+				if ((split = emit(regex, RE_SPLIT, regex->len + 1, jumps)) == NO_NODE || !emit_node(regex, nodes, node->child)) return false;
+				jumps = split;
+			}
+			while (jumps != NO_NODE) {
+				uint32_t previous = regex->code[jumps].alt;
+				regex->code[jumps].arg = node->flag ? regex->len : jumps + 1;
+				regex->code[jumps].alt = node->flag ? jumps + 1 : regex->len;
+				jumps = previous;
+			}
+			return true;
+	}
+	return false;
+}
+
+/* Adds the characters a match of the node can start with to the set, true if the match can be empty */
+static bool first_set(struct Node nodes[], struct RegexSet sets[], uint32_t index, struct RegexSet *first) {
+	struct Node *node = &nodes[index];
+	bool empty;
+	switch (node->type) {
+		case NODE_CHAR:
+			set_add(first, node->arg, node->flag);
+			return false;
+		case NODE_SET:
+			set_union(first, &sets[node->arg]);
+			return false;
+		case NODE_ANY:
+			for (size_t i = 0; i < lenof(first->bits); ++i) first->bits[i] = UINT64_MAX;
+			return false;
+		case NODE_GROUP:
+			return first_set(nodes, sets, node->child, first);
+		case NODE_CONCAT:
+			for (uint32_t child = node->child; child != NO_NODE; child = nodes[child].next) {
+				if (!first_set(nodes, sets, child, first)) return false;
+			}
+			return true;
+		case NODE_ALTERNATE:
+			empty = false;
+			for (uint32_t child = node->child; child != NO_NODE; child = nodes[child].next) {
+				empty |= first_set(nodes, sets, child, first);
+			}
+			return empty;
+		case NODE_REPEAT:
+			return first_set(nodes, sets, node->child, first) || node->min == 0;
+		default:
+			return true; // Assertions don't take a character
+	}
+}
+
+/* The characters at the start of the pattern, they are searched for as a whole */
+static void find_prefix(struct Regex *regex, struct Node nodes[], uint32_t root) {
+	size_t len = 0;
+	for (uint32_t child = leading_child(nodes, root); child != NO_NODE && nodes[child].type == NODE_CHAR; child = nodes[child].next) ++len;
+	if (len < 2) return; // The set of the first characters does as well
+	
+	regex->prefix.len = len;
+	regex->prefix.chars = malloc(len);
+	if (!regex->prefix.chars) return;
+	len = 0;
+	for (uint32_t child = leading_child(nodes, root); child != NO_NODE && nodes[child].type == NODE_CHAR; child = nodes[child].next) {
+		regex->prefix.chars[len++] = nodes[child].arg;
+		regex->prefix_fold |= nodes[child].flag;
+	}
+}
+
+/* First child of a concatenation which isn't empty, like the ones left by options */
+static uint32_t leading_child(struct Node nodes[], uint32_t root) {
+	if (nodes[root].type != NODE_CONCAT) return NO_NODE;
+	uint32_t child = nodes[root].child;
+	while (child != NO_NODE && nodes[child].type == NODE_EMPTY) child = nodes[child].next;
+	return child;
+}
+
+static void find_classes(struct Regex *regex) {
+	// Every set of characters which an instruction tests splits the classes into the characters in and out of it
+	struct RegexSet classes[UCHAR_MAX + 1], set = {{0}};
+	memset(&classes[0], 0xFF, sizeof classes[0]);
+	size_t count = 1;
+	set_add(&set, '\n', false);
+	refine_classes(classes, &count, &set);
+	for (size_t i = 0; i < regex->len; ++i) {
+		struct RegexInstruction *instruction = &regex->code[i];
+		switch (instruction->op) {
+			case RE_CHAR:
+			case RE_CHAR_FOLD:
+				memset(&set, 0, sizeof set);
+				set_add(&set, instruction->arg, instruction->op == RE_CHAR_FOLD);
+				refine_classes(classes, &count, &set);
+				break;
+			case RE_SET:
+				refine_classes(classes, &count, &regex->sets[instruction->arg]);
+				break;
+			case RE_ASSERT:
+				regex->final_end |= instruction->arg == RE_FINAL_END;
+				regex->context |= instruction->arg != RE_SUBJECT_END && instruction->arg != RE_FINAL_END && instruction->arg != RE_LINE_END;
+				break;
+		}
+	}
+	
+	// The kind of the character before a position is all that the assertions look at
+	if (regex->context) {
+		memset(&set, 0, sizeof set);
+		escape_set('w', &set);
+		refine_classes(classes, &count, &set);
+	}
+	
+	regex->class_count = count;
+	for (size_t i = 0; i < count; ++i) {
+		regex->class_bytes[i] = UCHAR_MAX;
+		for (size_t word = 0; word < lenof(classes[i].bits); ++word) {
+			for (uint64_t bits = classes[i].bits[word]; bits; bits &= bits - 1) {
+				unsigned char chr = 64 * word + __builtin_ctzll(bits);
+				regex->classes[chr] = i;
+				if (chr < regex->class_bytes[i]) regex->class_bytes[i] = chr;
+			}
+		}
+	}
+}
+
+static void refine_classes(struct RegexSet classes[], size_t *count, struct RegexSet *set) {
+	for (size_t i = 0, old = *count; i < old; ++i) {
+		struct RegexSet in, out;
+		uint64_t any_in = 0, any_out = 0;
+		for (size_t word = 0; word < lenof(set->bits); ++word) {
+			any_in |= in.bits[word] = classes[i].bits[word] & set->bits[word];
+			any_out |= out.bits[word] = classes[i].bits[word] & ~set->bits[word];
+		}
+		if (!any_in || !any_out) continue;
+		classes[i] = in;
+		classes[(*count)++] = out;
+	}
+}
+
+/*
+ * Runs the threads of the Pike VM without captures, as a DFA whose states are built as they are
+ * needed. It stops at the first match, which tells that there is one and that the match which
+ * counts starts after the last position where no thread was running.
+ */
+static enum DfaResult dfa_search(struct Regex *regex, struct String subject, size_t start, size_t *from) {
+	*from = start;
+	uint16_t index = dfa_idle(regex, context_of(regex, subject.chars, start));
+	if (index == DFA_UNKNOWN) return DFA_GAVE_UP;
+	struct DfaState *state = regex->states[index - 1];
+	for (size_t pos = start;; ++pos) {
+		if (state->count == 0 && state->starts) {
+			*from = pos;
+			if (regex->skip) {
+				size_t found = skip(regex, subject, pos);
+				if (found == STRING_NOT_FOUND) return DFA_NONE;
+				if (found != pos) {
+					pos = *from = found;
+					if ((index = dfa_idle(regex, context_of(regex, subject.chars, pos))) == DFA_UNKNOWN) return DFA_GAVE_UP;
+					state = regex->states[index - 1];
+				}
+			}
+		}
+		
+		size_t symbol = pos < subject.len ? regex->classes[(unsigned char) subject.chars[pos]] : regex->class_count;
+		uint16_t next = state->next[symbol];
+		if (next == DFA_UNKNOWN && (next = dfa_step(regex, state, symbol)) == DFA_UNKNOWN) return DFA_GAVE_UP;
+		if (next == DFA_MATCH) return DFA_FOUND;
+		if (next == DFA_DEAD) return DFA_NONE;
+		state = regex->states[next - 1];
+	}
+}
+
+/* The threads are followed like in the Pike VM, on a made up subject of the character before, a character of the class and another one */
+static uint16_t dfa_step(struct Regex *regex, struct DfaState *state, size_t symbol) {
+	static const char context_chars[] = {'\0', '\n', 'a', ' '};
+	bool end = symbol == regex->class_count;
+	char around[3];
+	size_t pos = 0, len = 0;
+	if (state->context != CONTEXT_START) around[len++] = context_chars[state->context], ++pos;
+	if (!end) {
+		around[len++] = regex->class_bytes[symbol];
+		around[len++] = ' '; // The character isn't the last one, see RE_FINAL_END
+	}
+	struct String subject = {around, len};
+	
+	struct Threads *list = &regex->lists[0];
+	list->count = 0;
+	next_generation(regex);
+	for (size_t i = 0; i < state->count + state->starts; ++i) {
+		for (size_t slot = 0; slot < regex->loops; ++slot) regex->work[slot] = REGEX_UNSET;
+		add_thread(regex, list, i < state->count ? state->pcs[i] : 0, subject, pos, regex->loops);
+	}
+	
+	uint32_t *pcs = regex->lists[1].pcs;
+	size_t count = 0;
+	next_generation(regex);
+	for (size_t i = 0; i < list->count; ++i) {
+		struct RegexInstruction *instruction = &regex->code[list->pcs[i]];
+		if (instruction->op == RE_MATCH) return state->next[symbol] = DFA_MATCH;
+		if (end || !accepts(regex, instruction, (unsigned char) around[pos])) continue;
+		uint32_t pc = list->pcs[i] + 1;
+		if (regex->marks[2 * pc] == regex->generation) continue;
+		regex->marks[2 * pc] = regex->generation;
+		pcs[count++] = pc;
+	}
+	if (end || (count == 0 && regex->anchored)) return state->next[symbol] = DFA_DEAD;
+	
+	uint16_t next = dfa_state(regex, pcs, count, context_of(regex, around, pos + 1), !regex->anchored);
+	if (next != DFA_UNKNOWN) state->next[symbol] = next;
+	return next;
+}
+
+static uint16_t dfa_idle(struct Regex *regex, enum Context context) {
+	if (regex->idle[context] == DFA_UNKNOWN) regex->idle[context] = dfa_state(regex, NULL, 0, context, true);
+	return regex->idle[context];
+}
+
+/* Index plus one of the state, it is added if there is none like it. DFA_UNKNOWN if there are too many. */
+static uint16_t dfa_state(struct Regex *regex, uint32_t pcs[], size_t count, enum Context context, bool starts) {
+	uint32_t hash = 2166136261u ^ context ^ starts << 2;
+	for (size_t i = 0; i < count; ++i) hash = (hash ^ pcs[i]) * 16777619u;
+	struct DfaState **bucket = &regex->state_buckets[hash % DFA_BUCKETS];
+	for (struct DfaState *state = *bucket; state; state = state->chain) {
+		if (state->hash != hash || state->context != context || state->starts != starts || state->count != count) continue;
+		if (count == 0 || memcmp(state->pcs, pcs, count * sizeof *pcs) == 0) return state->index + 1;
+	}
+	
+	if (regex->state_count >= REGEX_DFA_STATES) {
+		regex->dfa_off = true;
+		return DFA_UNKNOWN;
+	}
+	struct DfaState **states = grow_array(regex->states, &regex->state_cap, regex->state_count, sizeof *states);
+	if (!states) return DFA_UNKNOWN;
+	regex->states = states;
+	size_t size = sizeof(struct DfaState) + count * sizeof *pcs;
+	struct DfaState *state = calloc(1, size + (regex->class_count + 1) * sizeof *state->next);
+	if (!state) return DFA_UNKNOWN;
+	
+	*state = (struct DfaState){.chain = *bucket, .hash = hash, .index = regex->state_count, .context = context, .starts = starts, .count = count};
+	state->next = (uint16_t *) ((char *) state + size);
+	if (count) memcpy(state->pcs, pcs, count * sizeof *pcs);
+	*bucket = state;
+	regex->states[regex->state_count++] = state;
+	return state->index + 1;
+}
+
+static enum Context context_of(struct Regex *regex, char chars[], size_t pos) {
+	if (!regex->context || pos == 0) return CONTEXT_START;
+	unsigned char chr = chars[pos - 1];
+	return chr == '\n' ? CONTEXT_NEWLINE : is_word(chr) ? CONTEXT_WORD : CONTEXT_OTHER;
+}
+
+/* Position from which a match can start, STRING_NOT_FOUND if there is none */
+static size_t skip(struct Regex *regex, struct String subject, size_t pos) {
+	if (regex->prefix.len) return string_find(subject, regex->prefix, pos, !regex->prefix_fold);
+	while (pos < subject.len && !set_has(&regex->first, subject.chars[pos])) ++pos;
+	return pos < subject.len ? pos : STRING_NOT_FOUND;
+}
+
+/* Follows the jumps, splits, saves and assertions from the instruction and adds the threads they lead to */
+static void add_thread(struct Regex *regex, struct Threads *list, uint32_t pc, struct String subject, size_t pos, size_t slots) {
+	size_t *work = regex->work;
+	size_t top = 0;
+	regex->stack[top++] = (struct Frame){.pc = pc, .slot = NO_SLOT};
+	while (top) {
+		struct Frame frame = regex->stack[--top];
+		if (frame.slot != NO_SLOT) {
+			work[frame.slot] = frame.old;
+			continue;
+		}
+		// Instructions are followed once per position, and once more in an iteration of their loop which is still empty
+		struct RegexInstruction *instruction = &regex->code[frame.pc];
+		size_t mark = 2 * frame.pc + (instruction->loop != NO_SLOT && work[instruction->loop] == pos);
+		if (regex->marks[mark] == regex->generation) continue;
+		regex->marks[mark] = regex->generation;
+		switch (instruction->op) {
+			case RE_JUMP:
+				regex->stack[top++] = (struct Frame){.pc = instruction->arg, .slot = NO_SLOT};
+				break;
+			case RE_SPLIT:
+				regex->stack[top++] = (struct Frame){.pc = instruction->alt, .slot = NO_SLOT};
+				regex->stack[top++] = (struct Frame){.pc = instruction->arg, .slot = NO_SLOT};
+				break;
+			case RE_SAVE:
+				if (instruction->arg < slots) {
+					regex->stack[top++] = (struct Frame){.slot = instruction->arg, .old = work[instruction->arg]};
+					work[instruction->arg] = pos;
+				}
+				regex->stack[top++] = (struct Frame){.pc = frame.pc + 1, .slot = NO_SLOT};
+				break;
+			case RE_PROGRESS:
+				regex->stack[top++] = (struct Frame){.pc = work[instruction->arg] == pos ? instruction->alt : frame.pc + 1, .slot = NO_SLOT};
+				break;
+			case RE_ASSERT:
+				if (asserts(instruction->arg, subject, pos)) regex->stack[top++] = (struct Frame){.pc = frame.pc + 1, .slot = NO_SLOT};
+				break;
+			default:
+				list->pcs[list->count] = frame.pc;
+				copy_slots(&list->caps[list->count++ * slots], work, slots);
+		}
+	}
+}
+
+static bool asserts(enum RegexAssertion assertion, struct String subject, size_t pos) {
+	switch (assertion) {
+		case RE_SUBJECT_START:
+			return pos == 0;
+		case RE_SUBJECT_END:
+			return pos == subject.len;
+		case RE_FINAL_END:
+			return pos == subject.len || (pos + 1 == subject.len && subject.chars[pos] == '\n');
+		case RE_LINE_START:
+			return pos == 0 || subject.chars[pos - 1] == '\n';
+		case RE_LINE_END:
+			return pos == subject.len || subject.chars[pos] == '\n';
+		case RE_WORD_BOUNDARY:
+		case RE_NOT_WORD_BOUNDARY:;
+			bool boundary = (pos > 0 && is_word(subject.chars[pos - 1])) != (pos < subject.len && is_word(subject.chars[pos]));
+			return boundary == (assertion == RE_WORD_BOUNDARY);
+	}
+	return false;
+}
+
+/* There are only a few slots, a loop beats a call to memcpy */
+static void copy_slots(size_t *dest, size_t *src, size_t slots) {
+	for (size_t i = 0; i < slots; ++i) dest[i] = src[i];
+}
+
+static bool is_word(unsigned char chr) {
+	return (chr >= '0' && chr <= '9') || ((chr | 0x20) >= 'a' && (chr | 0x20) <= 'z') || chr == '_';
+}
+
+static void next_generation(struct Regex *regex) {
+	if (++regex->generation) return;
+	memset(regex->marks, 0, 2 * regex->len * sizeof *regex->marks);
+	regex->generation = 1;
+}
+
+static uint32_t pattern_hash(struct String pattern) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < pattern.len; ++i) {
+		hash ^= (unsigned char) pattern.chars[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void cache_unlink(struct CacheEntry *entry) {
+	if (entry->newer) {
+		entry->newer->older = entry->older;
+	} else {
+		newest = entry->older;
+	}
+	if (entry->older) {
+		entry->older->newer = entry->newer;
+	} else {
+		oldest = entry->newer;
+	}
+	entry->newer = entry->older = NULL;
+}
@@ -0,0 +1,77 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_REGEX_H
+#define RUNTIME_REGEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "runtime/string.h"
+
+#ifndef REGEX_CACHE_SIZE
+#define REGEX_CACHE_SIZE 32 // Compiled patterns kept for the patterns which aren't literals
+#endif
+
+#ifndef REGEX_MAX_GROUPS
+#define REGEX_MAX_GROUPS 32
+#endif
+
+#ifndef REGEX_DFA_STATES
+#define REGEX_DFA_STATES 1024 // Past them a pattern is only matched by the Pike VM
+#endif
+
+#ifndef REGEX_MAX_PROGRAM
+#define REGEX_MAX_PROGRAM 8192 // Instructions, the counted repetitions are expanded
+#endif
+
+#define REGEX_UNSET SIZE_MAX
+
+/*
+ * Regular expressions in a subset of the PCRE syntax: literals and escapes, classes, the dot,
+ * groups (capturing, named and not capturing), alternation, greedy and lazy quantifiers,
+ * anchors, word boundaries and the i, m and s options. There are no backreferences or lookaround.
+ *
+ * A pattern is compiled to a program for a Pike VM, which runs all the threads of the NFA in step
+ * so the time of a match is linear in the subject. Matches are leftmost-first like in PCRE. The
+ * subject is first scanned by a lazy DFA made of the same threads without their captures, which
+ * finds out whether there is a match and from where the Pike VM has to run for the captures.
+ * Until a thread is running the subject is skipped with the literal prefix of the pattern (found
+ * with string_find) or the set of characters a match can start with.
+ *
+ * Patterns which are literals are compiled along with the call, see runtime/builtins.h. Others
+ * go through a cache of the last REGEX_CACHE_SIZE patterns which were used, so a pattern in a
+ * loop is compiled once either way.
+ */
+struct Regex;
+
+struct RegexError {
+	char *msg;
+	size_t offset; // In the pattern
+};
+
+/* NULL on error, the message is only set for invalid patterns and not when out of memory */
+struct Regex *regex_compile(struct String pattern, struct RegexError *error);
+/* Same, but the compiled pattern belongs to the cache and is only valid until the next call */
+struct Regex *regex_cached(struct String pattern, struct RegexError *error);
+size_t regex_groups(struct Regex *regex);
+/* The captures are the start and end of the match and of each group, REGEX_UNSET for groups which didn't take part */
+bool regex_match(struct Regex *regex, struct String subject, size_t start, size_t captures[]);
+void regex_free(struct Regex *regex);
+
+#endif
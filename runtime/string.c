@@ -0,0 +1,208 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "runtime/heap.h"
+#include "runtime/string.h"
+#include "runtime/value.h"
+
+#if !defined(STRING_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+typedef __m256i Vector;
+#define VECTOR_SIZE 32
+#define VECTOR_FULL 0xFFFFFFFFu // Mask of a comparison which is true for every character
+#define VECTOR_LOAD(p) _mm256_loadu_si256((const __m256i *) (p))
+#define VECTOR_STORE(p, v) _mm256_storeu_si256((__m256i *) (p), v)
+#define VECTOR_SPLAT(c) _mm256_set1_epi8(c)
+#define VECTOR_EQ(a, b) _mm256_cmpeq_epi8(a, b)
+#define VECTOR_GT(a, b) _mm256_cmpgt_epi8(a, b)
+#define VECTOR_ADD(a, b) _mm256_add_epi8(a, b)
+#define VECTOR_AND(a, b) _mm256_and_si256(a, b)
+#define VECTOR_MASK(v) ((uint32_t) _mm256_movemask_epi8(v))
+#elif !defined(STRING_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128i Vector;
+#define VECTOR_SIZE 16
+#define VECTOR_FULL 0xFFFFu
+#define VECTOR_LOAD(p) _mm_loadu_si128((const __m128i *) (p))
+#define VECTOR_STORE(p, v) _mm_storeu_si128((__m128i *) (p), v)
+#define VECTOR_SPLAT(c) _mm_set1_epi8(c)
+#define VECTOR_EQ(a, b) _mm_cmpeq_epi8(a, b)
+#define VECTOR_GT(a, b) _mm_cmpgt_epi8(a, b)
+#define VECTOR_ADD(a, b) _mm_add_epi8(a, b)
+#define VECTOR_AND(a, b) _mm_and_si128(a, b)
+#define VECTOR_MASK(v) ((uint32_t) _mm_movemask_epi8(v))
+#endif
+
+static unsigned char fold(unsigned char chr);
+static uint64_t fold_word(uint64_t word);
+static int compare_folded(unsigned char *a, unsigned char *b, size_t len);
+static bool matches(unsigned char *chars, unsigned char *pattern, size_t len, bool case_sensitive);
+static void shift_letters(char *dest, char *src, size_t len, char first, char diff);
+
+#ifdef VECTOR_SIZE
+/* Adds the difference to the 26 characters from the first one onwards, the rest stays as it is */
+static inline Vector shift_range(Vector chars, char first, char diff) {
+	// The range is moved to the bottom of the signed bytes, so that one comparison finds it
+	Vector moved = VECTOR_ADD(chars, VECTOR_SPLAT((char) (-128 - first)));
+	Vector in_range = VECTOR_GT(VECTOR_SPLAT(-128 + 26), moved);
+	return VECTOR_ADD(chars, VECTOR_AND(in_range, VECTOR_SPLAT(diff)));
+}
+
+#define VECTOR_FOLD(v) shift_range(v, 'A', 'a' - 'A')
+#endif
+
+struct String string_of(struct Value *value, char buffer[VALUE_STRING_BUFFER_SIZE]) {
+	if (value->type == VAL_STRING && value->counted) return (struct String){.chars = value->string, .len = heap_string_len(value->string)};
+	char *chars = value_to_string(value, buffer);
+	return (struct String){.chars = chars, .len = strlen(chars)};
+}
+
+/* Index of the first occurrence at or after the start, STRING_NOT_FOUND if there is none */
+size_t string_find(struct String haystack, struct String needle, size_t start, bool case_sensitive) {
+	if (start > haystack.len || needle.len > haystack.len - start) return STRING_NOT_FOUND;
+	if (needle.len == 0) return start;
+	
+	unsigned char *chars = (unsigned char *) haystack.chars;
+	unsigned char *pattern = (unsigned char *) needle.chars;
+	unsigned char first = case_sensitive ? pattern[0] : fold(pattern[0]);
+	size_t last = haystack.len - needle.len; // Last index at which the needle fits
+	size_t i = start;
+	
+#ifdef VECTOR_SIZE
+	// Candidates are the indices where both the first and the last character of the needle match
+	Vector firsts = VECTOR_SPLAT(first);
+	Vector lasts = VECTOR_SPLAT(case_sensitive ? pattern[needle.len - 1] : fold(pattern[needle.len - 1]));
+	for (; i <= last && last - i >= VECTOR_SIZE - 1; i += VECTOR_SIZE) {
+		Vector heads = VECTOR_LOAD(chars + i);
+		Vector tails = VECTOR_LOAD(chars + i + needle.len - 1);
+		if (!case_sensitive) {
+			heads = VECTOR_FOLD(heads);
+			tails = VECTOR_FOLD(tails);
+		}
+		uint32_t candidates = VECTOR_MASK(VECTOR_AND(VECTOR_EQ(heads, firsts), VECTOR_EQ(tails, lasts)));
+		for (; candidates; candidates &= candidates - 1) {
+			size_t at = i + __builtin_ctz(candidates);
+			if (matches(chars + at, pattern, needle.len, case_sensitive)) return at;
+		}
+	}
+#endif
+	
+	for (; i <= last; ++i) {
+		if ((case_sensitive ? chars[i] : fold(chars[i])) == first && matches(chars + i, pattern, needle.len, case_sensitive)) return i;
+	}
+	return STRING_NOT_FOUND;
+}
+
+/* Same sign as strcmp or strcasecmp */
+int string_compare(struct String a, struct String b, bool case_sensitive) {
+	size_t len = a.len < b.len ? a.len : b.len;
+	int diff = case_sensitive ? memcmp(a.chars, b.chars, len) : compare_folded((unsigned char *) a.chars, (unsigned char *) b.chars, len);
+	if (diff) return diff;
+	return (a.len > b.len) - (a.len < b.len);
+}
+
+/* Strings of different lengths are never equal, even when the case doesn't matter */
+bool string_equal(struct String a, struct String b, bool case_sensitive) {
+	if (a.len != b.len) return false;
+	return (case_sensitive ? memcmp(a.chars, b.chars, a.len) : compare_folded((unsigned char *) a.chars, (unsigned char *) b.chars, a.len)) == 0;
+}
+
+/* The destination may be the source */
+void string_upper(char *dest, char *src, size_t len) {
+	shift_letters(dest, src, len, 'a', 'A' - 'a');
+}
+
+void string_lower(char *dest, char *src, size_t len) {
+	shift_letters(dest, src, len, 'A', 'a' - 'A');
+}
+
+static unsigned char fold(unsigned char chr) {
+	// Without a branch, letters of both cases are mixed in the strings which are compared
+	return chr + (((unsigned char) (chr - 'A') < 26) << 5);
+}
+
+/* Folds the eight characters in the word at once */
+static uint64_t fold_word(uint64_t word) {
+	const uint64_t ones = 0x0101010101010101u, high = ones * 0x80;
+	// The low seven bits of each character can't carry into the next one, the high bit tells if it reached the bound
+	uint64_t low = word & ~high;
+	uint64_t from_a = low + ones * (0x80 - 'A');
+	uint64_t past_z = low + ones * (0x80 - 'Z' - 1);
+	uint64_t letters = from_a & ~past_z & ~word & high;
+	return word | letters >> 2;
+}
+
+static int compare_folded(unsigned char *a, unsigned char *b, size_t len) {
+	// The last block overlaps the one before it instead of leaving characters for a slow loop
+	size_t i = 0;
+#ifdef VECTOR_SIZE
+	if (len >= VECTOR_SIZE) {
+		for (;; i += VECTOR_SIZE) {
+			if (i > len - VECTOR_SIZE) i = len - VECTOR_SIZE;
+			uint32_t equal = VECTOR_MASK(VECTOR_EQ(VECTOR_FOLD(VECTOR_LOAD(a + i)), VECTOR_FOLD(VECTOR_LOAD(b + i))));
+			if (equal != VECTOR_FULL) {
+				i += __builtin_ctz(~equal);
+				return fold(a[i]) - fold(b[i]);
+			}
+			if (i + VECTOR_SIZE == len) return 0;
+		}
+	}
+#endif
+	// Shorter strings go a word at a time, the characters of the word which differs are compared one by one
+	if (len >= sizeof(uint64_t)) {
+		for (;; i += sizeof(uint64_t)) {
+			if (i > len - sizeof(uint64_t)) i = len - sizeof(uint64_t);
+			uint64_t word_a, word_b;
+			memcpy(&word_a, a + i, sizeof word_a);
+			memcpy(&word_b, b + i, sizeof word_b);
+			if (fold_word(word_a) != fold_word(word_b)) break;
+			if (i + sizeof(uint64_t) == len) return 0;
+		}
+		len = i + sizeof(uint64_t);
+	} else if (len >= sizeof(uint32_t)) {
+		// Two halves which overlap make up a word
+		uint32_t halves[4];
+		memcpy(&halves[0], a, sizeof *halves);
+		memcpy(&halves[1], a + len - sizeof *halves, sizeof *halves);
+		memcpy(&halves[2], b, sizeof *halves);
+		memcpy(&halves[3], b + len - sizeof *halves, sizeof *halves);
+		if (fold_word(halves[0] | (uint64_t) halves[1] << 32) == fold_word(halves[2] | (uint64_t) halves[3] << 32)) return 0;
+	}
+	for (; i < len; ++i) {
+		int diff = fold(a[i]) - fold(b[i]);
+		if (diff) return diff;
+	}
+	return 0;
+}
+
+static bool matches(unsigned char *chars, unsigned char *pattern, size_t len, bool case_sensitive) {
+	return (case_sensitive ? memcmp(chars, pattern, len) : compare_folded(chars, pattern, len)) == 0;
+}
+
+static void shift_letters(char *dest, char *src, size_t len, char first, char diff) {
+	size_t i = 0;
+#ifdef VECTOR_SIZE
+	for (; i + VECTOR_SIZE <= len; i += VECTOR_SIZE) VECTOR_STORE(dest + i, shift_range(VECTOR_LOAD(src + i), first, diff));
+#endif
+	for (; i < len; ++i) dest[i] = (unsigned char) (src[i] - first) < 26 ? src[i] + diff : src[i];
+}
@@ -0,0 +1,49 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_STRING_H
+#define RUNTIME_STRING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "runtime/value.h"
+
+#define STRING_NOT_FOUND SIZE_MAX
+
+/*
+ * String library of the runtime. The kernels work on whole vectors of characters with AVX2
+ * or SSE2, whichever the compiler targets, and fall back to plain loops on other platforms
+ * or with the STRING_SCALAR definition. Case-insensitive operations fold ASCII letters only,
+ * like strcasecmp in the C locale.
+ */
+struct String {
+	char *chars;
+	size_t len;
+};
+
+/* The string of any value, the buffer is used for numbers. Strings on the heap know their length. */
+struct String string_of(struct Value *value, char buffer[VALUE_STRING_BUFFER_SIZE]);
+size_t string_find(struct String haystack, struct String needle, size_t start, bool case_sensitive);
+int string_compare(struct String a, struct String b, bool case_sensitive);
+bool string_equal(struct String a, struct String b, bool case_sensitive);
+void string_upper(char *dest, char *src, size_t len);
+void string_lower(char *dest, char *src, size_t len);
+
+#endif
@@ -0,0 +1,107 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "runtime/string.h"
+#include "runtime/value.h"
+
+struct Value value_from_integer(int64_t integer, bool is_int64) {
+	// An Int64 stays one, but an Int32 which doesn't fit any more is widened
+	if (is_int64 || integer < INT32_MIN || integer > INT32_MAX) return (struct Value){.type = VAL_INT64, .integer = integer};
+	return (struct Value){.type = VAL_INT32, .integer = integer};
+}
+
+double value_to_number(struct Value *value) {
+	switch (value->type) {
+		case VAL_NUMBER:
+			return value->number;
+		case VAL_INT32:
+		case VAL_INT64:
+			return value->integer;
+		case VAL_STRING:
+			return strtod(value->string, NULL);
+		case VAL_BOOLEAN:
+			return value->boolean;
+		default:
+			return 0;
+	}
+}
+
+char *value_to_string(struct Value *value, char buffer[VALUE_STRING_BUFFER_SIZE]) {
+	switch (value->type) {
+		case VAL_NUMBER:
+			snprintf(buffer, VALUE_STRING_BUFFER_SIZE, "%.15g", value->number);
+			return buffer;
+		case VAL_INT32:
+		case VAL_INT64:
+			snprintf(buffer, VALUE_STRING_BUFFER_SIZE, "%" PRId64, value->integer);
+			return buffer;
+		case VAL_STRING:
+			return value->string;
+		case VAL_BOOLEAN:
+			return value->boolean ? "True" : "False";
+		default:
+			return "";
+	}
+}
+
+bool value_truthy(struct Value *value) {
+	switch (value->type) {
+		case VAL_NUMBER:
+			return value->number != 0;
+		case VAL_INT32:
+		case VAL_INT64:
+			return value->integer != 0;
+		case VAL_STRING:
+			return value->string[0] != '\0';
+		case VAL_BOOLEAN:
+			return value->boolean;
+		default:
+			return false;
+	}
+}
+
+int value_compare(struct Value *a, struct Value *b, bool case_sensitive) {
+	// Strings are only compared as strings when both sides are strings
+	if (a->type == VAL_STRING && b->type == VAL_STRING) {
+		return case_sensitive ? strcmp(a->string, b->string) : strcasecmp(a->string, b->string);
+	}
+	// Integers above 2^53 can't be compared as doubles
+	if (VALUE_IS_INTEGER(a) && VALUE_IS_INTEGER(b)) return (a->integer > b->integer) - (a->integer < b->integer);
+	double x = value_to_number(a);
+	double y = value_to_number(b);
+	return (x > y) - (x < y);
+}
+
+/* Same as a comparison which gives zero, but strings only have to be compared when they are as long */
+bool value_equal(struct Value *a, struct Value *b, bool case_sensitive) {
+	if (a->type == VAL_STRING && b->type == VAL_STRING) {
+		// The lengths of strings which aren't on the heap would take a pass of their own
+		if (!a->counted || !b->counted) return value_compare(a, b, case_sensitive) == 0;
+		char buffer[VALUE_STRING_BUFFER_SIZE]; // Not used by strings
+		return string_equal(string_of(a, buffer), string_of(b, buffer), case_sensitive);
+	}
+	return value_compare(a, b, case_sensitive) == 0;
+}
@@ -0,0 +1,62 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_VALUE_H
+#define RUNTIME_VALUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VALUE_STRING_BUFFER_SIZE 32
+
+struct Array;
+struct Map;
+
+struct Value {
+	enum ValueType {
+		VAL_EMPTY, // Uninitialized variables and array elements
+		VAL_NUMBER,
+		VAL_STRING,
+		VAL_BOOLEAN,
+		VAL_ARRAY,
+		VAL_MAP,
+		VAL_INT32,
+		VAL_INT64,
+	} type;
+	bool counted; // The string, array or map is on the runtime heap, see runtime/heap.h
+	union {
+		double number;
+		int64_t integer; // Int32 and Int64
+		char *string;
+		bool boolean;
+		struct Array *array;
+		struct Map *map;
+	};
+};
+
+#define VALUE_IS_INTEGER(value) ((value)->type == VAL_INT32 || (value)->type == VAL_INT64)
+
+struct Value value_from_integer(int64_t integer, bool is_int64);
+double value_to_number(struct Value *value);
+char *value_to_string(struct Value *value, char buffer[VALUE_STRING_BUFFER_SIZE]);
+bool value_truthy(struct Value *value);
+int value_compare(struct Value *a, struct Value *b, bool case_sensitive);
+bool value_equal(struct Value *a, struct Value *b, bool case_sensitive);
+
+#endif
@@ -0,0 +1,411 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cease/cease.h"
+#include "runtime/array.h"
+#include "runtime/bytecode.h"
+#include "runtime/heap.h"
+#include "runtime/jit.h"
+#include "runtime/map.h"
+#include "runtime/string.h"
+#include "runtime/value.h"
+#include "runtime/vm.h"
+
+static char *err_subscript = "Array variable has incorrect number of subscripts or subscript dimension range exceeded";
+
+static struct Value *access_member(struct AccessCache *cache, struct Map *map);
+static struct Value *access_index(struct VM *vm, struct Value *container, struct Value subscripts[], unsigned char count);
+static void assign_index(struct VM *vm, struct Value *container, struct Value subscripts[], unsigned char count, struct Value value);
+static void to_indices(struct VM *vm, struct Value values[], unsigned char count, size_t indices[]);
+static struct Value concat(struct VM *vm, struct Value *a, struct Value *b);
+static void store_counter(struct Value *variable, struct Value counter);
+static uint64_t trip_count(uint64_t span, uint64_t step);
+
+struct Value vm_run(struct VM *vm, struct Chunk *chunk, struct Value *locals) {
+	if (chunk->max_stack > VM_STACK_SIZE - vm->depth) cease(vm->point, "Expression is too complex to evaluate", false);
+	
+	struct Instruction *ip = chunk->code;
+	struct Value *sp = vm->stack + vm->depth; // Points to the next free entry
+	struct Value *globals = vm->globals;
+	struct Value *constants = chunk->constants;
+	struct JitResume resume;
+	
+	#define NUMBER(x) ((struct Value){.type = VAL_NUMBER, .number = (x)})
+	#define BOOLEAN(x) ((struct Value){.type = VAL_BOOLEAN, .boolean = (x)})
+	#define ARITHMETIC(expr) {double a = value_to_number(&sp[-2]), b = value_to_number(&sp[-1]); --sp; sp[-1] = NUMBER(expr); break;}
+	/* Integers stay integers until the result overflows, then the operation is repeated with doubles */
+	#define INTEGER_ARITHMETIC(overflows, expr) { \
+		int64_t result; \
+		if (VALUE_IS_INTEGER(&sp[-2]) && VALUE_IS_INTEGER(&sp[-1]) && !overflows(sp[-2].integer, sp[-1].integer, &result)) { \
+			sp[-2] = value_from_integer(result, sp[-2].type == VAL_INT64 || sp[-1].type == VAL_INT64); \
+			--sp; \
+			break; \
+		} \
+	} ARITHMETIC(expr)
+	#define COMPARISON(expr, case_sensitive) {int c = value_compare(&sp[-2], &sp[-1], case_sensitive); --sp; sp[-1] = BOOLEAN(expr); break;}
+	#define EQUALITY(expr, case_sensitive) {bool equal = value_equal(&sp[-2], &sp[-1], case_sensitive); --sp; sp[-1] = BOOLEAN(expr); break;}
+	/* Only the instructions which allocate or drop references check if the heap should be collected */
+	#define SAFE_POINT() if (heap_collect_due() && !heap_collect(vm->stack, sp - vm->stack, false)) cease_mem(vm->point, "collecting garbage")
+	/* Runs and backward jumps heat up the chunk, once it is compiled the machine code takes over from the target */
+	#define HEAT_UP(target) if (vm->jit) { \
+		if (!chunk->jit && ++chunk->heat == JIT_THRESHOLD) chunk->jit = jit_compile(chunk); \
+		if (chunk->jit) { \
+			resume = jit_run(chunk, sp, locals, globals, target); \
+			sp = resume.sp; \
+			ip = chunk->code + resume.index - 1; \
+			break; \
+		} \
+	}
+	
+	if (vm->jit) {
+		if (!chunk->jit && ++chunk->heat == JIT_THRESHOLD) chunk->jit = jit_compile(chunk);
+		if (chunk->jit) {
+			resume = jit_run(chunk, sp, locals, globals, 0);
+			sp = resume.sp;
+			ip = chunk->code + resume.index;
+		}
+	}
+	
+	for (;; ++ip) switch (ip->op) {
+		case INS_NOP:
+			break;
+		case INS_CONST:
+			*sp++ = constants[ip->arg];
+			break;
+		case INS_POP:
+			--sp;
+			break;
+		case INS_LOAD_LOCAL:
+			*sp++ = locals[ip->arg];
+			break;
+		case INS_LOAD_GLOBAL:
+			*sp++ = globals[ip->arg];
+			break;
+		case INS_STORE_LOCAL:
+			heap_assign(&locals[ip->arg], sp[-1]);
+			SAFE_POINT();
+			break;
+		case INS_STORE_GLOBAL:
+			heap_assign(&globals[ip->arg], sp[-1]);
+			SAFE_POINT();
+			break;
+		case INS_LOAD_LOCAL_PAIR:
+			sp[0] = locals[ip->arg & UINT16_MAX];
+			sp[1] = locals[ip->arg >> 16];
+			sp += 2;
+			break;
+		case INS_LOAD_GLOBAL_PAIR:
+			sp[0] = globals[ip->arg & UINT16_MAX];
+			sp[1] = globals[ip->arg >> 16];
+			sp += 2;
+			break;
+		case INS_LOAD_LOCAL_INDEX:
+		case INS_LOAD_GLOBAL_INDEX:;
+			// The loaded subscript is pushed after the others, then it is the same as an index
+			uint32_t slot = ip->arg & ((UINT32_C(1) << INDEX_SLOT_BITS) - 1);
+			*sp++ = ip->op == INS_LOAD_LOCAL_INDEX ? locals[slot] : globals[slot];
+			unsigned char count = ip->arg >> INDEX_SLOT_BITS;
+			sp -= count;
+			sp[-1] = *access_index(vm, &sp[-1], sp, count);
+			break;
+		case INS_STORE_LOCAL_POP:
+			heap_assign(&locals[ip->arg], sp[-1]);
+			--sp;
+			SAFE_POINT();
+			break;
+		case INS_STORE_GLOBAL_POP:
+			heap_assign(&globals[ip->arg], sp[-1]);
+			--sp;
+			SAFE_POINT();
+			break;
+		case INS_INV:
+			if (VALUE_IS_INTEGER(&sp[-1]) && sp[-1].integer != INT64_MIN) {
+				sp[-1] = value_from_integer(-sp[-1].integer, sp[-1].type == VAL_INT64);
+				break;
+			}
+			sp[-1] = NUMBER(-value_to_number(&sp[-1]));
+			break;
+		case INS_ADD_CONST:
+			*sp++ = constants[ip->arg];
+			// fallthrough
+		case INS_ADD: INTEGER_ARITHMETIC(__builtin_add_overflow, a + b)
+		case INS_SUB_CONST:
+			*sp++ = constants[ip->arg];
+			// fallthrough
+		case INS_SUB: INTEGER_ARITHMETIC(__builtin_sub_overflow, a - b)
+		case INS_MUL: INTEGER_ARITHMETIC(__builtin_mul_overflow, a * b)
+		case INS_DIV: ARITHMETIC(a / b)
+		case INS_EXP: ARITHMETIC(pow(a, b))
+		case INS_CAT:
+			sp[-2] = concat(vm, &sp[-2], &sp[-1]);
+			--sp;
+			SAFE_POINT();
+			break;
+		case INS_NOT:
+			sp[-1] = BOOLEAN(!value_truthy(&sp[-1]));
+			break;
+		case INS_TRUTH:
+			sp[-1] = BOOLEAN(value_truthy(&sp[-1]));
+			break;
+		case INS_EQU: EQUALITY(equal, false)
+		case INS_SEQU: EQUALITY(equal, true)
+		case INS_NEQ: EQUALITY(!equal, false)
+		case INS_LT: COMPARISON(c < 0, false)
+		case INS_LTE: COMPARISON(c <= 0, false)
+		case INS_GT: COMPARISON(c > 0, false)
+		case INS_GTE: COMPARISON(c >= 0, false)
+		case INS_JUMP:
+			if (ip->arg <= ip - chunk->code) HEAT_UP(ip->arg);
+			ip = chunk->code + ip->arg - 1;
+			break;
+		case INS_JUMP_FALSE:
+			if (!value_truthy(--sp)) ip = chunk->code + ip->arg - 1;
+			break;
+		case INS_JUMP_FALSE_KEEP:
+			if (!value_truthy(&sp[-1])) ip = chunk->code + ip->arg - 1; else --sp;
+			break;
+		case INS_JUMP_TRUE_KEEP:
+			if (value_truthy(&sp[-1])) ip = chunk->code + ip->arg - 1; else --sp;
+			break;
+		case INS_FOR_PREP:;
+			struct Value *state = sp - 3;
+			if (VALUE_IS_INTEGER(&state[0]) && VALUE_IS_INTEGER(&state[1]) && VALUE_IS_INTEGER(&state[2])) {
+				/* Integer loops count down the number of iterations, so the direction of the step only matters here */
+				int64_t start = state[0].integer, stop = state[1].integer, step = state[2].integer;
+				bool is_int64 = state[0].type == VAL_INT64 || state[1].type == VAL_INT64 || state[2].type == VAL_INT64;
+				uint64_t iterations;
+				if (step > 0) {
+					iterations = stop < start ? 0 : trip_count((uint64_t) stop - (uint64_t) start, (uint64_t) step);
+				} else if (step < 0) {
+					iterations = start < stop ? 0 : trip_count((uint64_t) start - (uint64_t) stop, 0 - (uint64_t) step);
+				} else {
+					iterations = start <= stop ? UINT64_MAX : 0;
+				}
+				state[0] = value_from_integer(start, is_int64);
+				state[1] = (struct Value){.type = VAL_INT64, .integer = step};
+				state[2] = (struct Value){.type = VAL_INT64, .integer = (int64_t) iterations};
+				store_counter(ip[1].op == INS_STORE_LOCAL ? &locals[ip[1].arg] : &globals[ip[1].arg], state[0]);
+				if (iterations) ++ip; else ip = chunk->code + ip->arg - 1;
+			} else {
+				/* The sign of the step decides the direction, (stop - counter) * step is negative past the end either way */
+				double start = value_to_number(&state[0]), stop = value_to_number(&state[1]), step = value_to_number(&state[2]);
+				state[0] = NUMBER(start);
+				state[1] = NUMBER(step);
+				state[2] = NUMBER(stop);
+				store_counter(ip[1].op == INS_STORE_LOCAL ? &locals[ip[1].arg] : &globals[ip[1].arg], state[0]);
+				if ((stop - start) * step >= 0) ++ip; else ip = chunk->code + ip->arg - 1;
+			}
+			break;
+		case INS_FOR_NEXT:
+			state = sp - 3;
+			if (state[0].type == VAL_NUMBER) {
+				state[0].number += state[1].number;
+				store_counter(ip[1].op == INS_STORE_LOCAL ? &locals[ip[1].arg] : &globals[ip[1].arg], state[0]);
+				if (!((state[2].number - state[0].number) * state[1].number >= 0)) {
+					++ip;
+					break;
+				}
+			} else {
+				/* The counter can only leave the range of its type after the last iteration, an Int32 is widened and an Int64 becomes a Double */
+				int64_t counter;
+				if (__builtin_add_overflow(state[0].integer, state[1].integer, &counter)) {
+					state[0] = NUMBER((double) state[0].integer + (double) state[1].integer);
+				} else {
+					state[0] = value_from_integer(counter, state[0].type == VAL_INT64);
+				}
+				store_counter(ip[1].op == INS_STORE_LOCAL ? &locals[ip[1].arg] : &globals[ip[1].arg], state[0]);
+				state[2].integer = (int64_t) ((uint64_t) state[2].integer - 1);
+				if (!state[2].integer) {
+					++ip;
+					break;
+				}
+			}
+			HEAT_UP(ip->arg);
+			ip = chunk->code + ip->arg - 1;
+			break;
+		case INS_INDEX:
+			count = ip->arg;
+			sp -= count;
+			sp[-1] = *access_index(vm, &sp[-1], sp, count);
+			break;
+		case INS_SET_INDEX:
+			// The value is left in place of the array, like the other assignments
+			count = ip->arg;
+			sp -= count + 1;
+			assign_index(vm, &sp[-1], sp, count, sp[count]);
+			sp[-1] = sp[count];
+			SAFE_POINT();
+			break;
+		case INS_MEMBER:;
+			struct Value *member = NULL;
+			if (sp[-1].type == VAL_MAP) member = access_member(&chunk->caches[ip->arg], sp[-1].map);
+			sp[-1] = member ? *member : (struct Value){.type = VAL_EMPTY};
+			break;
+		case INS_SET_MEMBER:
+			if (sp[-2].type != VAL_MAP) cease(vm->point, "Variable must be of type \"Map\"", false);
+			member = access_member(&chunk->caches[ip->arg], sp[-2].map);
+			if (member) {
+				heap_assign(member, sp[-1]);
+			} else if (!map_set(sp[-2].map, chunk->caches[ip->arg].key, sp[-1])) {
+				cease_mem(vm->point, "adding a key to a map");
+			}
+			sp[-2] = sp[-1];
+			--sp;
+			SAFE_POINT();
+			break;
+		case INS_MAP:
+			*sp = (struct Value){.type = VAL_MAP, .counted = true, .map = heap_map()};
+			if (!sp++->map) cease_mem(vm->point, "creating a map");
+			SAFE_POINT();
+			break;
+		case INS_ARRAY:;
+			size_t bounds[ARRAY_MAX_DIMENSIONS];
+			count = ip->arg;
+			sp -= count;
+			to_indices(vm, sp, count, bounds);
+			*sp = (struct Value){.type = VAL_ARRAY, .counted = true, .array = heap_array(bounds, count)};
+			if (!sp++->array) cease_mem(vm->point, "creating an array");
+			SAFE_POINT();
+			break;
+		case INS_REDIM:
+			count = ip->arg;
+			sp -= count + 1;
+			if (sp->type != VAL_ARRAY) cease(vm->point, "Variable must be of type \"Array\"", false);
+			to_indices(vm, sp + 1, count, bounds);
+			if (!array_redim(sp->array, bounds, count)) cease_mem(vm->point, "resizing an array");
+			SAFE_POINT();
+			break;
+		case INS_CALL:;
+			struct CallSite *site = &chunk->calls[ip->arg];
+			
+			// The arguments are passed in place, the callee may run code on the stack above them
+			sp -= site->argc;
+			size_t depth = vm->depth;
+			vm->depth = sp + site->argc - vm->stack;
+			vm->site = site;
+			struct Value result = site->function(vm, sp, site->argc);
+			vm->depth = depth;
+			*sp++ = result;
+			break;
+		case INS_RETURN:
+			return sp[-1];
+	}
+	
+	#undef NUMBER
+	#undef BOOLEAN
+	#undef ARITHMETIC
+	#undef INTEGER_ARITHMETIC
+	#undef COMPARISON
+	#undef EQUALITY
+	#undef SAFE_POINT
+	#undef HEAT_UP
+}
+
+static struct Value *access_member(struct AccessCache *cache, struct Map *map) {
+	uint32_t shape = map->shape->id;
+	for (unsigned char i = 0; i < cache->count; ++i) {
+		if (cache->entries[i].shape != shape) continue;
+		++cache->hits;
+		return &map->values[cache->entries[i].slot];
+	}
+	
+	++cache->misses;
+	size_t slot = map_slot(map, cache->key);
+	if (slot == MAP_NO_SLOT) return NULL;
+	
+	// Remember the slot for this shape, sites which see too many shapes stop caching
+	if (cache->count < ACCESS_CACHE_ENTRIES) {
+		cache->entries[cache->count].shape = shape;
+		cache->entries[cache->count].slot = slot;
+		++cache->count;
+	} else {
+		cache->megamorphic = true;
+	}
+	return &map->values[slot];
+}
+
+static struct Value *access_index(struct VM *vm, struct Value *container, struct Value subscripts[], unsigned char count) {
+	static struct Value empty = {.type = VAL_EMPTY};
+	
+	if (container->type == VAL_MAP) {
+		if (count != 1) cease(vm->point, err_subscript, false);
+		char buffer[VALUE_STRING_BUFFER_SIZE];
+		struct Value *value = map_get(container->map, value_to_string(&subscripts[0], buffer));
+		return value ? value : &empty;
+	}
+	
+	if (container->type != VAL_ARRAY) cease(vm->point, "Subscript used on non-accessible variable", false);
+	
+	size_t indices[ARRAY_MAX_DIMENSIONS];
+	to_indices(vm, subscripts, count, indices);
+	struct Value *value = array_at(container->array, indices, count);
+	if (!value) cease(vm->point, err_subscript, false);
+	return value;
+}
+
+static void assign_index(struct VM *vm, struct Value *container, struct Value subscripts[], unsigned char count, struct Value value) {
+	// A subscript which isn't in a map adds the key, unlike an array which has to be resized first
+	if (container->type == VAL_MAP) {
+		if (count != 1) cease(vm->point, err_subscript, false);
+		char buffer[VALUE_STRING_BUFFER_SIZE];
+		if (!map_set(container->map, value_to_string(&subscripts[0], buffer), value)) cease_mem(vm->point, "adding a key to a map");
+		return;
+	}
+	heap_assign(access_index(vm, container, subscripts, count), value);
+}
+
+static void to_indices(struct VM *vm, struct Value values[], unsigned char count, size_t indices[]) {
+	for (unsigned char i = 0; i < count; ++i) {
+		// Fractions are truncated, NaN and subscripts which don't fit in a size_t are out of range like negative ones
+		double index = value_to_number(&values[i]);
+		if (!(index >= 0 && index < SIZE_MAX)) cease(vm->point, err_subscript, false);
+		indices[i] = (size_t) index;
+	}
+}
+
+static struct Value concat(struct VM *vm, struct Value *a, struct Value *b) {
+	char buffer_a[VALUE_STRING_BUFFER_SIZE], buffer_b[VALUE_STRING_BUFFER_SIZE];
+	struct String str_a = string_of(a, buffer_a);
+	struct String str_b = string_of(b, buffer_b);
+	
+	char *result = heap_string(str_a.len + str_b.len);
+	if (!result) cease_mem(vm->point, "concatenating strings");
+	memcpy(result, str_a.chars, str_a.len);
+	memcpy(result + str_a.len, str_b.chars, str_b.len);
+	
+	return (struct Value){.type = VAL_STRING, .counted = true, .string = result};
+}
+
+static void store_counter(struct Value *variable, struct Value counter) {
+	// The counter is a number, so only the old value of the variable can be on the heap
+	if (variable->counted) heap_release(variable);
+	*variable = counter;
+}
+
+static uint64_t trip_count(uint64_t span, uint64_t step) {
+	// Only a step of 1 over the whole range of an Int64 has UINT64_MAX + 1 iterations, one less is as good as endless
+	uint64_t quotient = span / step;
+	return quotient == UINT64_MAX ? quotient : quotient + 1;
+}
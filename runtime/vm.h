@@ -0,0 +1,45 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNTIME_VM_H
+#define RUNTIME_VM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "cease/cease.h"
+#include "runtime/bytecode.h"
+#include "runtime/value.h"
+
+#ifndef VM_STACK_SIZE
+#define VM_STACK_SIZE 1024
+#endif
+
+struct VM {
+	struct Value *globals;
+	CeasePoint *point;
+	size_t depth; // Number of stack entries used by the callers of the current code
+	struct CallSite *site; // Call of the running built-in function
+	bool jit; // Compile hot chunks to machine code, see runtime/jit.h
+	struct Value stack[VM_STACK_SIZE];
+};
+
+/* The result isn't counted, it has to be retained to be kept past the next collection (see runtime/heap.h) */
+struct Value vm_run(struct VM *vm, struct Chunk *chunk, struct Value *locals);
+
+#endif
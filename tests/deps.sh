@@ -0,0 +1,11 @@
+#!/bin/sh
+# Usage: deps.sh <eci>
+# Writes the depfile of tests/deps/main.au3 with lib/ as the include directory and compares it with tests/deps/expected.d,
+# the includes which can't be found are left out of it
+set -e
+eci=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+cd "$(dirname "$0")/deps"
+actual=$(mktemp)
+trap 'rm -f "$actual"' EXIT
+"$eci" -I lib --deps main.au3 main.ok > "$actual"
+diff -u expected.d "$actual"
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Usage: limits.sh <eci>
+# Generates scripts with a list of a million expressions and a million levels of nested parentheses,
+# both have to get through the parser and the tree walks without running out of stack
+set -e
+eci=$1
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# The arguments are all parsed and counted before the call is rejected
+awk 'BEGIN { printf "Abs(1"; for (i = 2; i <= 1000000; ++i) printf ", %d", i; print ")" }' > "$dir/list.au3"
+if "$eci" --run "$dir/list.au3" 2> "$dir/list.err"; then
+	echo "A call with a million arguments was not rejected"
+	exit 1
+fi
+grep -qx "Function 'Abs' takes 1 argument, not 1000000" "$dir/list.err"
+
+# Left-deep, so the value stack stays small while the tree is a million levels deep
+awk 'BEGIN { n = 1000000; printf "Global $deep = "; for (i = 0; i < n; ++i) printf "("; printf "0"; for (i = 0; i < n; ++i) printf " + 1)"; print "" }' > "$dir/deep.au3"
+for mode in --no-jit --jit; do
+	"$eci" --run $mode "$dir/deep.au3" > "$dir/deep.out"
+	grep -qx '\$deep Int32 1000000' "$dir/deep.out"
+done
@@ -0,0 +1,169 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Checks number_from_str of parser/number.c on literals whose rounding is known (halfway cases,
+ * subnormals, overflow, long significands and hexadecimal literals) and against strtod of the C
+ * library on random literals, which covers both Eisel-Lemire and the fallback to strtod for long
+ * significands right between two doubles.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parser/number.h"
+
+#define ROUNDS 1000000
+#define MAX_LEN 64
+
+struct Case {
+	char *literal;
+	double expected;
+};
+
+static const struct Case cases[] = {
+	// Clinger's fast path
+	{"1.5", 0x1.8p+0},
+	{"123.456e5", 0x1.78c2p+23},
+	{"0.1", 0x1.999999999999ap-4},
+	{"9007199254740992e22", 0x1.0f0cf064dd592p+126},
+	
+	// Halfway between two doubles, rounded to even
+	{"9007199254740993.0", 0x1p+53},
+	{"9007199254740995.0", 0x1.0000000000002p+53},
+	{"4503599627370496.5", 0x1p+52},
+	{"4503599627370497.5", 0x1.0000000000002p+52},
+	{"1.00000000000000011102230246251565404236316680908203125", 0x1p+0},
+	{"1.00000000000000033306690738754696212708950042724609375", 0x1.0000000000002p+0},
+	
+	// Just off halfway, only the digits past the 19th tell which way to round
+	{"1.00000000000000011102230246251565404236316680908203124", 0x1p+0},
+	{"1.00000000000000011102230246251565404236316680908203126", 0x1.0000000000001p+0},
+	{"9007199254740993.0000000000000000001", 0x1.0000000000001p+53},
+	
+	// 19 and 20 digit significands
+	{"1234567890123456789e-5", 0x1.674e79c5fe523p+43},
+	{"12345678901234567890e-5", 0x1.c12218377de6bp+46},
+	{"12345678901234567891e-5", 0x1.c12218377de6bp+46},
+	{"9999999999999999999", 0x1.158e460913dp+63},
+	{"18446744073709551615", 0x1p+64},
+	{"18446744073709551616", 0x1p+64},
+	{"99999999999999999999.5", 0x1.5af1d78b58c4p+66},
+	
+	// Subnormals
+	{"4.9406564584124654e-324", 0x1p-1074},
+	{"2.4703282292062328e-324", 0x1p-1074},
+	{"1e-310", 0x0.012688b70e62bp-1022},
+	{"2.2250738585072009e-308", 0x0.fffffffffffffp-1022},
+	{"2.2250738585072011e-308", 0x0.fffffffffffffp-1022},
+	{"2.2250738585072014e-308", 0x1p-1022},
+	
+	// Underflow to zero
+	{"2.4703282292062327e-324", 0.0},
+	{"2e-324", 0.0},
+	{"1e-400", 0.0},
+	{"0.0000e999", 0.0},
+	
+	// Overflow to infinity
+	{"1.7976931348623157e308", 0x1.fffffffffffffp+1023},
+	{"1.7976931348623158e308", 0x1.fffffffffffffp+1023},
+	{"1.7976931348623159e308", INFINITY},
+	{"1e309", INFINITY},
+	{"1e400", INFINITY},
+	{"123456789012345678901234567890e300", INFINITY},
+	
+	// Hexadecimal, past 16 digits the dropped ones only break ties
+	{"0x10", 0x1p+4},
+	{"0xFF", 0x1.fep+7},
+	{"0x1FFFFFFFFFFFFF", 0x1.fffffffffffffp+52},
+	{"0x20000000000001", 0x1p+53},
+	{"0x20000000000003", 0x1.0000000000002p+53},
+	{"0xFFFFFFFFFFFFFFFF", 0x1p+64},
+	{"0x10000000000000001", 0x1p+64},
+	{"0x100000000000008000", 0x1p+68},
+	{"0x100000000000008001", 0x1.0000000000001p+68},
+	{"0x100000000000018000", 0x1.0000000000002p+68},
+};
+
+static uint64_t seed = 88172645463325252u;
+static size_t failures = 0;
+
+static uint64_t next_random(void);
+static size_t random_literal(char *literal);
+static void check(char *literal, size_t len, double expected);
+
+int main(void) {
+	for (size_t i = 0; i < sizeof cases / sizeof *cases; ++i) check(cases[i].literal, strlen(cases[i].literal), cases[i].expected);
+	
+	// A hexadecimal literal of more than 1024 bits
+	char huge[2 + 300 + 1] = "0x";
+	memset(huge + 2, 'F', 300);
+	huge[sizeof huge - 1] = '\0';
+	check(huge, sizeof huge - 1, INFINITY);
+	
+	for (size_t round = 0; round < ROUNDS && failures < 10; ++round) {
+		char literal[MAX_LEN + 1];
+		size_t len = random_literal(literal);
+		check(literal, len, strtod(literal, NULL));
+	}
+	
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static uint64_t next_random(void) {
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	return seed;
+}
+
+static size_t random_literal(char *literal) {
+	size_t len = 0;
+	if (next_random() % 8 == 0) {
+		// Hexadecimal, long enough to drop digits now and then
+		literal[len++] = '0';
+		literal[len++] = 'x';
+		size_t digits = 1 + next_random() % 24;
+		for (size_t i = 0; i < digits; ++i) literal[len++] = "0123456789abcdefABCDEF"[next_random() % 22];
+		literal[len] = '\0';
+		return len;
+	}
+	
+	// Up to 24 digits with a point somewhere, sometimes a run of nines or zeroes to land near a tie
+	size_t digits = 1 + next_random() % 24, point = next_random() % (digits + 1);
+	char filler = next_random() % 4 == 0 ? "09"[next_random() % 2] : 0;
+	for (size_t i = 0; i < digits; ++i) {
+		if (i == point && i) literal[len++] = '.';
+		literal[len++] = filler && i > 2 ? filler : (char) ('0' + next_random() % 10);
+	}
+	if (next_random() % 2) len += sprintf(literal + len, "e%+d", (int) (next_random() % 700) - 350);
+	literal[len] = '\0';
+	return len;
+}
+
+static void check(char *literal, size_t len, double expected) {
+	double actual = number_from_str(literal, len);
+	if (memcmp(&actual, &expected, sizeof actual) == 0) return;
+	++failures;
+	fprintf(stderr, "number_from_str(\"%.*s\") is %a instead of %a\n", (int) len, literal, actual, expected);
+}
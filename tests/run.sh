@@ -0,0 +1,13 @@
+#!/bin/sh
+# Usage: run.sh <eci> <script>
+# Runs the script with the JIT off and on, both runs have to leave the globals and the count of heap objects listed in <script>.out
+set -e
+eci=$1
+script=$2
+expected=${script%.au3}.out
+actual=$(mktemp)
+trap 'rm -f "$actual"' EXIT
+for mode in --no-jit --jit; do
+	"$eci" --run $mode "$script" > "$actual"
+	diff -u "$expected" "$actual"
+done
@@ -0,0 +1,135 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Checks the kernels of runtime/string.c against plain loops on random strings. It is built
+ * once for each flavour of the kernels (scalar, SSE2 and AVX2), exits with TEST_SKIPPED when
+ * the processor can't run the flavour it was built for.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runtime/string.h"
+
+#define TEST_SKIPPED 77
+#define ROUNDS 200000
+#define MAX_LEN 100
+
+static uint64_t seed = 88172645463325252u;
+static size_t failures = 0;
+
+static uint64_t next_random(void);
+static void random_string(char *chars, size_t len);
+static unsigned char reference_fold(unsigned char chr);
+static size_t reference_find(struct String haystack, struct String needle, size_t start, bool case_sensitive);
+static int reference_compare(struct String a, struct String b, bool case_sensitive);
+static void check(bool passed, char *what, struct String a, struct String b);
+
+int main(void) {
+#if !defined(STRING_SCALAR) && defined(__AVX2__)
+	if (!__builtin_cpu_supports("avx2")) return TEST_SKIPPED;
+#endif
+	
+	// The strings are put at every alignment, with room to spare for loads which go past them
+	static char buffers[2][MAX_LEN + 64];
+	for (size_t round = 0; round < ROUNDS && failures < 10; ++round) {
+		struct String a = {buffers[0] + next_random() % 32, next_random() % MAX_LEN};
+		struct String b = {buffers[1] + next_random() % 32, next_random() % 2 ? next_random() % 8 : next_random() % MAX_LEN};
+		random_string(a.chars, a.len);
+		random_string(b.chars, b.len);
+		
+		// Plant the needle, sometimes in a different case, so that there is something to find
+		if (b.len <= a.len && next_random() % 2) {
+			size_t at = next_random() % (a.len - b.len + 1);
+			for (size_t i = 0; i < b.len; ++i) a.chars[at + i] = next_random() % 4 ? b.chars[i] : b.chars[i] ^ 0x20;
+		}
+		bool case_sensitive = next_random() % 2;
+		size_t start = next_random() % (a.len + 2);
+		
+		check(string_find(a, b, start, case_sensitive) == reference_find(a, b, start, case_sensitive), "string_find", a, b);
+		int sign = string_compare(a, b, case_sensitive), expected = reference_compare(a, b, case_sensitive);
+		check((sign > 0) - (sign < 0) == expected, "string_compare", a, b);
+		check(string_equal(a, b, case_sensitive) == (a.len == b.len && expected == 0), "string_equal", a, b);
+		
+		char upper[MAX_LEN], lower[MAX_LEN];
+		string_upper(upper, a.chars, a.len);
+		string_lower(lower, a.chars, a.len);
+		bool shifted = true;
+		for (size_t i = 0; i < a.len; ++i) {
+			unsigned char chr = a.chars[i];
+			if (upper[i] != (char) (chr >= 'a' && chr <= 'z' ? chr - 32 : chr)) shifted = false;
+			if (lower[i] != (char) reference_fold(chr)) shifted = false;
+		}
+		check(shifted, "string_upper and string_lower", a, b);
+	}
+	
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static uint64_t next_random(void) {
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	return seed;
+}
+
+static void random_string(char *chars, size_t len) {
+	// Mostly letters of both cases, along with the characters right next to them and ones with the high bit
+	static const char alphabet[] = "aAbBzZ@[`{\x80\xC1\xE1\xFF";
+	for (size_t i = 0; i < len; ++i) chars[i] = alphabet[next_random() % (sizeof alphabet - 1)];
+}
+
+static unsigned char reference_fold(unsigned char chr) {
+	return chr >= 'A' && chr <= 'Z' ? chr + 32 : chr;
+}
+
+static size_t reference_find(struct String haystack, struct String needle, size_t start, bool case_sensitive) {
+	for (size_t i = start; i + needle.len <= haystack.len; ++i) {
+		size_t j = 0;
+		while (j < needle.len) {
+			unsigned char a = haystack.chars[i + j], b = needle.chars[j];
+			if (case_sensitive ? a != b : reference_fold(a) != reference_fold(b)) break;
+			++j;
+		}
+		if (j == needle.len) return i;
+	}
+	return STRING_NOT_FOUND;
+}
+
+static int reference_compare(struct String a, struct String b, bool case_sensitive) {
+	for (size_t i = 0; i < a.len && i < b.len; ++i) {
+		unsigned char x = a.chars[i], y = b.chars[i];
+		if (!case_sensitive) {
+			x = reference_fold(x);
+			y = reference_fold(y);
+		}
+		if (x != y) return x < y ? -1 : 1;
+	}
+	return (a.len > b.len) - (a.len < b.len);
+}
+
+static void check(bool passed, char *what, struct String a, struct String b) {
+	if (passed) return;
+	++failures;
+	fprintf(stderr, "%s differs from the reference for \"%.*s\" and \"%.*s\"\n", what, (int) a.len, a.chars, (int) b.len, b.chars);
+}
@@ -36,6 +36,16 @@ noreturn void die(char *msg) {
 	exit(EXIT_FAILURE);
 }
 
+void *grow_array(void *array, size_t *cap, size_t len, size_t size) {
+	// Make room for one more element, doubling the capacity when needed
+	if (len < *cap) return array;
+	size_t new_cap = *cap ? *cap * 2 : 16;
+	void *new_array = realloc(array, size * new_cap);
+	if (!new_array) return NULL;
+	*cap = new_cap;
+	return new_array;
+}
+
 char *readfile(FILE *file) {
 	// Define the final buffer
 	char *final_buffer = NULL;
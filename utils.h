@@ -39,5 +39,6 @@ struct ReadFileBufferNode {
 bool chrcmp(char chr, char *arr, size_t arr_len);
 noreturn void die(char *msg);
 char *readfile(FILE *file);
+void *grow_array(void *array, size_t *cap, size_t len, size_t size);
 
 #endif
@@ -0,0 +1,113 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE /* Required to enable (v)asprintf */
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "utils.h"
+#include "watch/watch.h"
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+
+// Saving a file is often more than one event, the ones which follow within this many milliseconds are taken together
+#ifndef WATCH_SETTLE_TIME
+#define WATCH_SETTLE_TIME 30
+#endif
+
+static bool read_events(struct Watcher *watcher, watch_handler handler);
+
+bool watch_init(struct Watcher *watcher) {
+	*watcher = (struct Watcher){.fd = inotify_init1(IN_CLOEXEC)};
+	return watcher->fd != -1;
+}
+
+bool watch_file(struct Watcher *watcher, char *file) {
+	char *slash = strrchr(file, '/');
+	size_t len = slash ? (slash == file ? 1 : slash - file) : 0;
+	for (size_t i = 0; i < watcher->dirs_len; ++i) {
+		if (strncmp(watcher->dirs[i].path, file, len) == 0 && watcher->dirs[i].path[len] == '\0') return true;
+	}
+	
+	struct WatchDir *new_dirs = grow_array(watcher->dirs, &watcher->dirs_cap, watcher->dirs_len, sizeof *watcher->dirs);
+	if (!new_dirs) return false;
+	watcher->dirs = new_dirs;
+	char *path = strndup(file, len);
+	if (!path) return false;
+	int descriptor = inotify_add_watch(watcher->fd, len ? path : ".", WATCH_EVENTS);
+	if (descriptor == -1) {
+		free(path);
+		return false;
+	}
+	watcher->dirs[watcher->dirs_len++] = (struct WatchDir){.descriptor = descriptor, .path = path};
+	return true;
+}
+
+bool watch_wait(struct Watcher *watcher, watch_handler handler) {
+	// Block until something changes, then take in everything else which changes right after it
+	struct pollfd poll_fd = {.fd = watcher->fd, .events = POLLIN};
+	if (poll(&poll_fd, 1, -1) == -1) return false;
+	do {
+		if (!read_events(watcher, handler)) return false;
+	} while (poll(&poll_fd, 1, WATCH_SETTLE_TIME) > 0);
+	return true;
+}
+
+void watch_free(struct Watcher *watcher) {
+	for (size_t i = 0; i < watcher->dirs_len; ++i) free(watcher->dirs[i].path);
+	free(watcher->dirs);
+	close(watcher->fd);
+	*watcher = (struct Watcher){.fd = -1};
+}
+
+static bool read_events(struct Watcher *watcher, watch_handler handler) {
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len = read(watcher->fd, buffer, sizeof buffer);
+	if (len <= 0) return false;
+	
+	for (char *cursor = buffer; cursor < buffer + len;) {
+		struct inotify_event *event = (struct inotify_event *) cursor;
+		cursor += sizeof *event + event->len;
+		if (!event->len) continue;
+		
+		// Report the file by the same name it was watched with
+		char *dir = NULL;
+		for (size_t i = 0; i < watcher->dirs_len; ++i) {
+			if (watcher->dirs[i].descriptor == event->wd) {
+				dir = watcher->dirs[i].path;
+				break;
+			}
+		}
+		if (!dir) continue;
+		if (!*dir) {
+			handler(event->name);
+			continue;
+		}
+		char *file;
+		if (asprintf(&file, dir[strlen(dir) - 1] == '/' ? "%s%s" : "%s/%s", dir, event->name) == -1) return false;
+		handler(file);
+		free(file);
+	}
+	return true;
+}
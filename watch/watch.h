@@ -0,0 +1,49 @@
+/* 
+ * This file is part of EasyCodeIt.
+ * 
+ * Copyright (C) 2021 TheDcoder <TheDcoder@protonmail.com>
+ * 
+ * EasyCodeIt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WATCH_WATCH_H
+#define WATCH_WATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Waits for files to change with inotify. The directories of the files are watched
+ * rather than the files themselves, as most editors save by replacing the file.
+ */
+
+struct WatchDir {
+	int descriptor;
+	char *path; // Empty for the current directory
+};
+
+struct Watcher {
+	int fd;
+	struct WatchDir *dirs;
+	size_t dirs_len, dirs_cap;
+};
+
+typedef void (*watch_handler)(char *file);
+
+bool watch_init(struct Watcher *watcher);
+bool watch_file(struct Watcher *watcher, char *file);
+bool watch_wait(struct Watcher *watcher, watch_handler handler);
+void watch_free(struct Watcher *watcher);
+
+#endif